@@ -0,0 +1,433 @@
+/*
+ * GDB Agent Expression Evaluator for OpenLink ColdFire
+ *
+ * Stack machine for the bytecode GDB attaches to conditional breakpoints.
+ * Values are 64-bit as in GDB; registers and memory are zero-extended and
+ * GDB emits explicit 'ext' opcodes where it wants sign extension.
+ *
+ * License: GPL v3
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "agent_expr.h"
+
+/* Opcodes (from gdb/common/ax.def) */
+#define AX_FLOAT            0x01
+#define AX_ADD              0x02
+#define AX_SUB              0x03
+#define AX_MUL              0x04
+#define AX_DIV_SIGNED       0x05
+#define AX_DIV_UNSIGNED     0x06
+#define AX_REM_SIGNED       0x07
+#define AX_REM_UNSIGNED     0x08
+#define AX_LSH              0x09
+#define AX_RSH_SIGNED       0x0a
+#define AX_RSH_UNSIGNED     0x0b
+#define AX_TRACE            0x0c
+#define AX_TRACE_QUICK      0x0d
+#define AX_LOG_NOT          0x0e
+#define AX_BIT_AND          0x0f
+#define AX_BIT_OR           0x10
+#define AX_BIT_XOR          0x11
+#define AX_BIT_NOT          0x12
+#define AX_EQUAL            0x13
+#define AX_LESS_SIGNED      0x14
+#define AX_LESS_UNSIGNED    0x15
+#define AX_EXT              0x16
+#define AX_REF8             0x17
+#define AX_REF16            0x18
+#define AX_REF32            0x19
+#define AX_REF64            0x1a
+#define AX_IF_GOTO          0x20
+#define AX_GOTO             0x21
+#define AX_CONST8           0x22
+#define AX_CONST16          0x23
+#define AX_CONST32          0x24
+#define AX_CONST64          0x25
+#define AX_REG              0x26
+#define AX_END              0x27
+#define AX_DUP              0x28
+#define AX_POP              0x29
+#define AX_ZERO_EXT         0x2a
+#define AX_SWAP             0x2b
+#define AX_TRACEV           0x2e
+#define AX_TRACENZ          0x2f
+#define AX_TRACE16          0x30
+#define AX_PICK             0x32
+#define AX_ROT              0x33
+
+/* Read a big-endian operand of 'n' bytes following the opcode */
+static int fetch_operand(const uint8_t *code, size_t len, size_t *pc,
+                         int n, uint64_t *value) {
+    if (*pc + n > len) {
+        return -1;
+    }
+    uint64_t v = 0;
+    for (int i = 0; i < n; i++) {
+        v = (v << 8) | code[(*pc)++];
+    }
+    *value = v;
+    return 0;
+}
+
+/* Sign-extend the low 'bits' bits of a value */
+static int64_t sign_extend(uint64_t value, unsigned bits) {
+    if (bits == 0 || bits >= 64) {
+        return (int64_t)value;
+    }
+    uint64_t sign = 1ULL << (bits - 1);
+    value &= (1ULL << bits) - 1;
+    return (int64_t)((value ^ sign) - sign);
+}
+
+/* Read a big-endian value of 'size' bytes from target memory */
+static int read_target_value(const ax_target_t *target, uint64_t addr,
+                             int size, uint64_t *value) {
+    uint8_t buf[8];
+    if (!target->read_mem ||
+        target->read_mem(target->ctx, (uint32_t)addr, buf, size) != 0) {
+        return -1;
+    }
+    uint64_t v = 0;
+    for (int i = 0; i < size; i++) {
+        v = (v << 8) | buf[i];
+    }
+    *value = v;
+    return 0;
+}
+
+int ax_eval(const uint8_t *code, size_t len, const ax_target_t *target,
+            int64_t *result) {
+    int64_t stack[AX_STACK_SIZE];
+    int sp = 0;         /* Number of entries on the stack */
+    size_t pc = 0;
+    uint64_t operand;
+
+/* Stack helpers - bail out on underflow/overflow */
+#define NEED(n)     do { if (sp < (n)) goto fault; } while (0)
+#define ROOM(n)     do { if (sp + (n) > AX_STACK_SIZE) goto fault; } while (0)
+#define TOP         stack[sp - 1]
+#define NEXT        stack[sp - 2]
+
+    for (int steps = 0; steps < AX_MAX_STEPS; steps++) {
+        if (pc >= len) {
+            goto fault;  /* Ran off the end without 'end' */
+        }
+
+        uint8_t op = code[pc++];
+        switch (op) {
+            case AX_ADD:
+                NEED(2); NEXT = (int64_t)((uint64_t)NEXT + (uint64_t)TOP); sp--;
+                break;
+            case AX_SUB:
+                NEED(2); NEXT = (int64_t)((uint64_t)NEXT - (uint64_t)TOP); sp--;
+                break;
+            case AX_MUL:
+                NEED(2); NEXT = (int64_t)((uint64_t)NEXT * (uint64_t)TOP); sp--;
+                break;
+            case AX_DIV_SIGNED:
+                NEED(2);
+                if (TOP == 0) goto fault;
+                NEXT = NEXT / TOP; sp--;
+                break;
+            case AX_DIV_UNSIGNED:
+                NEED(2);
+                if (TOP == 0) goto fault;
+                NEXT = (int64_t)((uint64_t)NEXT / (uint64_t)TOP); sp--;
+                break;
+            case AX_REM_SIGNED:
+                NEED(2);
+                if (TOP == 0) goto fault;
+                NEXT = NEXT % TOP; sp--;
+                break;
+            case AX_REM_UNSIGNED:
+                NEED(2);
+                if (TOP == 0) goto fault;
+                NEXT = (int64_t)((uint64_t)NEXT % (uint64_t)TOP); sp--;
+                break;
+            case AX_LSH:
+                NEED(2); NEXT = (int64_t)((uint64_t)NEXT << (TOP & 63)); sp--;
+                break;
+            case AX_RSH_SIGNED:
+                NEED(2); NEXT = NEXT >> (TOP & 63); sp--;
+                break;
+            case AX_RSH_UNSIGNED:
+                NEED(2); NEXT = (int64_t)((uint64_t)NEXT >> (TOP & 63)); sp--;
+                break;
+            case AX_LOG_NOT:
+                NEED(1); TOP = !TOP;
+                break;
+            case AX_BIT_AND:
+                NEED(2); NEXT &= TOP; sp--;
+                break;
+            case AX_BIT_OR:
+                NEED(2); NEXT |= TOP; sp--;
+                break;
+            case AX_BIT_XOR:
+                NEED(2); NEXT ^= TOP; sp--;
+                break;
+            case AX_BIT_NOT:
+                NEED(1); TOP = ~TOP;
+                break;
+            case AX_EQUAL:
+                NEED(2); NEXT = (NEXT == TOP); sp--;
+                break;
+            case AX_LESS_SIGNED:
+                NEED(2); NEXT = (NEXT < TOP); sp--;
+                break;
+            case AX_LESS_UNSIGNED:
+                NEED(2); NEXT = ((uint64_t)NEXT < (uint64_t)TOP); sp--;
+                break;
+            case AX_EXT:
+                if (fetch_operand(code, len, &pc, 1, &operand) != 0) goto fault;
+                NEED(1); TOP = sign_extend((uint64_t)TOP, (unsigned)operand);
+                break;
+            case AX_ZERO_EXT:
+                if (fetch_operand(code, len, &pc, 1, &operand) != 0) goto fault;
+                NEED(1);
+                if (operand < 64) {
+                    TOP = (int64_t)((uint64_t)TOP & ((1ULL << operand) - 1));
+                }
+                break;
+            case AX_REF8:
+            case AX_REF16:
+            case AX_REF32:
+            case AX_REF64: {
+                static const int ref_size[] = { 1, 2, 4, 8 };
+                uint64_t value;
+                NEED(1);
+                if (read_target_value(target, (uint64_t)TOP,
+                                      ref_size[op - AX_REF8], &value) != 0) {
+                    goto fault;
+                }
+                TOP = (int64_t)value;
+                break;
+            }
+            case AX_IF_GOTO:
+                if (fetch_operand(code, len, &pc, 2, &operand) != 0) goto fault;
+                NEED(1);
+                if (stack[--sp] != 0) {
+                    pc = (size_t)operand;
+                }
+                break;
+            case AX_GOTO:
+                if (fetch_operand(code, len, &pc, 2, &operand) != 0) goto fault;
+                pc = (size_t)operand;
+                break;
+            case AX_CONST8:
+            case AX_CONST16:
+            case AX_CONST32:
+            case AX_CONST64:
+                if (fetch_operand(code, len, &pc, 1 << (op - AX_CONST8), &operand) != 0) {
+                    goto fault;
+                }
+                ROOM(1); stack[sp++] = (int64_t)operand;
+                break;
+            case AX_REG: {
+                uint32_t value;
+                if (fetch_operand(code, len, &pc, 2, &operand) != 0) goto fault;
+                if (!target->read_reg ||
+                    target->read_reg(target->ctx, (int)operand, &value) != 0) {
+                    goto fault;
+                }
+                ROOM(1); stack[sp++] = value;
+                break;
+            }
+            case AX_END:
+                NEED(1);
+                *result = TOP;
+                return 0;
+            case AX_DUP:
+                NEED(1); ROOM(1); stack[sp] = TOP; sp++;
+                break;
+            case AX_POP:
+                NEED(1); sp--;
+                break;
+            case AX_SWAP: {
+                NEED(2);
+                int64_t tmp = TOP; TOP = NEXT; NEXT = tmp;
+                break;
+            }
+            case AX_PICK:
+                if (fetch_operand(code, len, &pc, 1, &operand) != 0) goto fault;
+                NEED((int)operand + 1); ROOM(1);
+                stack[sp] = stack[sp - 1 - (int)operand]; sp++;
+                break;
+            case AX_ROT: {
+                /* a b c => c a b */
+                NEED(3);
+                int64_t c = stack[sp - 1];
+                stack[sp - 1] = stack[sp - 2];
+                stack[sp - 2] = stack[sp - 3];
+                stack[sp - 3] = c;
+                break;
+            }
+
+            /* Tracing opcodes have no effect when evaluating a condition */
+            case AX_TRACE:
+            case AX_TRACENZ:
+                NEED(2); sp -= 2;
+                break;
+            case AX_TRACE_QUICK:
+                if (fetch_operand(code, len, &pc, 1, &operand) != 0) goto fault;
+                break;
+            case AX_TRACE16:
+            case AX_TRACEV:
+                if (fetch_operand(code, len, &pc, 2, &operand) != 0) goto fault;
+                break;
+
+            default:
+                /* float, ref_float/double, getv/setv, printf, ... */
+                printf("Agent expression: unsupported opcode 0x%02X at %zu\n", op, pc - 1);
+                return -1;
+        }
+    }
+
+    printf("Agent expression: step limit exceeded\n");
+    return -1;
+
+fault:
+    printf("Agent expression: evaluation fault at %zu\n", pc);
+    return -1;
+
+#undef NEED
+#undef ROOM
+#undef TOP
+#undef NEXT
+}
+
+/* Symbolic stack entry for ax_match_compare() */
+typedef struct {
+    enum { SYM_CONST, SYM_VAR, SYM_MATCH } kind;
+    int64_t value;      /* SYM_CONST */
+    uint32_t mask;      /* SYM_VAR: bits of the variable still compared */
+    int is_signed;      /* SYM_VAR: sign-extended from its full width */
+} ax_sym_t;
+
+int ax_match_compare(const uint8_t *code, size_t len, uint32_t addr,
+                     uint32_t size, uint32_t *value, uint32_t *mask) {
+    ax_sym_t stack[4];
+    int sp = 0;
+    size_t pc = 0;
+    uint64_t operand;
+    unsigned bits = size * 8;
+    uint32_t width_mask = size == 4 ? 0xFFFFFFFF : (1u << bits) - 1;
+
+    if (size != 1 && size != 2 && size != 4) {
+        return -1;
+    }
+
+    while (pc < len) {
+        uint8_t op = code[pc++];
+        switch (op) {
+            case AX_CONST8:
+            case AX_CONST16:
+            case AX_CONST32:
+            case AX_CONST64: {
+                int n = 1 << (op - AX_CONST8);
+                if (sp == 4 || fetch_operand(code, len, &pc, n, &operand) != 0) {
+                    return -1;
+                }
+                stack[sp].kind = SYM_CONST;
+                stack[sp].value = (int64_t)operand;
+                sp++;
+                break;
+            }
+            case AX_REF8:
+            case AX_REF16:
+            case AX_REF32:
+                /* Only a read of the watched variable itself */
+                if (sp < 1 || stack[sp - 1].kind != SYM_CONST ||
+                    (uint64_t)stack[sp - 1].value != addr ||
+                    (1u << (op - AX_REF8)) != size) {
+                    return -1;
+                }
+                stack[sp - 1].kind = SYM_VAR;
+                stack[sp - 1].mask = width_mask;
+                stack[sp - 1].is_signed = 0;
+                break;
+            case AX_EXT:
+            case AX_ZERO_EXT: {
+                if (sp < 1 || fetch_operand(code, len, &pc, 1, &operand) != 0) {
+                    return -1;
+                }
+                ax_sym_t *s = &stack[sp - 1];
+                unsigned n = (unsigned)operand;
+                if (s->kind == SYM_CONST) {
+                    s->value = op == AX_EXT ? sign_extend((uint64_t)s->value, n)
+                             : (n < 64 ? (int64_t)((uint64_t)s->value & ((1ULL << n) - 1))
+                                       : s->value);
+                } else if (s->kind != SYM_VAR) {
+                    return -1;
+                } else if (op == AX_EXT) {
+                    /* Sign extension from the variable's own width */
+                    if (n < bits || (n == bits && s->mask != width_mask)) {
+                        return -1;
+                    }
+                    if (n == bits) {
+                        s->is_signed = 1;
+                    }
+                } else if (n < bits) {
+                    s->mask &= (1u << n) - 1;
+                    s->is_signed = 0;
+                } else if (n == bits) {
+                    s->is_signed = 0;
+                } else if (s->is_signed) {
+                    return -1;  /* Would keep copies of the sign bit */
+                }
+                break;
+            }
+            case AX_BIT_AND: {
+                if (sp < 2) {
+                    return -1;
+                }
+                ax_sym_t *a = &stack[sp - 2], *b = &stack[sp - 1];
+                if (a->kind == SYM_CONST && b->kind == SYM_VAR) {
+                    ax_sym_t t = *a; *a = *b; *b = t;
+                }
+                if (a->kind != SYM_VAR || b->kind != SYM_CONST ||
+                    b->value < 0 || (uint64_t)b->value > width_mask) {
+                    return -1;
+                }
+                a->mask &= (uint32_t)b->value;
+                a->is_signed = 0;
+                sp--;
+                break;
+            }
+            case AX_EQUAL: {
+                if (sp < 2) {
+                    return -1;
+                }
+                ax_sym_t *a = &stack[sp - 2], *b = &stack[sp - 1];
+                if (a->kind == SYM_CONST && b->kind == SYM_VAR) {
+                    ax_sym_t t = *a; *a = *b; *b = t;
+                }
+                if (a->kind != SYM_VAR || b->kind != SYM_CONST) {
+                    return -1;
+                }
+                /* A constant the variable can never equal isn't a match */
+                int64_t c = b->value;
+                int64_t lo = a->is_signed ? -((int64_t)1 << (bits - 1)) : 0;
+                int64_t hi = a->is_signed ? ((int64_t)1 << (bits - 1)) - 1 : (int64_t)width_mask;
+                if (c < lo || c > hi || ((uint32_t)c & width_mask & ~a->mask) != 0) {
+                    return -1;
+                }
+                a->kind = SYM_MATCH;
+                a->value = (int64_t)((uint32_t)c & width_mask);
+                sp--;
+                break;
+            }
+            case AX_END:
+                if (sp != 1 || stack[0].kind != SYM_MATCH) {
+                    return -1;
+                }
+                *value = (uint32_t)stack[0].value;
+                *mask = stack[0].mask;
+                return 0;
+            default:
+                return -1;
+        }
+    }
+    return -1;
+}
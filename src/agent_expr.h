@@ -0,0 +1,62 @@
+/*
+ * GDB Agent Expression Evaluator for OpenLink ColdFire
+ *
+ * Evaluates the bytecode GDB sends with conditional breakpoints
+ * (Z0-Z4 packets with a cond_list, enabled by ConditionalBreakpoints+).
+ * Only the subset that makes sense for condition evaluation is supported:
+ * integer arithmetic, comparisons, branches, register and memory references.
+ * Floating point, trace state variables and printf are rejected.
+ *
+ * Bytecode reference:
+ *   https://sourceware.org/gdb/current/onlinedocs/gdb/Agent-Expressions.html
+ *
+ * License: GPL v3
+ */
+
+#ifndef AGENT_EXPR_H
+#define AGENT_EXPR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Limits */
+#define AX_STACK_SIZE   100     /* Maximum evaluation stack depth */
+#define AX_MAX_STEPS    10000   /* Guard against looping expressions */
+
+/* Target access used while evaluating an expression */
+typedef struct {
+    /* Read GDB register 'regnum', return 0 on success */
+    int (*read_reg)(void *ctx, int regnum, uint32_t *value);
+    /* Read 'len' bytes of target memory, return 0 on success */
+    int (*read_mem)(void *ctx, uint32_t addr, uint8_t *buf, uint32_t len);
+    void *ctx;
+} ax_target_t;
+
+/*
+ * Evaluate an agent expression
+ *
+ * @param code      Bytecode
+ * @param len       Bytecode length in bytes
+ * @param target    Register/memory accessors
+ * @param result    Output: value on top of the stack at 'end'
+ * @return          0 on success, -1 on error (bad opcode, stack fault,
+ *                  division by zero, target access failure)
+ */
+int ax_eval(const uint8_t *code, size_t len, const ax_target_t *target,
+            int64_t *result);
+
+/*
+ * Recognise a condition the data comparator can evaluate in hardware
+ *
+ * Matches "var == const" and "(var & const) == const", in either operand
+ * order and with GDB's ext/zero_ext, where var is the 'size' byte
+ * variable at 'addr'. Anything else is left to ax_eval().
+ *
+ * @param value     Output: value the variable must hold
+ * @param mask      Output: bits of 'value' that are compared
+ * @return          0 if the condition is such a comparison, -1 otherwise
+ */
+int ax_match_compare(const uint8_t *code, size_t len, uint32_t addr,
+                     uint32_t size, uint32_t *value, uint32_t *mask);
+
+#endif /* AGENT_EXPR_H */
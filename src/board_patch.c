@@ -0,0 +1,284 @@
+/*
+ * Per-Board Patch Records for OpenLink ColdFire
+ *
+ * Builds the serial/calibration record that is programmed on top of the
+ * base image for each board.
+ *
+ * License: GPL v3
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include "board_patch.h"
+#include "log.h"
+
+#define PATCH_LINE_MAX  1024
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return s;
+}
+
+/* Parse "u32,str8,..." into p->fields and p->size */
+static int parse_format(board_patch_t *p, const char *format) {
+    char buf[PATCH_LINE_MAX];
+    snprintf(buf, sizeof(buf), "%s", format);
+
+    p->num_fields = 0;
+    p->size = 0;
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        tok = trim(tok);
+        if (p->num_fields == PATCH_MAX_FIELDS) {
+            LOG_ERROR(LOG_TOOL, "Patch format: more than %d fields\n", PATCH_MAX_FIELDS);
+            return -1;
+        }
+
+        patch_field_t *f = &p->fields[p->num_fields];
+        char *end = NULL;
+        if (strcmp(tok, "u8") == 0) {
+            f->type = PATCH_U8;  f->size = 1;
+        } else if (strcmp(tok, "u16") == 0) {
+            f->type = PATCH_U16; f->size = 2;
+        } else if (strcmp(tok, "u32") == 0) {
+            f->type = PATCH_U32; f->size = 4;
+        } else if (strncmp(tok, "str", 3) == 0) {
+            f->type = PATCH_STR; f->size = strtoul(tok + 3, &end, 10);
+        } else if (strncmp(tok, "hex", 3) == 0) {
+            f->type = PATCH_HEX; f->size = strtoul(tok + 3, &end, 10);
+        } else if (strncmp(tok, "pad", 3) == 0) {
+            f->type = PATCH_PAD; f->size = strtoul(tok + 3, &end, 10);
+        } else {
+            f->size = 0;
+        }
+        if ((end && (end == tok + 3 || *end != '\0')) || f->size == 0) {
+            LOG_ERROR(LOG_TOOL, "Patch format: bad field '%s'\n", tok);
+            return -1;
+        }
+
+        p->size += f->size;
+        p->num_fields++;
+    }
+
+    if (p->num_fields == 0 || p->size > PATCH_MAX_SIZE) {
+        LOG_ERROR(LOG_TOOL, "Patch format: record must be 1-%d bytes\n", PATCH_MAX_SIZE);
+        return -1;
+    }
+    return 0;
+}
+
+static int load_csv(board_patch_t *p, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        LOG_ERROR(LOG_TOOL, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    char line[PATCH_LINE_MAX];
+    while (fgets(line, sizeof(line), f)) {
+        char *s = trim(line);
+        if (*s == '\0' || *s == '#') {
+            continue;
+        }
+        char **rows = realloc(p->rows, (p->num_rows + 1) * sizeof(*rows));
+        if (!rows || !(rows[p->num_rows] = strdup(s))) {
+            fclose(f);
+            return -1;
+        }
+        p->rows = rows;
+        p->num_rows++;
+    }
+    fclose(f);
+
+    if (p->num_rows == 0) {
+        LOG_ERROR(LOG_TOOL, "%s: no rows\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static void load_state(board_patch_t *p) {
+    FILE *f = fopen(p->state_path, "r");
+    if (!f) {
+        return;     /* First run */
+    }
+    unsigned long index;
+    if (fscanf(f, "%lu", &index) == 1) {
+        p->index = index;
+    }
+    fclose(f);
+}
+
+int patch_init(board_patch_t *p, uint32_t addr, const char *format, const char *csv_path,
+               int use_counter, uint32_t counter_start, const char *state_path) {
+    memset(p, 0, sizeof(*p));
+    p->addr = addr;
+    p->use_counter = use_counter;
+    p->counter_start = counter_start;
+    p->state_path = state_path;
+
+    if (!csv_path && !use_counter) {
+        LOG_ERROR(LOG_TOOL, "Patch: needs a CSV file or a counter\n");
+        return -1;
+    }
+    if (csv_path && load_csv(p, csv_path) != 0) {
+        patch_free(p);
+        return -1;
+    }
+
+    /* Default: the counter as u32, CSV rows as one hex column */
+    char def[64] = "";
+    if (!format) {
+        if (use_counter) {
+            strcat(def, "u32");
+        }
+        if (p->rows) {
+            char first[PATCH_LINE_MAX];
+            snprintf(first, sizeof(first), "%s", p->rows[0]);
+            first[strcspn(first, ",")] = '\0';
+            snprintf(def + strlen(def), sizeof(def) - strlen(def), "%shex%zu",
+                     use_counter ? "," : "", strlen(trim(first)) / 2);
+        }
+        format = def;
+    }
+    if (parse_format(p, format) != 0) {
+        patch_free(p);
+        return -1;
+    }
+
+    if (state_path) {
+        load_state(p);
+    }
+    return 0;
+}
+
+/* Encode one value into its field */
+static int encode_field(const patch_field_t *f, const char *value, uint8_t *out) {
+    char *end;
+    unsigned long v;
+
+    switch (f->type) {
+    case PATCH_U8:
+    case PATCH_U16:
+    case PATCH_U32:
+        v = strtoul(value, &end, 0);
+        if (*value == '\0' || *end != '\0' || (f->size < 4 && v >> (f->size * 8)) || v > 0xFFFFFFFFUL) {
+            return -1;
+        }
+        for (uint32_t i = 0; i < f->size; i++) {
+            out[i] = v >> ((f->size - 1 - i) * 8);
+        }
+        return 0;
+
+    case PATCH_STR:
+        if (strlen(value) > f->size) {
+            return -1;
+        }
+        memset(out, 0, f->size);
+        memcpy(out, value, strlen(value));
+        return 0;
+
+    case PATCH_HEX:
+        if (strlen(value) != f->size * 2) {
+            return -1;
+        }
+        for (uint32_t i = 0; i < f->size; i++) {
+            unsigned int byte;
+            if (!isxdigit((unsigned char)value[2 * i]) || !isxdigit((unsigned char)value[2 * i + 1]) ||
+                sscanf(value + 2 * i, "%2x", &byte) != 1) {
+                return -1;
+            }
+            out[i] = byte;
+        }
+        return 0;
+
+    case PATCH_PAD:
+        break;
+    }
+    return -1;
+}
+
+int patch_build(const board_patch_t *p, uint8_t *record, char *desc, int desc_size) {
+    char row[PATCH_LINE_MAX] = "";
+    char counter[16];
+    char *values[PATCH_MAX_FIELDS];
+    int num_values = 0;
+
+    if (p->use_counter) {
+        snprintf(counter, sizeof(counter), "%u", p->counter_start + p->index);
+        values[num_values++] = counter;
+    }
+    if (p->rows) {
+        if (p->index >= (uint32_t)p->num_rows) {
+            return 1;
+        }
+        snprintf(row, sizeof(row), "%s", p->rows[p->index]);
+        for (char *tok = strtok(row, ","); tok && num_values < PATCH_MAX_FIELDS; tok = strtok(NULL, ",")) {
+            values[num_values++] = trim(tok);
+        }
+    }
+
+    if (desc && desc_size > 0) {
+        desc[0] = '\0';
+    }
+
+    uint8_t *out = record;
+    int v = 0;
+    for (int i = 0; i < p->num_fields; i++) {
+        const patch_field_t *f = &p->fields[i];
+        if (f->type == PATCH_PAD) {
+            memset(out, 0xFF, f->size);
+        } else if (v >= num_values) {
+            LOG_ERROR(LOG_TOOL, "Patch: board %u has too few values\n", p->index);
+            return -1;
+        } else {
+            if (encode_field(f, values[v], out) != 0) {
+                LOG_ERROR(LOG_TOOL, "Patch: value '%s' does not fit field %d\n", values[v], i + 1);
+                return -1;
+            }
+            if (desc && desc_size > 0) {
+                int used = strlen(desc);
+                snprintf(desc + used, desc_size - used, "%s%s", v ? "," : "", values[v]);
+            }
+            v++;
+        }
+        out += f->size;
+    }
+    return 0;
+}
+
+int patch_commit(board_patch_t *p) {
+    p->index++;
+    if (!p->state_path) {
+        return 0;
+    }
+
+    /* Write-and-rename so a crash never leaves a truncated index */
+    char tmp[PATCH_LINE_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", p->state_path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        LOG_ERROR(LOG_TOOL, "%s: %s\n", tmp, strerror(errno));
+        return -1;
+    }
+    fprintf(f, "%u\n", p->index);
+    if (fclose(f) != 0 || rename(tmp, p->state_path) != 0) {
+        LOG_ERROR(LOG_TOOL, "%s: %s\n", p->state_path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void patch_free(board_patch_t *p) {
+    for (int i = 0; i < p->num_rows; i++) {
+        free(p->rows[i]);
+    }
+    free(p->rows);
+    p->rows = NULL;
+    p->num_rows = 0;
+}
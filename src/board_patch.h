@@ -0,0 +1,93 @@
+/*
+ * Per-Board Patch Records for OpenLink ColdFire
+ *
+ * On a production line every board gets the same base image plus a small
+ * record (serial number, calibration data) at a fixed flash address. The
+ * record is built from a field format and, per board, a row of values:
+ *
+ *   --patch-format u32,str8,hex4
+ *
+ *   u8 u16 u32     Big-endian integer (decimal or 0x hex)
+ *   strN           ASCII string, zero-padded/truncated to N bytes
+ *   hexN           N raw bytes given as hex digits
+ *   padN           N bytes of 0xFF, consumes no value
+ *
+ * The values come from a counter (one value, start + board index), from
+ * one CSV line per board ('#' lines and blank lines are skipped), or both,
+ * in which case the counter is the first value and the CSV columns follow.
+ * An optional state file keeps the board index across runs so a restarted
+ * session continues with the next serial.
+ *
+ * License: GPL v3
+ */
+
+#ifndef BOARD_PATCH_H
+#define BOARD_PATCH_H
+
+#include <stdint.h>
+
+/* Limits */
+#define PATCH_MAX_FIELDS    16
+#define PATCH_MAX_SIZE      256     /* Bytes in one record */
+
+typedef enum {
+    PATCH_U8,
+    PATCH_U16,
+    PATCH_U32,
+    PATCH_STR,
+    PATCH_HEX,
+    PATCH_PAD
+} patch_field_type_t;
+
+typedef struct {
+    patch_field_type_t type;
+    uint32_t size;                  /* Bytes in the record */
+} patch_field_t;
+
+typedef struct {
+    uint32_t addr;                  /* Record address in flash */
+    uint32_t size;                  /* Record size */
+    patch_field_t fields[PATCH_MAX_FIELDS];
+    int num_fields;
+
+    int use_counter;
+    uint32_t counter_start;
+    char **rows;                    /* CSV lines, NULL without a CSV */
+    int num_rows;
+
+    const char *state_path;         /* NULL = don't persist */
+    uint32_t index;                 /* Boards done so far */
+} board_patch_t;
+
+/*
+ * Set up a patch
+ *
+ * @param p             Patch to initialize (free with patch_free())
+ * @param addr          Record address
+ * @param format        Field list, NULL = "u32" for a counter, "hexN" sized
+ *                      from the first CSV row otherwise
+ * @param csv_path      CSV with one row per board, or NULL
+ * @param use_counter   Non-zero to take the first value from the counter
+ * @param counter_start Counter value for board index 0
+ * @param state_path    File holding the board index, or NULL
+ * @return              0 on success, -1 on error (message on stderr)
+ */
+int patch_init(board_patch_t *p, uint32_t addr, const char *format, const char *csv_path,
+               int use_counter, uint32_t counter_start, const char *state_path);
+
+/*
+ * Build the record for the current board index
+ *
+ * @param record        Output, p->size bytes
+ * @param desc          Output, printable summary of the values (may be NULL)
+ * @return              0 on success, 1 if the CSV has no more rows,
+ *                      -1 if a value does not fit its field
+ */
+int patch_build(const board_patch_t *p, uint8_t *record, char *desc, int desc_size);
+
+/* Advance to the next board and update the state file */
+int patch_commit(board_patch_t *p);
+
+void patch_free(board_patch_t *p);
+
+#endif /* BOARD_PATCH_H */
@@ -18,8 +18,10 @@
 /* ELF header structures (32-bit big-endian) */
 #define ELF_MAGIC       0x7F454C46  /* "\x7FELF" */
 #define ET_EXEC         2           /* Executable file */
+#define ET_CORE         4           /* Core file */
 #define EM_68K          4           /* Motorola 68K */
 #define PT_LOAD         1           /* Loadable segment */
+#define PT_NOTE         4           /* Auxiliary information */
 
 typedef struct {
     uint8_t  e_ident[16];
@@ -542,3 +544,446 @@ int file_get_contiguous(const loaded_file_t *file, uint32_t *base_addr,
 
     return 0;
 }
+
+/*
+ * Streaming memory image writer
+ */
+
+#define SREC_RECORD_BYTES   32
+
+typedef struct {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint32_t sh_flags;
+    uint32_t sh_addr;
+    uint32_t sh_offset;
+    uint32_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint32_t sh_addralign;
+    uint32_t sh_entsize;
+} __attribute__((packed)) Elf32_Shdr;
+
+#define SHT_PROGBITS    1
+#define SHT_STRTAB      3
+#define SHF_WRITE       0x1
+#define SHF_ALLOC       0x2
+#define PF_R            0x4
+#define PF_W            0x2
+
+/* Section names: "", ".data", ".shstrtab" */
+static const char elf_shstrtab[] = "\0.data\0.shstrtab";
+#define ELF_DATA_OFFSET (sizeof(Elf32_Ehdr) + sizeof(Elf32_Phdr))
+
+/* One S-Record line; type 0/3/7 use 2/4/4 address bytes */
+static int srec_write_record(FILE *f, int type, uint32_t addr, const uint8_t *data, uint32_t len) {
+    int addr_bytes = (type == 0) ? 2 : 4;
+    uint8_t count = addr_bytes + len + 1;
+    uint8_t sum = count;
+
+    fprintf(f, "S%d%02X", type, count);
+    for (int i = addr_bytes - 1; i >= 0; i--) {
+        uint8_t b = addr >> (i * 8);
+        fprintf(f, "%02X", b);
+        sum += b;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        fprintf(f, "%02X", data[i]);
+        sum += data[i];
+    }
+    fprintf(f, "%02X\n", (uint8_t)~sum);
+    return ferror(f) ? -1 : 0;
+}
+
+static int elf_write_header(file_writer_t *w, uint32_t addr, uint32_t size) {
+    Elf32_Ehdr ehdr;
+    Elf32_Phdr phdr;
+
+    /* Section header table after the data and the name table */
+    w->trailer_off = (ELF_DATA_OFFSET + size + sizeof(elf_shstrtab) + 3) & ~3u;
+
+    memset(&ehdr, 0, sizeof(ehdr));
+    memcpy(ehdr.e_ident, "\x7F" "ELF", 4);
+    ehdr.e_ident[4] = 1;        /* ELFCLASS32 */
+    ehdr.e_ident[5] = 2;        /* ELFDATA2MSB */
+    ehdr.e_ident[6] = 1;        /* EV_CURRENT */
+    ehdr.e_type = be16(ET_EXEC);
+    ehdr.e_machine = be16(EM_68K);
+    ehdr.e_version = be32(1);
+    ehdr.e_entry = be32(0);
+    ehdr.e_phoff = be32(sizeof(Elf32_Ehdr));
+    ehdr.e_shoff = be32(w->trailer_off);
+    ehdr.e_ehsize = be16(sizeof(Elf32_Ehdr));
+    ehdr.e_phentsize = be16(sizeof(Elf32_Phdr));
+    ehdr.e_phnum = be16(1);
+    ehdr.e_shentsize = be16(sizeof(Elf32_Shdr));
+    ehdr.e_shnum = be16(3);
+    ehdr.e_shstrndx = be16(2);
+
+    memset(&phdr, 0, sizeof(phdr));
+    phdr.p_type = be32(PT_LOAD);
+    phdr.p_offset = be32(ELF_DATA_OFFSET);
+    phdr.p_vaddr = be32(addr);
+    phdr.p_paddr = be32(addr);
+    phdr.p_filesz = be32(size);
+    phdr.p_memsz = be32(size);
+    phdr.p_flags = be32(PF_R | PF_W);
+    phdr.p_align = be32(1);
+
+    if (fwrite(&ehdr, sizeof(ehdr), 1, w->f) != 1 || fwrite(&phdr, sizeof(phdr), 1, w->f) != 1) {
+        return -1;
+    }
+    return 0;
+}
+
+static int elf_write_trailer(file_writer_t *w, uint32_t addr, uint32_t size) {
+    Elf32_Shdr shdr[3];
+    uint32_t strtab_off = ELF_DATA_OFFSET + size;
+    static const uint8_t zero[4] = { 0 };
+
+    memset(shdr, 0, sizeof(shdr));
+    shdr[1].sh_name = be32(1);
+    shdr[1].sh_type = be32(SHT_PROGBITS);
+    shdr[1].sh_flags = be32(SHF_WRITE | SHF_ALLOC);
+    shdr[1].sh_addr = be32(addr);
+    shdr[1].sh_offset = be32(ELF_DATA_OFFSET);
+    shdr[1].sh_size = be32(size);
+    shdr[1].sh_addralign = be32(1);
+    shdr[2].sh_name = be32(7);
+    shdr[2].sh_type = be32(SHT_STRTAB);
+    shdr[2].sh_offset = be32(strtab_off);
+    shdr[2].sh_size = be32(sizeof(elf_shstrtab));
+    shdr[2].sh_addralign = be32(1);
+
+    uint32_t pad = w->trailer_off - strtab_off - sizeof(elf_shstrtab);
+    if (fwrite(elf_shstrtab, sizeof(elf_shstrtab), 1, w->f) != 1 ||
+        (pad && fwrite(zero, pad, 1, w->f) != 1) ||
+        fwrite(shdr, sizeof(shdr), 1, w->f) != 1) {
+        return -1;
+    }
+    return 0;
+}
+
+int file_writer_open(file_writer_t *w, const char *filename, uint32_t addr, uint32_t size) {
+    memset(w, 0, sizeof(*w));
+    w->start = addr;
+    w->addr = addr;
+    w->end = addr + size;
+
+    const char *ext = get_extension(filename);
+    if (strcasecmp(ext, "elf") == 0) {
+        w->format = FILE_FORMAT_ELF;
+    } else if (strcasecmp(ext, "s19") == 0 || strcasecmp(ext, "srec") == 0 ||
+               strcasecmp(ext, "s") == 0 || strcasecmp(ext, "mot") == 0) {
+        w->format = FILE_FORMAT_SREC;
+    } else {
+        w->format = FILE_FORMAT_BIN;
+    }
+
+    w->f = fopen(filename, w->format == FILE_FORMAT_SREC ? "w" : "wb");
+    if (!w->f) {
+        fprintf(stderr, "Error: Cannot create file '%s'\n", filename);
+        return -1;
+    }
+
+    int r = 0;
+    if (w->format == FILE_FORMAT_ELF) {
+        r = elf_write_header(w, addr, size);
+    } else if (w->format == FILE_FORMAT_SREC) {
+        r = srec_write_record(w->f, 0, 0, (const uint8_t *)"openlink", 8);
+    }
+    if (r != 0) {
+        fprintf(stderr, "Error: Cannot write '%s'\n", filename);
+        fclose(w->f);
+        w->f = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int file_writer_write(file_writer_t *w, const uint8_t *data, uint32_t len) {
+    if (len > w->end - w->addr) {
+        fprintf(stderr, "Error: Image data beyond the announced size\n");
+        return -1;
+    }
+
+    if (w->format != FILE_FORMAT_SREC) {
+        w->addr += len;
+        return fwrite(data, 1, len, w->f) == len ? 0 : -1;
+    }
+
+    /* Fill fixed-size records so the output does not depend on the block
+     * size the data arrives in
+     */
+    while (len > 0) {
+        uint32_t n = SREC_RECORD_BYTES - w->pending_len;
+        if (n > len) n = len;
+        memcpy(w->pending + w->pending_len, data, n);
+        w->pending_len += n;
+        w->addr += n;
+        data += n;
+        len -= n;
+
+        if (w->pending_len == SREC_RECORD_BYTES) {
+            if (srec_write_record(w->f, 3, w->addr - w->pending_len, w->pending, w->pending_len) != 0) {
+                return -1;
+            }
+            w->pending_len = 0;
+        }
+    }
+    return 0;
+}
+
+int file_writer_close(file_writer_t *w) {
+    int r = 0;
+
+    if (!w->f) {
+        return -1;
+    }
+    if (w->addr != w->end) {
+        fprintf(stderr, "Error: Image incomplete (%u bytes missing)\n", w->end - w->addr);
+        r = -1;
+    } else if (w->format == FILE_FORMAT_SREC) {
+        if (w->pending_len > 0) {
+            r = srec_write_record(w->f, 3, w->addr - w->pending_len, w->pending, w->pending_len);
+        }
+        if (r == 0) {
+            r = srec_write_record(w->f, 7, 0, NULL, 0);
+        }
+    } else if (w->format == FILE_FORMAT_ELF) {
+        r = elf_write_trailer(w, w->start, w->end - w->start);
+    }
+
+    if (fclose(w->f) != 0) {
+        r = -1;
+    }
+    w->f = NULL;
+    return r;
+}
+
+/* Note header; name and descriptor follow, each padded to 4 bytes */
+typedef struct {
+    uint32_t n_namesz;
+    uint32_t n_descsz;
+    uint32_t n_type;
+} __attribute__((packed)) Elf32_Nhdr;
+
+#define ALIGN4(x)   (((x) + 3) & ~3u)
+
+int file_write_core(const char *filename, const core_note_t *notes, int num_notes,
+                    const core_region_t *regions, int num_regions) {
+    static const uint8_t zero[4] = { 0 };
+    uint32_t notes_off = sizeof(Elf32_Ehdr) + (1 + num_regions) * sizeof(Elf32_Phdr);
+    uint32_t notes_size = 0;
+
+    for (int i = 0; i < num_notes; i++) {
+        notes_size += sizeof(Elf32_Nhdr) + ALIGN4(strlen(notes[i].name) + 1) + ALIGN4(notes[i].desc_size);
+    }
+
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot create file '%s'\n", filename);
+        return -1;
+    }
+
+    Elf32_Ehdr ehdr;
+    memset(&ehdr, 0, sizeof(ehdr));
+    memcpy(ehdr.e_ident, "\x7F" "ELF", 4);
+    ehdr.e_ident[4] = 1;        /* ELFCLASS32 */
+    ehdr.e_ident[5] = 2;        /* ELFDATA2MSB */
+    ehdr.e_ident[6] = 1;        /* EV_CURRENT */
+    ehdr.e_type = be16(ET_CORE);
+    ehdr.e_machine = be16(EM_68K);
+    ehdr.e_version = be32(1);
+    ehdr.e_phoff = be32(sizeof(Elf32_Ehdr));
+    ehdr.e_ehsize = be16(sizeof(Elf32_Ehdr));
+    ehdr.e_phentsize = be16(sizeof(Elf32_Phdr));
+    ehdr.e_phnum = be16(1 + num_regions);
+    int ok = fwrite(&ehdr, sizeof(ehdr), 1, f) == 1;
+
+    Elf32_Phdr phdr;
+    memset(&phdr, 0, sizeof(phdr));
+    phdr.p_type = be32(PT_NOTE);
+    phdr.p_offset = be32(notes_off);
+    phdr.p_filesz = be32(notes_size);
+    phdr.p_align = be32(4);
+    ok = ok && fwrite(&phdr, sizeof(phdr), 1, f) == 1;
+
+    uint32_t offset = notes_off + notes_size;
+    for (int i = 0; i < num_regions; i++) {
+        memset(&phdr, 0, sizeof(phdr));
+        phdr.p_type = be32(PT_LOAD);
+        phdr.p_offset = be32(offset);
+        phdr.p_vaddr = be32(regions[i].addr);
+        phdr.p_paddr = be32(regions[i].addr);
+        phdr.p_filesz = be32(regions[i].size);
+        phdr.p_memsz = be32(regions[i].size);
+        phdr.p_flags = be32(PF_R | PF_W);
+        phdr.p_align = be32(1);
+        ok = ok && fwrite(&phdr, sizeof(phdr), 1, f) == 1;
+        offset += regions[i].size;
+    }
+
+    for (int i = 0; i < num_notes && ok; i++) {
+        uint32_t name_size = strlen(notes[i].name) + 1;
+        Elf32_Nhdr nhdr = {
+            .n_namesz = be32(name_size),
+            .n_descsz = be32(notes[i].desc_size),
+            .n_type = be32(notes[i].type),
+        };
+        uint32_t name_pad = ALIGN4(name_size) - name_size;
+        uint32_t desc_pad = ALIGN4(notes[i].desc_size) - notes[i].desc_size;
+        ok = fwrite(&nhdr, sizeof(nhdr), 1, f) == 1 &&
+             fwrite(notes[i].name, name_size, 1, f) == 1 &&
+             (!name_pad || fwrite(zero, name_pad, 1, f) == 1) &&
+             (!notes[i].desc_size || fwrite(notes[i].desc, notes[i].desc_size, 1, f) == 1) &&
+             (!desc_pad || fwrite(zero, desc_pad, 1, f) == 1);
+    }
+
+    for (int i = 0; i < num_regions && ok; i++) {
+        ok = fwrite(regions[i].data, 1, regions[i].size, f) == regions[i].size;
+    }
+
+    if (fclose(f) != 0 || !ok) {
+        fprintf(stderr, "Error: Cannot write '%s'\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+/* Symbol table entry */
+typedef struct {
+    uint32_t st_name;
+    uint32_t st_value;
+    uint32_t st_size;
+    uint8_t  st_info;
+    uint8_t  st_other;
+    uint16_t st_shndx;
+} __attribute__((packed)) Elf32_Sym;
+
+#define SHT_SYMTAB      2
+#define STT_OBJECT      1
+#define STT_FUNC        2
+
+static int symbol_compare(const void *a, const void *b) {
+    const elf_symbol_t *sa = a, *sb = b;
+    return (sa->addr > sb->addr) - (sa->addr < sb->addr);
+}
+
+/* Read len bytes at offset into a new buffer */
+static void *read_at(FILE *f, uint32_t offset, uint32_t len) {
+    void *buf = malloc(len ? len : 1);
+    if (buf && (fseek(f, offset, SEEK_SET) != 0 || fread(buf, 1, len, f) != len)) {
+        free(buf);
+        buf = NULL;
+    }
+    return buf;
+}
+
+int file_load_symbols(const char *filename, symbol_table_t *tab) {
+    memset(tab, 0, sizeof(*tab));
+
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
+        return -1;
+    }
+
+    Elf32_Ehdr ehdr;
+    if (fread(&ehdr, 1, sizeof(ehdr), f) != sizeof(ehdr) ||
+        memcmp(ehdr.e_ident, "\x7F" "ELF", 4) != 0 || ehdr.e_ident[5] != 2) {
+        fprintf(stderr, "Error: %s is not a big-endian ELF file\n", filename);
+        fclose(f);
+        return -1;
+    }
+
+    uint32_t shoff = be32(ehdr.e_shoff);
+    uint16_t shnum = be16(ehdr.e_shnum);
+    Elf32_Shdr *shdr = shoff ? read_at(f, shoff, shnum * sizeof(Elf32_Shdr)) : NULL;
+    Elf32_Sym *syms = NULL;
+    uint32_t num_syms = 0;
+
+    for (int i = 0; shdr && i < shnum; i++) {
+        uint32_t link = be32(shdr[i].sh_link);
+        if (be32(shdr[i].sh_type) != SHT_SYMTAB || link >= shnum) {
+            continue;
+        }
+        num_syms = be32(shdr[i].sh_size) / sizeof(Elf32_Sym);
+        syms = read_at(f, be32(shdr[i].sh_offset), num_syms * sizeof(Elf32_Sym));
+        tab->strtab = read_at(f, be32(shdr[link].sh_offset), be32(shdr[link].sh_size) + 1);
+        if (tab->strtab) {
+            tab->strtab[be32(shdr[link].sh_size)] = '\0';
+        }
+        break;
+    }
+    free(shdr);
+    fclose(f);
+
+    if (!syms || !tab->strtab) {
+        fprintf(stderr, "Error: %s has no symbol table\n", filename);
+        free(syms);
+        symbol_table_free(tab);
+        return -1;
+    }
+
+    tab->syms = calloc(num_syms ? num_syms : 1, sizeof(elf_symbol_t));
+    if (!tab->syms) {
+        free(syms);
+        symbol_table_free(tab);
+        return -1;
+    }
+    for (uint32_t i = 0; i < num_syms; i++) {
+        int type = syms[i].st_info & 0xF;
+        uint32_t name = be32(syms[i].st_name);
+        if ((type != STT_FUNC && type != STT_OBJECT) || name == 0 || be16(syms[i].st_shndx) == 0) {
+            continue;
+        }
+        elf_symbol_t *sym = &tab->syms[tab->count++];
+        sym->name = tab->strtab + name;
+        sym->addr = be32(syms[i].st_value);
+        sym->size = be32(syms[i].st_size);
+        sym->is_func = (type == STT_FUNC);
+    }
+    free(syms);
+
+    qsort(tab->syms, tab->count, sizeof(elf_symbol_t), symbol_compare);
+    return 0;
+}
+
+const elf_symbol_t *symbol_find(const symbol_table_t *tab, const char *name) {
+    for (int i = 0; i < tab->count; i++) {
+        if (strcmp(tab->syms[i].name, name) == 0) {
+            return &tab->syms[i];
+        }
+    }
+    return NULL;
+}
+
+const elf_symbol_t *symbol_at(const symbol_table_t *tab, uint32_t addr) {
+    /* Last symbol at or below addr, then walk back to a function covering it */
+    int lo = 0, hi = tab->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (tab->syms[mid].addr <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (int i = lo - 1; i >= 0; i--) {
+        const elf_symbol_t *sym = &tab->syms[i];
+        if (sym->is_func && addr < sym->addr + (sym->size ? sym->size : 1)) {
+            return sym;
+        }
+        if (sym->is_func && sym->size) {
+            break;      /* Functions don't overlap */
+        }
+    }
+    return NULL;
+}
+
+void symbol_table_free(symbol_table_t *tab) {
+    free(tab->syms);
+    free(tab->strtab);
+    memset(tab, 0, sizeof(*tab));
+}
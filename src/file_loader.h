@@ -6,6 +6,8 @@
  * - .elf  - ELF executable (uses embedded load addresses)
  * - .s19, .srec - Motorola S-Record
  *
+ * and writing memory images in the same formats.
+ *
  * License: GPL v3
  */
 
@@ -14,6 +16,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdio.h>
 
 /* File format types */
 typedef enum {
@@ -114,4 +117,106 @@ void file_print_info(const loaded_file_t *file);
 int file_get_contiguous(const loaded_file_t *file, uint32_t *base_addr,
                         uint8_t **data_out, uint32_t *size_out);
 
+/*
+ * Streaming memory image writer
+ * Writes target memory read in blocks to a .bin, .srec/.s19 or .elf file
+ * without holding the whole image. The format follows the extension;
+ * anything unrecognised is written as raw binary.
+ */
+typedef struct {
+    FILE *f;
+    file_format_t format;
+    uint32_t start;         /* Address of the first byte */
+    uint32_t addr;          /* Address of the next byte */
+    uint32_t end;           /* Address after the last byte */
+    uint32_t trailer_off;   /* ELF: offset of the section header table */
+    uint8_t pending[32];    /* S-Record: bytes of the unfinished record */
+    uint32_t pending_len;
+} file_writer_t;
+
+/*
+ * Create an image file for addr..addr+size
+ *
+ * @param w             Writer state
+ * @param filename      Output path
+ * @param addr          Address of the first byte
+ * @param size          Bytes that will be written
+ * @return              0 on success, -1 on error
+ */
+int file_writer_open(file_writer_t *w, const char *filename, uint32_t addr, uint32_t size);
+
+/* Append the next len bytes */
+int file_writer_write(file_writer_t *w, const uint8_t *data, uint32_t len);
+
+/* Finish the file; fails if fewer bytes than announced were written */
+int file_writer_close(file_writer_t *w);
+
+/*
+ * ELF core file
+ * Writes an ET_CORE file with one PT_NOTE segment holding the notes and
+ * one PT_LOAD segment per memory region, for loading next to the firmware
+ * ELF in GDB.
+ */
+typedef struct {
+    const char *name;       /* Owner, e.g. "CORE" */
+    uint32_t type;          /* e.g. NT_PRSTATUS */
+    const void *desc;
+    uint32_t desc_size;
+} core_note_t;
+
+typedef struct {
+    uint32_t addr;
+    uint32_t size;
+    const uint8_t *data;
+} core_region_t;
+
+#define NT_PRSTATUS         1
+
+/*
+ * Write a core file
+ *
+ * @param filename      Output path
+ * @param notes         Notes, in file order
+ * @param num_notes     Number of notes
+ * @param regions       Memory regions, in file order
+ * @param num_regions   Number of regions
+ * @return              0 on success, -1 on error
+ */
+int file_write_core(const char *filename, const core_note_t *notes, int num_notes,
+                    const core_region_t *regions, int num_regions);
+
+/*
+ * ELF symbol table
+ * Function and object symbols of a firmware ELF, sorted by address.
+ */
+typedef struct {
+    const char *name;
+    uint32_t addr;
+    uint32_t size;
+    int is_func;            /* STT_FUNC, otherwise STT_OBJECT */
+} elf_symbol_t;
+
+typedef struct {
+    elf_symbol_t *syms;
+    int count;
+    char *strtab;           /* Backing store for the names */
+} symbol_table_t;
+
+/*
+ * Load the function and object symbols of an ELF file
+ *
+ * @param filename      ELF file
+ * @param tab           Output (free with symbol_table_free())
+ * @return              0 on success, -1 on error
+ */
+int file_load_symbols(const char *filename, symbol_table_t *tab);
+
+/* Symbol by name, or NULL */
+const elf_symbol_t *symbol_find(const symbol_table_t *tab, const char *name);
+
+/* Function containing addr, or NULL */
+const elf_symbol_t *symbol_at(const symbol_table_t *tab, uint32_t addr);
+
+void symbol_table_free(symbol_table_t *tab);
+
 #endif /* FILE_LOADER_H */
@@ -12,6 +12,7 @@
 #include "flash_gpl.h"
 #include "elf_loader.h"
 #include "openlink_protocol.h"
+#include "log.h"
 
 int gpl_flash_init(gpl_flash_state_t *state, libusb_device_handle *handle,
                    const char *flashloader)
@@ -46,54 +47,53 @@ int gpl_flash_init(gpl_flash_state_t *state, libusb_device_handle *handle,
     }
 
     if (!state->flashloader_path) {
-        fprintf(stderr, "Flash: Out of memory\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Out of memory\n");
         return -1;
     }
 
     /* Allocate internal state */
     state->loader_state = malloc(sizeof(simple_flash_state_t));
     if (!state->loader_state) {
-        fprintf(stderr, "Flash: Out of memory\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Out of memory\n");
         free(state->flashloader_path);
         state->flashloader_path = NULL;
         return -1;
     }
 
     /* Initialize target SRAM */
-    printf("Flash: Initializing target SRAM...\n");
+    LOG_INFO(LOG_FLASH, "Flash: Initializing target SRAM...\n");
     int r = sram_init_full(handle);
     if (r != 0) {
-        fprintf(stderr, "Flash: Failed to initialize SRAM\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Failed to initialize SRAM\n");
         gpl_flash_cleanup(state);
         return -1;
     }
 
     /* Load flashloader ELF */
-    printf("Flash: Loading %s...\n", state->flashloader_path);
+    LOG_INFO(LOG_FLASH, "Flash: Loading %s...\n", state->flashloader_path);
     simple_flash_state_t *sstate = (simple_flash_state_t *)state->loader_state;
     r = simple_flash_init(handle, state->flashloader_path, sstate);
     if (r != 0) {
-        fprintf(stderr, "Flash: Failed to load flashloader\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Failed to load flashloader\n");
         gpl_flash_cleanup(state);
         return -1;
     }
 
-    printf("Flash: Flashloader loaded (entry=0x%08X, size=%u bytes)\n",
-           sstate->elf.entry_point, sstate->elf.data_size);
+    LOG_INFO(LOG_FLASH, "Flash: Flashloader loaded (entry=0x%08X, size=%u bytes)\n",
+             sstate->elf.entry_point, sstate->elf.data_size);
 
     /* Run init operation (Op 0) */
-    printf("Flash: Initializing flash module...\n");
-    fflush(stdout);
+    LOG_INFO(LOG_FLASH, "Flash: Initializing flash module...\n");
     uint32_t result;
     r = simple_flash_run_op(handle, sstate, FLASH_OP_INIT, 0, 0, &result);
     if (r != 0 || result != FLASH_RESULT_SUCCESS) {
-        fprintf(stderr, "Flash: Init failed (result=0x%08X)\n", result);
+        LOG_ERROR(LOG_FLASH, "Flash: Init failed (result=0x%08X)\n", result);
         gpl_flash_cleanup(state);
         return -1;
     }
 
     state->initialized = 1;
-    printf("Flash: Initialized successfully\n");
+    LOG_INFO(LOG_FLASH, "Flash: Initialized successfully\n");
     return 0;
 }
 
@@ -120,16 +120,16 @@ void gpl_flash_cleanup(gpl_flash_state_t *state)
 int gpl_flash_mass_erase(gpl_flash_state_t *state)
 {
     if (!state || !state->initialized) {
-        fprintf(stderr, "Flash: Not initialized\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Not initialized\n");
         return -1;
     }
 
-    printf("Flash: Mass erasing entire flash (256KB)...\n");
+    LOG_INFO(LOG_FLASH, "Flash: Mass erasing entire flash (256KB)...\n");
 
     simple_flash_state_t *sstate = (simple_flash_state_t *)state->loader_state;
     int r = simple_flash_mass_erase(state->usb_handle, sstate);
     if (r != 0) {
-        fprintf(stderr, "Flash: Mass erase failed\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Mass erase failed\n");
         return -1;
     }
 
@@ -138,47 +138,47 @@ int gpl_flash_mass_erase(gpl_flash_state_t *state)
         state->erased_sectors[i] = 1;
     }
 
-    printf("Flash: Mass erase complete\n");
+    LOG_INFO(LOG_FLASH, "Flash: Mass erase complete\n");
     return 0;
 }
 
 int gpl_flash_erase_sector(gpl_flash_state_t *state, int sector_num)
 {
     if (!state || !state->initialized) {
-        fprintf(stderr, "Flash: Not initialized\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Not initialized\n");
         return -1;
     }
 
     if (sector_num < 0 || sector_num >= FLASH_NUM_SECTORS) {
-        fprintf(stderr, "Flash: Invalid sector number %d\n", sector_num);
+        LOG_ERROR(LOG_FLASH, "Flash: Invalid sector number %d\n", sector_num);
         return -1;
     }
 
     uint32_t sector_addr = sector_num * FLASH_SECTOR_SIZE;
-    printf("Flash: Erasing sector %d (0x%08X)...\n", sector_num, sector_addr);
+    LOG_INFO(LOG_FLASH, "Flash: Erasing sector %d (0x%08X)...\n", sector_num, sector_addr);
 
     simple_flash_state_t *sstate = (simple_flash_state_t *)state->loader_state;
     int r = simple_flash_erase_sector(state->usb_handle, sstate, sector_addr);
     if (r != 0) {
-        fprintf(stderr, "Flash: Sector erase failed\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Sector erase failed\n");
         return -1;
     }
 
     state->erased_sectors[sector_num] = 1;
-    printf("Flash: Sector %d erased\n", sector_num);
+    LOG_INFO(LOG_FLASH, "Flash: Sector %d erased\n", sector_num);
     return 0;
 }
 
 int gpl_flash_erase_range(gpl_flash_state_t *state, uint32_t start_addr, uint32_t length)
 {
     if (!state || !state->initialized) {
-        fprintf(stderr, "Flash: Not initialized\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Not initialized\n");
         return -1;
     }
 
     if (start_addr + length > FLASH_SIZE) {
-        fprintf(stderr, "Flash: Address range 0x%08X-0x%08X exceeds flash size\n",
-                start_addr, start_addr + length);
+        LOG_ERROR(LOG_FLASH, "Flash: Address range 0x%08X-0x%08X exceeds flash size\n",
+                  start_addr, start_addr + length);
         return -1;
     }
 
@@ -186,13 +186,13 @@ int gpl_flash_erase_range(gpl_flash_state_t *state, uint32_t start_addr, uint32_
     int start_sector = start_addr / FLASH_SECTOR_SIZE;
     int end_sector = (start_addr + length + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
 
-    printf("Flash: Erasing sectors %d-%d (0x%08X-0x%08X)...\n",
-           start_sector, end_sector - 1, start_addr, start_addr + length);
+    LOG_INFO(LOG_FLASH, "Flash: Erasing sectors %d-%d (0x%08X-0x%08X)...\n",
+             start_sector, end_sector - 1, start_addr, start_addr + length);
 
     for (int s = start_sector; s < end_sector; s++) {
         /* Skip already erased sectors */
         if (state->erased_sectors[s]) {
-            printf("Flash: Sector %d already erased, skipping\n", s);
+            LOG_INFO(LOG_FLASH, "Flash: Sector %d already erased, skipping\n", s);
             continue;
         }
 
@@ -202,7 +202,7 @@ int gpl_flash_erase_range(gpl_flash_state_t *state, uint32_t start_addr, uint32_
         }
     }
 
-    printf("Flash: Range erase complete\n");
+    LOG_INFO(LOG_FLASH, "Flash: Range erase complete\n");
     return 0;
 }
 
@@ -210,7 +210,7 @@ int gpl_flash_program(gpl_flash_state_t *state, uint32_t addr,
                       const uint8_t *data, uint32_t length)
 {
     if (!state || !state->initialized) {
-        fprintf(stderr, "Flash: Not initialized\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Not initialized\n");
         return -1;
     }
 
@@ -219,12 +219,12 @@ int gpl_flash_program(gpl_flash_state_t *state, uint32_t addr,
     }
 
     if (addr + length > FLASH_SIZE) {
-        fprintf(stderr, "Flash: Address range 0x%08X-0x%08X exceeds flash size\n",
-                addr, addr + length);
+        LOG_ERROR(LOG_FLASH, "Flash: Address range 0x%08X-0x%08X exceeds flash size\n",
+                  addr, addr + length);
         return -1;
     }
 
-    printf("Flash: Programming %u bytes at 0x%08X...\n", length, addr);
+    LOG_INFO(LOG_FLASH, "Flash: Programming %u bytes at 0x%08X...\n", length, addr);
 
     simple_flash_state_t *sstate = (simple_flash_state_t *)state->loader_state;
 
@@ -239,27 +239,26 @@ int gpl_flash_program(gpl_flash_state_t *state, uint32_t addr,
         int r = simple_flash_program(state->usb_handle, sstate,
                                      addr + offset, data + offset, chunk_size);
         if (r != 0) {
-            fprintf(stderr, "Flash: Programming failed at offset 0x%08X\n", offset);
+            LOG_ERROR(LOG_FLASH, "Flash: Programming failed at offset 0x%08X\n", offset);
             return -1;
         }
 
         offset += chunk_size;
-        printf("Flash: Programmed %u/%u bytes\r", offset, length);
-        fflush(stdout);
+        LOG_DEBUG(LOG_FLASH, "Flash: Programmed %u/%u bytes\n", offset, length);
     }
 
-    printf("\nFlash: Programming complete\n");
+    LOG_INFO(LOG_FLASH, "Flash: Programming complete\n");
     return 0;
 }
 
 int gpl_flash_blank_check(gpl_flash_state_t *state, uint32_t addr, uint32_t length)
 {
     if (!state || !state->initialized) {
-        fprintf(stderr, "Flash: Not initialized\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Not initialized\n");
         return -1;
     }
 
-    printf("Flash: Blank checking 0x%08X-0x%08X...\n", addr, addr + length);
+    LOG_INFO(LOG_FLASH, "Flash: Blank checking 0x%08X-0x%08X...\n", addr, addr + length);
 
     simple_flash_state_t *sstate = (simple_flash_state_t *)state->loader_state;
     uint32_t result;
@@ -267,18 +266,18 @@ int gpl_flash_blank_check(gpl_flash_state_t *state, uint32_t addr, uint32_t leng
     int r = simple_flash_run_op(state->usb_handle, sstate,
                                 FLASH_OP_BLANK_CHECK, addr, length, &result);
     if (r != 0) {
-        fprintf(stderr, "Flash: Blank check operation failed\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Blank check operation failed\n");
         return -1;
     }
 
     if (result == FLASH_RESULT_SUCCESS) {
-        printf("Flash: Region is blank\n");
+        LOG_INFO(LOG_FLASH, "Flash: Region is blank\n");
         return 0;
     } else if (result == FLASH_RESULT_NOT_BLANK) {
-        printf("Flash: Region is NOT blank\n");
+        LOG_INFO(LOG_FLASH, "Flash: Region is NOT blank\n");
         return 1;
     } else {
-        fprintf(stderr, "Flash: Blank check error (result=0x%08X)\n", result);
+        LOG_ERROR(LOG_FLASH, "Flash: Blank check error (result=0x%08X)\n", result);
         return -1;
     }
 }
@@ -287,7 +286,7 @@ int gpl_flash_verify(gpl_flash_state_t *state, uint32_t addr,
                      const uint8_t *data, uint32_t length)
 {
     if (!state || !state->initialized) {
-        fprintf(stderr, "Flash: Not initialized\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Not initialized\n");
         return -1;
     }
 
@@ -295,7 +294,7 @@ int gpl_flash_verify(gpl_flash_state_t *state, uint32_t addr,
         return 0;  /* Nothing to verify */
     }
 
-    printf("Flash: Verifying %u bytes at 0x%08X...\n", length, addr);
+    LOG_INFO(LOG_FLASH, "Flash: Verifying %u bytes at 0x%08X...\n", length, addr);
 
     simple_flash_state_t *sstate = (simple_flash_state_t *)state->loader_state;
 
@@ -321,21 +320,20 @@ int gpl_flash_verify(gpl_flash_state_t *state, uint32_t addr,
         int r = simple_flash_run_op(state->usb_handle, sstate,
                                     FLASH_OP_VERIFY, addr + offset, chunk_size, &result);
         if (r != 0) {
-            fprintf(stderr, "Flash: Verify operation failed at offset 0x%08X\n", offset);
+            LOG_ERROR(LOG_FLASH, "Flash: Verify operation failed at offset 0x%08X\n", offset);
             return -1;
         }
 
         if (result != FLASH_RESULT_SUCCESS) {
-            fprintf(stderr, "Flash: Verification mismatch at offset 0x%08X\n", offset);
+            LOG_ERROR(LOG_FLASH, "Flash: Verification mismatch at offset 0x%08X\n", offset);
             return 1;
         }
 
         offset += chunk_size;
-        printf("Flash: Verified %u/%u bytes\r", offset, length);
-        fflush(stdout);
+        LOG_DEBUG(LOG_FLASH, "Flash: Verified %u/%u bytes\n", offset, length);
     }
 
-    printf("\nFlash: Verification passed\n");
+    LOG_INFO(LOG_FLASH, "Flash: Verification passed\n");
     return 0;
 }
 
@@ -343,16 +341,16 @@ int gpl_flash_program_binary(gpl_flash_state_t *state, const uint8_t *data,
                              uint32_t length, uint32_t base_addr, int verify)
 {
     if (!state || !state->initialized) {
-        fprintf(stderr, "Flash: Not initialized\n");
+        LOG_ERROR(LOG_FLASH, "Flash: Not initialized\n");
         return -1;
     }
 
     if (!data || length == 0) {
-        fprintf(stderr, "Flash: No data to program\n");
+        LOG_ERROR(LOG_FLASH, "Flash: No data to program\n");
         return -1;
     }
 
-    printf("Flash: Programming %u bytes at 0x%08X\n", length, base_addr);
+    LOG_INFO(LOG_FLASH, "Flash: Programming %u bytes at 0x%08X\n", length, base_addr);
 
     /* Erase required sectors */
     int r = gpl_flash_erase_range(state, base_addr, length);
@@ -374,7 +372,7 @@ int gpl_flash_program_binary(gpl_flash_state_t *state, const uint8_t *data,
         }
     }
 
-    printf("Flash: Programming complete\n");
+    LOG_INFO(LOG_FLASH, "Flash: Programming complete\n");
     return 0;
 }
 
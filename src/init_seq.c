@@ -0,0 +1,530 @@
+/*
+ * Table-Driven Init Sequences for OpenLink ColdFire
+ *
+ * Command tables for the SRAM init sequences and their executor. Up to
+ * 'batch' commands are submitted as asynchronous OUT/IN transfer pairs
+ * before waiting; the default of one keeps the vendor's lockstep order
+ * (see init_seq.h for what pipelining changes).
+ *
+ * License: GPL v3
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include "init_seq.h"
+#include "openlink_protocol.h"
+#include "log.h"
+
+#define INIT_TIMEOUT_MS 10000
+
+/* Payload field helpers (big-endian) */
+#define B16(v)  (((v) >> 8) & 0xFF), ((v) & 0xFF)
+#define B32(v)  (((v) >> 24) & 0xFF), (((v) >> 16) & 0xFF), (((v) >> 8) & 0xFF), ((v) & 0xFF)
+
+/* Commands used by the captured sequences */
+#define DEVICE_INFO             { .len = 2, .data = { 0x01, 0x0B } }
+#define ENTER_MODE(m)           { .len = 3, .data = { 0x07, 0x01, (m) } }
+#define BDM_CONFIG              { .len = 3, .data = { 0x07, 0xA2, 0x01 } }
+#define BDM_INIT                { .len = 4, .data = { 0x04, 0x40, 0x58, 0x04 } }
+#define BDM_FREEZE              { .len = 4, .data = { 0x04, 0x7F, 0xFE, 0x02 } }
+#define BDM_STATUS              { .len = 2, .data = { 0x07, 0x95 } }
+#define BDM_INIT2               { .len = 4, .data = { 0x04, 0x40, 0x00, 0x02 } }
+#define MEM_ACCESS              { .len = 3, .data = { 0x07, 0x0A, 0x00 } }
+#define WINDOW(n)               { .len = 5, .count = (n), .data = { 0x07, 0x10, 0x00, 0x00, 0x00 } }
+#define SYNC                    { .len = 2, .flags = INIT_PAD_ZERO, .data = { 0x07, 0x12 } }
+#define READ_REG(r)             { .len = 4, .rsp_len = 9, .data = { 0x07, 0x13, B16(r) } }
+#define READ_REGS(r, n)         { .len = 4, .count = (n), .flags = INIT_STEP, .rsp_len = 9, \
+                                  .data = { 0x07, 0x13, B16(r) } }
+#define WRITE_REG(r, v)         { .len = 8, .data = { 0x07, 0x16, B16(r), B32(v) } }
+#define CONFIG(r, a, b, c, d)   { .len = 8, .data = { 0x07, 0x11, B16(r), (a), (b), (c), (d) } }
+#define SYSCFG_WRITE            { .len = 10, .data = { 0x07, 0x15, 0x18, 0x00, \
+                                                       0x40, 0x10, 0x00, 0x74, 0x00, 0x0F } }
+#define WRITE_CTRL(c, v)        { .len = 12, .data = { 0x07, 0x14, 0x28, 0x80, 0x00, 0x00, B16(c), B32(v) } }
+#define CFM_INIT                { .len = 9, .flags = INIT_PAD_00FF, \
+                                  .data = { 0x07, 0x1E, 0x00, 0x01, 0x40, 0x10, 0x00, 0x74, 0x0F } }
+#define WRITE_SRAM(a, v)        { .len = 12, .flags = INIT_PAD_00FF, .data = { 0x07, 0x1E, 0x00, 0x04, B32(a), B32(v) } }
+#define VERIFY(a)               { .len = 8, .rsp_len = 9, .data = { 0x07, 0x1B, B32(a), 0x00, 0x04 } }
+#define VERIFY_EQ(a, v)         { .len = 8, .flags = INIT_EXPECT, .rsp_len = 9, .expect = (v), \
+                                  .data = { 0x07, 0x1B, B32(a), 0x00, 0x04 } }
+#define READ_MEM(a, n)          { .len = 8, .rsp_len = 5 + (n), .data = { 0x07, 0x17, B32(a), B16(((n) + 3) / 4 * 6) } }
+
+/* Groups that recur */
+#define BDM_RESET               BDM_CONFIG, BDM_INIT, BDM_FREEZE, BDM_FREEZE, BDM_STATUS, BDM_INIT2
+#define CLOCK_CONFIG            CONFIG(0x1940, 0xFC, 0x0A, 0x00, 0x0A), \
+                                CONFIG(0x1940, 0x40, 0x11, 0x00, 0x0A), \
+                                CONFIG(0x1900, 0x40, 0x10, 0x00, 0x74), \
+                                SYSCFG_WRITE
+
+#define MARKER_ADDR     0x20000408
+#define TEST_MARKER     0x4AC84E73
+#define MARKER_TEST(a)  WRITE_SRAM((a), MARKER_ADDR), VERIFY(a), WRITE_SRAM(MARKER_ADDR, TEST_MARKER)
+#define TARGET_TEST(a)  WRITE_SRAM(MARKER_ADDR, TEST_MARKER), WRITE_SRAM((a), MARKER_ADDR), \
+                        VERIFY_EQ((a), MARKER_ADDR)
+
+/* RAM_INIT_SEQUENCE.txt lines 1-138 */
+static const init_cmd_t sram_pre_init_cmds[] = {
+    /* Device detection, BDM initialization */
+    DEVICE_INFO, DEVICE_INFO,
+    ENTER_MODE(0xFC), BDM_RESET, MEM_ACCESS, ENTER_MODE(0xFC),
+
+    /* Memory windows */
+    WINDOW(9),
+
+    /* BDM configuration */
+    READ_REG(0x2D80), READ_REG(0x2D80),
+    WRITE_REG(0x2C80, 0x00910000),
+    READ_REG(0x2D80),
+    WRITE_REG(0x2C80, 0x00900000),
+    SYNC, ENTER_MODE(0xF8),
+    READ_REG(0x2D80),
+    CLOCK_CONFIG,
+    SYNC, ENTER_MODE(0xF8),
+    CONFIG(0x2980, 0x00, 0x00, 0x08, 0x0F),
+
+    /* Register initialization */
+    READ_REGS(0x2180, 16),
+    CONFIG(0x2980, 0x00, 0x00, 0x08, 0x0F),
+    CONFIG(0x2980, 0x00, 0x00, 0x08, 0x0E),
+    READ_MEM(0x00000000, 64),
+
+    /* Additional BDM setup */
+    BDM_RESET, MEM_ACCESS, MEM_ACCESS,
+    ENTER_MODE(0xF8), ENTER_MODE(0xF0), ENTER_MODE(0xF8),
+    SYNC,
+    READ_REG(0x2D80),
+    CLOCK_CONFIG,
+    SYNC,
+    READ_REG(0x2188), WRITE_REG(0x2088, 0x12345678),
+    READ_REG(0x2188), WRITE_REG(0x2088, 0xAD95014D),
+    ENTER_MODE(0xF8),
+    READ_REG(0x2180), WRITE_REG(0x2080, 0x12345678),
+    READ_REG(0x2180), WRITE_REG(0x2080, 0xCF206089),
+
+    /* Initial verification */
+    VERIFY(0x00000000), VERIFY(0x00000004),
+    WRITE_REG(0x208F, 0xDEADBEEF),
+
+    /* BDM register configuration */
+    WRITE_CTRL(0x080F, 0xDEADBEEF),
+    SYNC,
+    CONFIG(0x2980, 0x00, 0x00, 0x08, 0x0F),
+    READ_REGS(0x2180, 16),
+    READ_REG(0x218D),
+    CONFIG(0x2980, 0x00, 0x00, 0x08, 0x0F),
+    CONFIG(0x2980, 0x00, 0x00, 0x08, 0x0E),
+    WRITE_CTRL(0x0801, 0x20000000),
+    WRITE_CTRL(0x0C05, 0x20000221),     /* RAMBAR */
+    WRITE_CTRL(0x0C04, 0x00000021),     /* FLASHBAR */
+    WRITE_CTRL(0x0C04, 0x00000021),
+    CFM_INIT,
+    CONFIG(0x2980, 0x00, 0x00, 0x08, 0x01),
+
+    /* Initial SRAM test patterns */
+    MARKER_TEST(0x20000008), MARKER_TEST(0x2000000C), MARKER_TEST(0x20000010),
+    MARKER_TEST(0x20000014), MARKER_TEST(0x20000020), MARKER_TEST(0x20000024),
+    MARKER_TEST(0x20000028), MARKER_TEST(0x2000002C), MARKER_TEST(0x20000030),
+};
+
+#define VALIDATION_CYCLE \
+    SYNC, \
+    CONFIG(0x2980, 0x00, 0x00, 0x08, 0x0F), \
+    CONFIG(0x2980, 0x00, 0x00, 0x08, 0x01), \
+    VERIFY(0x200000B8), \
+    READ_REG(0x2D80), \
+    CONFIG(0x2980, 0x00, 0x00, 0x08, 0x0F), \
+    VERIFY(0xDEADBEEF), \
+    READ_REGS(0x2180, 16), \
+    CONFIG(0x2980, 0x00, 0x00, 0x08, 0x0F), \
+    CONFIG(0x2980, 0x00, 0x00, 0x08, 0x0E)
+
+/* RAM_INIT_SEQUENCE.txt lines 139-454 (validation cycles shortened to 3) */
+static const init_cmd_t sram_validation_cmds[] = {
+    /* Test patterns at key SRAM addresses */
+    TARGET_TEST(0x20000034), TARGET_TEST(0x20000038), TARGET_TEST(0x2000003C),
+    TARGET_TEST(0x20000060), TARGET_TEST(0x2000007C), TARGET_TEST(0x200000B8),
+    TARGET_TEST(0x200000F4),
+
+    /* Validation cycles */
+    VALIDATION_CYCLE,
+    VALIDATION_CYCLE,
+    VALIDATION_CYCLE,
+};
+
+typedef struct {
+    const char *name;
+    const init_cmd_t *cmds;
+    int count;
+    int owned;                  /* cmds was loaded from a file */
+} init_seq_t;
+
+static init_seq_t g_seqs[INIT_SEQ_COUNT] = {
+    [INIT_SEQ_SRAM_PRE_INIT] = {
+        "sram_pre_init", sram_pre_init_cmds,
+        sizeof(sram_pre_init_cmds) / sizeof(sram_pre_init_cmds[0]), 0
+    },
+    [INIT_SEQ_SRAM_VALIDATION] = {
+        "sram_validation", sram_validation_cmds,
+        sizeof(sram_validation_cmds) / sizeof(sram_validation_cmds[0]), 0
+    },
+};
+
+static int g_batch = INIT_BATCH_DEFAULT;
+
+void init_seq_set_batch(int batch) {
+    if (batch < 1) batch = 1;
+    if (batch > INIT_BATCH_MAX) batch = INIT_BATCH_MAX;
+    g_batch = batch;
+}
+
+/*
+ * Executor
+ */
+
+/* One command in flight */
+typedef struct {
+    const init_cmd_t *cmd;
+    int step;                   /* Position in the expanded sequence */
+    unsigned char out[256];
+    unsigned char in[256];
+    struct libusb_transfer *out_xfer;
+    struct libusb_transfer *in_xfer;
+} init_slot_t;
+
+typedef struct {
+    int pending;
+    int done;
+} batch_state_t;
+
+static void batch_transfer_done(struct libusb_transfer *transfer) {
+    batch_state_t *b = transfer->user_data;
+    if (--b->pending == 0) {
+        b->done = 1;
+    }
+}
+
+/* Build the packet for repeat 'rep' of a command
+ * Bytes past the payload keep the last response checked, as
+ * send_aa_command does. In lockstep that is the previous command's
+ * response; within a pipelined batch it is the previous batch's last one.
+ */
+static void build_packet(unsigned char *out, const init_cmd_t *c, int rep) {
+    memcpy(out, g_cmd_buffer, 256);
+    out[0] = 0xaa;
+    out[1] = 0x55;
+    out[2] = 0x00;
+    out[3] = c->len;
+    memcpy(out + 4, c->data, c->len);
+
+    if (c->flags & INIT_STEP) {
+        uint16_t v = ((c->data[2] << 8) | c->data[3]) + rep;
+        out[6] = (v >> 8) & 0xFF;
+        out[7] = v & 0xFF;
+    }
+    if (c->flags & INIT_PAD_ZERO) {
+        memset(out + 4 + c->len, 0x00, 256 - 4 - c->len);
+    }
+    if (c->flags & INIT_PAD_00FF) {
+        for (int i = 4 + c->len; i < 256; i += 2) {
+            out[i] = 0x00;
+            if (i + 1 < 256) out[i + 1] = 0xff;
+        }
+    }
+}
+
+/* Submit n OUT/IN pairs and wait for all of them */
+static int submit_batch(libusb_device_handle *handle, init_slot_t *slots, int n) {
+    batch_state_t b = { 0, 0 };
+    int r = 0;
+
+    for (int i = 0; i < n && r == 0; i++) {
+        libusb_fill_bulk_transfer(slots[i].out_xfer, handle, ENDPOINT_OUT, slots[i].out, 256,
+                                  batch_transfer_done, &b, INIT_TIMEOUT_MS);
+        libusb_fill_bulk_transfer(slots[i].in_xfer, handle, ENDPOINT_IN, slots[i].in, 256,
+                                  batch_transfer_done, &b, INIT_TIMEOUT_MS);
+        r = libusb_submit_transfer(slots[i].out_xfer);
+        if (r == 0) {
+            b.pending++;
+            r = libusb_submit_transfer(slots[i].in_xfer);
+            if (r == 0) {
+                b.pending++;
+            }
+        }
+    }
+
+    int cancelled = 0;
+    if (r != 0) {
+        LOG_ERROR(LOG_USB, "Error submitting init batch: %s\n", libusb_error_name(r));
+    }
+    if (b.pending == 0) {
+        b.done = 1;
+    }
+    while (!b.done) {
+        /* Unwind whatever is still queued after a submit or event error */
+        if (r != 0 && !cancelled) {
+            for (int i = 0; i < n; i++) {
+                libusb_cancel_transfer(slots[i].out_xfer);
+                libusb_cancel_transfer(slots[i].in_xfer);
+            }
+            cancelled = 1;
+        }
+        int e = libusb_handle_events_completed(NULL, &b.done);
+        if (e < 0 && r == 0) {
+            LOG_ERROR(LOG_USB, "Error handling USB events: %s\n", libusb_error_name(e));
+            r = e;
+        }
+    }
+    if (r != 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (slots[i].out_xfer->status != LIBUSB_TRANSFER_COMPLETED ||
+            slots[i].in_xfer->status != LIBUSB_TRANSFER_COMPLETED) {
+            LOG_ERROR(LOG_USB, "Init step %d (%02x %02x): USB transfer failed (status %d/%d)\n",
+                      slots[i].step, slots[i].cmd->data[0], slots[i].cmd->data[1],
+                      slots[i].out_xfer->status, slots[i].in_xfer->status);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Validate the responses that matter and keep the last one as leftover
+ * for the next packets built
+ */
+static int check_batch(const init_seq_t *seq, init_slot_t *slots, int n) {
+    for (int i = 0; i < n; i++) {
+        const init_cmd_t *c = slots[i].cmd;
+        unsigned char *rsp = slots[i].in;
+        int len = slots[i].in_xfer->actual_length;
+
+        if (g_openlink_verbose) {
+            printf("%s step %d:\n", seq->name, slots[i].step);
+            print_hex(slots[i].out, 4 + c->len);
+            print_hex(rsp, len);
+        }
+
+        if (c->rsp_len && validate_response(rsp, len, c->rsp_len, NULL) != 0) {
+            LOG_ERROR(LOG_USB, "%s: step %d (%02x %02x) returned an invalid response\n",
+                      seq->name, slots[i].step, c->data[0], c->data[1]);
+            return -1;
+        }
+        if ((c->flags & INIT_EXPECT) && len >= 9) {
+            uint32_t v = (rsp[5] << 24) | (rsp[6] << 16) | (rsp[7] << 8) | rsp[8];
+            if (v != c->expect) {
+                LOG_WARN(LOG_USB, "%s: expected 0x%08X, got 0x%08X\n", seq->name, c->expect, v);
+            }
+        }
+    }
+
+    memcpy(g_cmd_buffer, slots[n - 1].in, 256);
+    return 0;
+}
+
+static int run_sequence(libusb_device_handle *handle, const init_seq_t *seq, int batch) {
+    init_slot_t *slots = calloc(batch, sizeof(*slots));
+    if (!slots) {
+        return -1;
+    }
+
+    int result = 0;
+    for (int i = 0; i < batch; i++) {
+        slots[i].out_xfer = libusb_alloc_transfer(0);
+        slots[i].in_xfer = libusb_alloc_transfer(0);
+        if (!slots[i].out_xfer || !slots[i].in_xfer) {
+            result = -1;
+        }
+    }
+
+    int idx = 0, rep = 0, step = 0;
+    while (result == 0 && idx < seq->count) {
+        int n = 0;
+        while (n < batch && idx < seq->count) {
+            const init_cmd_t *c = &seq->cmds[idx];
+            build_packet(slots[n].out, c, rep);
+            slots[n].cmd = c;
+            slots[n].step = step++;
+            n++;
+            if (++rep >= (c->count ? c->count : 1)) {
+                rep = 0;
+                idx++;
+            }
+        }
+        result = submit_batch(handle, slots, n);
+        if (result == 0) {
+            result = check_batch(seq, slots, n);
+        }
+    }
+
+    for (int i = 0; i < batch; i++) {
+        libusb_free_transfer(slots[i].out_xfer);
+        libusb_free_transfer(slots[i].in_xfer);
+    }
+    free(slots);
+    return result;
+}
+
+int init_seq_run(libusb_device_handle *handle, init_seq_id_t id) {
+    const init_seq_t *seq = &g_seqs[id];
+
+    int r = run_sequence(handle, seq, g_batch);
+    if (r != 0 && g_batch > 1) {
+        LOG_WARN(LOG_USB, "%s: pipelined run failed, retrying in lockstep\n", seq->name);
+        r = run_sequence(handle, seq, 1);
+    }
+    return r;
+}
+
+/*
+ * Sequence Files
+ */
+
+static int parse_command(char *tok, init_cmd_t *c) {
+    for (; tok; tok = strtok(NULL, " \t\r\n")) {
+        char *end;
+        if (strlen(tok) == 2 && isxdigit((unsigned char)tok[0]) && isxdigit((unsigned char)tok[1])) {
+            if (c->len >= INIT_CMD_MAX) {
+                return -1;
+            }
+            c->data[c->len++] = strtoul(tok, NULL, 16);
+        } else if (tok[0] == 'x' && tok[1]) {
+            unsigned long n = strtoul(tok + 1, &end, 10);
+            if (*end || n < 1 || n > 255) return -1;
+            c->count = n;
+        } else if (strcmp(tok, "step") == 0) {
+            c->flags |= INIT_STEP;
+        } else if (strcmp(tok, "pad0") == 0) {
+            c->flags |= INIT_PAD_ZERO;
+        } else if (strcmp(tok, "pad00ff") == 0) {
+            c->flags |= INIT_PAD_00FF;
+        } else if (strncmp(tok, "check=", 6) == 0) {
+            unsigned long n = strtoul(tok + 6, &end, 0);
+            if (*end || n > 255) return -1;
+            c->rsp_len = n;
+        } else if (strncmp(tok, "expect=", 7) == 0) {
+            c->expect = strtoul(tok + 7, &end, 0);
+            if (*end) return -1;
+            c->flags |= INIT_EXPECT;
+        } else {
+            return -1;
+        }
+    }
+    /* Need command + subcommand; 'step' needs the 16-bit field */
+    if (c->len < 2 || ((c->flags & INIT_STEP) && c->len < 4)) {
+        return -1;
+    }
+    return 0;
+}
+
+int init_seq_load(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        LOG_ERROR(LOG_USB, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    init_cmd_t *cmds[INIT_SEQ_COUNT] = { 0 };
+    int counts[INIT_SEQ_COUNT] = { 0 };
+    int loaded[INIT_SEQ_COUNT] = { 0 };
+    int cur = -1;
+    int result = 0;
+    int lineno = 0;
+    char line[512];
+
+    while (result == 0 && fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+
+        char *tok = strtok(line, " \t\r\n");
+        if (!tok) {
+            continue;
+        }
+
+        if (tok[0] == '[') {
+            char *close = strchr(tok, ']');
+            if (close) *close = '\0';
+            cur = -1;
+            for (int i = 0; i < INIT_SEQ_COUNT; i++) {
+                if (strcmp(tok + 1, g_seqs[i].name) == 0) {
+                    cur = i;
+                }
+            }
+            if (cur < 0) {
+                LOG_ERROR(LOG_USB, "%s:%d: unknown sequence '%s'\n", path, lineno, tok + 1);
+                result = -1;
+            } else {
+                loaded[cur] = 1;
+            }
+            continue;
+        }
+
+        if (strcmp(tok, "batch") == 0) {
+            char *arg = strtok(NULL, " \t\r\n");
+            if (!arg) {
+                LOG_ERROR(LOG_USB, "%s:%d: batch needs a value\n", path, lineno);
+                result = -1;
+            } else {
+                init_seq_set_batch(atoi(arg));
+            }
+            continue;
+        }
+
+        init_cmd_t c = { 0 };
+        if (cur < 0) {
+            LOG_ERROR(LOG_USB, "%s:%d: command outside a [sequence] section\n", path, lineno);
+            result = -1;
+        } else if (parse_command(tok, &c) != 0) {
+            LOG_ERROR(LOG_USB, "%s:%d: invalid command\n", path, lineno);
+            result = -1;
+        } else {
+            init_cmd_t *grown = realloc(cmds[cur], (counts[cur] + 1) * sizeof(init_cmd_t));
+            if (!grown) {
+                result = -1;
+            } else {
+                cmds[cur] = grown;
+                cmds[cur][counts[cur]++] = c;
+            }
+        }
+    }
+    fclose(f);
+
+    for (int i = 0; i < INIT_SEQ_COUNT; i++) {
+        if (result != 0 || !loaded[i]) {
+            free(cmds[i]);
+            continue;
+        }
+        if (g_seqs[i].owned) {
+            free((void *)g_seqs[i].cmds);
+        }
+        g_seqs[i].cmds = cmds[i];
+        g_seqs[i].count = counts[i];
+        g_seqs[i].owned = 1;
+        printf("Init sequence '%s': %d commands from %s\n", g_seqs[i].name, counts[i], path);
+    }
+    return result;
+}
+
+void init_seq_dump(FILE *out) {
+    fprintf(out, "# OpenLink ColdFire init sequences (see src/init_seq.h for the format)\n");
+    fprintf(out, "batch %d\n", g_batch);
+
+    for (int i = 0; i < INIT_SEQ_COUNT; i++) {
+        fprintf(out, "\n[%s]\n", g_seqs[i].name);
+        for (int j = 0; j < g_seqs[i].count; j++) {
+            const init_cmd_t *c = &g_seqs[i].cmds[j];
+            for (int k = 0; k < c->len; k++) {
+                fprintf(out, k ? " %02x" : "%02x", c->data[k]);
+            }
+            if (c->count > 1) fprintf(out, " x%d", c->count);
+            if (c->flags & INIT_STEP) fprintf(out, " step");
+            if (c->flags & INIT_PAD_ZERO) fprintf(out, " pad0");
+            if (c->flags & INIT_PAD_00FF) fprintf(out, " pad00ff");
+            if (c->rsp_len) fprintf(out, " check=%d", c->rsp_len);
+            if (c->flags & INIT_EXPECT) fprintf(out, " expect=0x%08X", c->expect);
+            fprintf(out, "\n");
+        }
+    }
+}
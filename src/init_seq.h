@@ -0,0 +1,94 @@
+/*
+ * Table-Driven Init Sequences for OpenLink ColdFire
+ *
+ * The SRAM pre-init and validation sequences captured from the vendor
+ * software (RAM_INIT_SEQUENCE.txt) are stored as command tables instead of
+ * unrolled function calls. An executor sends them to the probe and only
+ * validates the responses marked as significant.
+ *
+ * Like send_aa_command(), every packet carries the previous response in
+ * the bytes past its payload. That only holds in lockstep, the default:
+ * with "batch N" the packets of a batch are built before any of their
+ * responses arrive, so all of them carry the last response of the
+ * previous batch (commands with pad0/pad00ff are unaffected). Whether the
+ * probe ignores those bytes hasn't been checked on hardware, so pipelining
+ * is for experiments only.
+ *
+ * The compiled-in tables can be replaced from a text file (--init-seq),
+ * which makes it easy to experiment with trimmed sequences. The file format
+ * is what init_seq_dump() prints:
+ *
+ *   # comment
+ *   batch 1                         pipeline depth (1 = lockstep)
+ *   [sram_pre_init]                 start of a sequence
+ *   07 01 fc                        payload bytes (after aa 55 len:2)
+ *   07 13 21 80  x16 step check=9   options: xN repeat, step (increment
+ *                                   bytes 2-3 per repeat), pad0/pad00ff
+ *                                   (fill the rest of the packet),
+ *                                   check=N (minimum valid response
+ *                                   length), expect=V (warn if the
+ *                                   longword at response offset 5 != V)
+ *
+ * License: GPL v3
+ */
+
+#ifndef INIT_SEQ_H
+#define INIT_SEQ_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <libusb-1.0/libusb.h>
+
+/* Limits */
+#define INIT_CMD_MAX        12      /* Longest payload (07 14 / 07 1e write) */
+#define INIT_BATCH_DEFAULT  1       /* Commands in flight per batch */
+#define INIT_BATCH_MAX      64
+
+/* Command flags */
+#define INIT_STEP       0x01    /* Increment 16-bit field at data[2] per repeat */
+#define INIT_PAD_ZERO   0x02    /* Fill rest of packet with 00 */
+#define INIT_PAD_00FF   0x04    /* Fill rest of packet with 00 ff pairs */
+#define INIT_EXPECT     0x08    /* Compare response longword with 'expect' */
+
+/* One probe command */
+typedef struct {
+    uint8_t  len;                   /* Payload length */
+    uint8_t  count;                 /* Times to send (0 = once) */
+    uint8_t  flags;                 /* INIT_* flags */
+    uint8_t  rsp_len;               /* Minimum valid response, 0 = unchecked */
+    uint8_t  data[INIT_CMD_MAX];    /* Payload: command, subcommand, args */
+    uint32_t expect;                /* Expected value for INIT_EXPECT */
+} init_cmd_t;
+
+/* Sequences */
+typedef enum {
+    INIT_SEQ_SRAM_PRE_INIT,
+    INIT_SEQ_SRAM_VALIDATION,
+    INIT_SEQ_COUNT
+} init_seq_id_t;
+
+/*
+ * Run a sequence
+ *
+ * @param handle    USB device handle
+ * @param id        Sequence to run
+ * @return          0 on success, -1 on USB error or failed response check.
+ *                  A pipelined run that fails is retried once in lockstep.
+ */
+int init_seq_run(libusb_device_handle *handle, init_seq_id_t id);
+
+/*
+ * Replace sequences from a file
+ * Sequences not present in the file keep their compiled-in tables.
+ *
+ * @return          0 on success, -1 on I/O or parse error
+ */
+int init_seq_load(const char *path);
+
+/* Print all sequences in the file format above */
+void init_seq_dump(FILE *out);
+
+/* Set the pipeline depth (1..INIT_BATCH_MAX) */
+void init_seq_set_batch(int batch);
+
+#endif /* INIT_SEQ_H */
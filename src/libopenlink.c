@@ -0,0 +1,324 @@
+/*
+ * libopenlink - Embeddable ColdFire Debug Library
+ *
+ * Thin session layer over openlink_protocol, flash_gpl, file_loader and
+ * target_ctl. Run control and register access go through the same
+ * target_ctl calls as m68k-gdbserver, minus its GDB-specific caching and
+ * breakpoint bookkeeping.
+ *
+ * License: GPL v3
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "libopenlink.h"
+#include "openlink_protocol.h"
+#include "flash_gpl.h"
+#include "file_loader.h"
+#include "target_ctl.h"
+#include "log.h"
+
+/* USB Multilink IDs */
+#define USB_VENDOR_ID   0x1357
+#define USB_PRODUCT_ID  0x0503
+
+/* Memory map (MCF52233) */
+#define SRAM_BASE       0x20000000
+#define SRAM_SIZE       0x8000
+
+struct openlink_ctx {
+    libusb_device_handle *usb;
+    uint32_t flash_size;        /* Bytes, from the last attach */
+    int attached;
+    int flash_active;           /* Flashloader owns the target */
+    gpl_flash_state_t flash;
+    int step_count;             /* Single steps since the last BDM reset */
+};
+
+static int g_ctx_open = 0;
+
+int openlink_api_version(void) {
+    return OPENLINK_API_VERSION;
+}
+
+void openlink_set_log_level(int verbose) {
+    openlink_set_verbose(verbose);
+    log_set_level(LOG_NUM_CATEGORIES, verbose ? LOG_LEVEL_DEBUG : LOG_LEVEL_WARN);
+}
+
+/*
+ * Session
+ */
+
+openlink_ctx_t *openlink_open(void) {
+    if (g_ctx_open) {
+        fprintf(stderr, "libopenlink: a session is already open\n");
+        return NULL;
+    }
+
+    int r = libusb_init(NULL);
+    if (r < 0) {
+        fprintf(stderr, "Failed to initialize libusb: %s\n", libusb_error_name(r));
+        return NULL;
+    }
+
+    openlink_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) {
+        libusb_exit(NULL);
+        return NULL;
+    }
+
+    ctx->usb = libusb_open_device_with_vid_pid(NULL, USB_VENDOR_ID, USB_PRODUCT_ID);
+    if (!ctx->usb) {
+        fprintf(stderr, "Could not open Multilink (VID=%04x PID=%04x)\n",
+                USB_VENDOR_ID, USB_PRODUCT_ID);
+        free(ctx);
+        libusb_exit(NULL);
+        return NULL;
+    }
+
+    r = libusb_claim_interface(ctx->usb, 0);
+    if (r < 0) {
+        fprintf(stderr, "Could not claim interface: %s\n", libusb_error_name(r));
+        libusb_close(ctx->usb);
+        free(ctx);
+        libusb_exit(NULL);
+        return NULL;
+    }
+
+    g_ctx_open = 1;
+    return ctx;
+}
+
+void openlink_close(openlink_ctx_t *ctx) {
+    if (!ctx) {
+        return;
+    }
+    if (ctx->flash_active) {
+        gpl_flash_cleanup(&ctx->flash);
+    }
+    libusb_release_interface(ctx->usb, 0);
+    libusb_close(ctx->usb);
+    libusb_exit(NULL);
+    free(ctx);
+    g_ctx_open = 0;
+}
+
+int openlink_attach(openlink_ctx_t *ctx, int full) {
+    uint32_t flash_kb = 0;
+
+    if (ctx->flash_active) {
+        gpl_flash_cleanup(&ctx->flash);
+        ctx->flash_active = 0;
+        full = 1;       /* The flashloader changed the BDM setup */
+    }
+
+    int r = full ? target_init_full(ctx->usb, &flash_kb)
+                 : target_attach(ctx->usb, &flash_kb);
+    if (r != 0) {
+        ctx->attached = 0;
+        return -1;
+    }
+
+    ctx->flash_size = flash_kb * 1024;
+    ctx->attached = 1;
+    ctx->step_count = 0;
+    return 0;
+}
+
+uint32_t openlink_flash_size(openlink_ctx_t *ctx) {
+    return ctx->flash_size;
+}
+
+/* Hand the target back from the flashloader before debug access */
+static int target_ready(openlink_ctx_t *ctx) {
+    if (ctx->flash_active || !ctx->attached) {
+        return openlink_attach(ctx, ctx->flash_active);
+    }
+    return 0;
+}
+
+/* Load the flashloader unless it is already running */
+static int flash_ready(openlink_ctx_t *ctx) {
+    if (ctx->flash_active) {
+        return 0;
+    }
+    if (gpl_flash_init(&ctx->flash, ctx->usb, NULL) != 0) {
+        return -1;
+    }
+    ctx->flash_active = 1;
+    return 0;
+}
+
+/*
+ * Memory
+ */
+
+int openlink_mem_read(openlink_ctx_t *ctx, uint32_t addr, void *buf, uint32_t len) {
+    if (target_ready(ctx) != 0) {
+        return -1;
+    }
+    return openlink_read_memory(ctx->usb, addr, len, buf);
+}
+
+int openlink_mem_write(openlink_ctx_t *ctx, uint32_t addr, const void *buf, uint32_t len) {
+    const uint8_t *data = buf;
+
+    if (len == 0) {
+        return 0;
+    }
+    if (addr < FLASH_SIZE) {
+        fprintf(stderr, "libopenlink: 0x%08X is flash, use openlink_program()\n", addr);
+        return -1;
+    }
+    if (target_ready(ctx) != 0) {
+        return -1;
+    }
+
+    /* SRAM: block download with read-modify-write at the edges */
+    if (addr >= SRAM_BASE && addr + len <= SRAM_BASE + SRAM_SIZE) {
+        return openlink_write_memory(ctx->usb, addr, data, len);
+    }
+
+    /* Peripherals: access width matters for single registers */
+    if (len == 1) {
+        return cmd_write_memory_byte_addr(ctx->usb, addr, data[0]);
+    }
+    if (len == 2 && (addr & 1) == 0) {
+        return cmd_write_memory_word_addr(ctx->usb, addr, (data[0] << 8) | data[1]);
+    }
+    if ((addr & 3) != 0 || (len & 3) != 0) {
+        fprintf(stderr, "libopenlink: peripheral write at 0x%08X must be 1, 2 or a multiple of 4 aligned bytes\n",
+                addr);
+        return -1;
+    }
+    for (uint32_t i = 0; i < len; i += 4) {
+        uint32_t value = ((uint32_t)data[i] << 24) | ((uint32_t)data[i + 1] << 16) |
+                         ((uint32_t)data[i + 2] << 8) | data[i + 3];
+        if (cmd_07_19(ctx->usb, addr + i, value) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Flash
+ */
+
+int openlink_erase(openlink_ctx_t *ctx, uint32_t addr, uint32_t len) {
+    if (flash_ready(ctx) != 0) {
+        return -1;
+    }
+    if (len == 0) {
+        return gpl_flash_mass_erase(&ctx->flash);
+    }
+    return gpl_flash_erase_range(&ctx->flash, addr, len);
+}
+
+int openlink_program(openlink_ctx_t *ctx, uint32_t addr, const void *data, uint32_t len) {
+    if (addr + len > FLASH_SIZE || addr + len < addr) {
+        fprintf(stderr, "libopenlink: 0x%08X+%u extends beyond flash\n", addr, len);
+        return -1;
+    }
+    if (flash_ready(ctx) != 0) {
+        return -1;
+    }
+    return gpl_flash_program_binary(&ctx->flash, data, len, addr, 0);
+}
+
+int openlink_program_file(openlink_ctx_t *ctx, const char *path, uint32_t base) {
+    loaded_file_t file;
+    if (file_load(path, base, &file) != 0) {
+        fprintf(stderr, "Failed to load file '%s'\n", path);
+        return -1;
+    }
+
+    uint8_t *data;
+    uint32_t data_addr, data_size;
+    int r = file_get_contiguous(&file, &data_addr, &data, &data_size);
+    file_free(&file);
+    if (r != 0) {
+        fprintf(stderr, "Failed to get contiguous data\n");
+        return -1;
+    }
+
+    r = openlink_program(ctx, data_addr, data, data_size);
+    free(data);
+    return r;
+}
+
+int openlink_verify(openlink_ctx_t *ctx, uint32_t addr, const void *data, uint32_t len,
+                    uint32_t *mismatch_addr) {
+    const uint8_t *expected = data;
+    uint8_t chunk[OPENLINK_READ_BLOCK_MAX];
+
+    for (uint32_t offset = 0; offset < len; ) {
+        uint32_t n = len - offset;
+        if (n > sizeof(chunk)) n = sizeof(chunk);
+
+        if (openlink_mem_read(ctx, addr + offset, chunk, n) != 0) {
+            return -1;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (chunk[i] != expected[offset + i]) {
+                if (mismatch_addr) *mismatch_addr = addr + offset + i;
+                return 1;
+            }
+        }
+        offset += n;
+    }
+    return 0;
+}
+
+/*
+ * Run Control
+ */
+
+int openlink_halt(openlink_ctx_t *ctx) {
+    if (ctx->flash_active) {
+        return target_ready(ctx);
+    }
+    return target_halt(ctx->usb);
+}
+
+int openlink_go(openlink_ctx_t *ctx) {
+    if (target_ready(ctx) != 0) {
+        return -1;
+    }
+    cmd_enter_mode(ctx->usb, 0xF8);
+    return cmd_07_02_bdm_go(ctx->usb);
+}
+
+int openlink_wait_halt(openlink_ctx_t *ctx, int timeout_ms) {
+    return target_wait_halt(ctx->usb, timeout_ms, NULL);
+}
+
+int openlink_step(openlink_ctx_t *ctx) {
+    if (target_ready(ctx) != 0) {
+        return -1;
+    }
+    return target_step(ctx->usb, &ctx->step_count);
+}
+
+int openlink_reg_read(openlink_ctx_t *ctx, int reg, uint32_t *value) {
+    if (reg < 0 || reg >= OPENLINK_NUM_REGS) {
+        return -1;
+    }
+    if (target_ready(ctx) != 0) {
+        return -1;
+    }
+    return target_reg_read(ctx->usb, reg, value);
+}
+
+int openlink_reg_write(openlink_ctx_t *ctx, int reg, uint32_t value) {
+    if (reg < 0 || reg >= OPENLINK_NUM_REGS) {
+        return -1;
+    }
+    if (target_ready(ctx) != 0) {
+        return -1;
+    }
+    return target_reg_write(ctx->usb, reg, value);
+}
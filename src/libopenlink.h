@@ -0,0 +1,126 @@
+/*
+ * libopenlink - Embeddable ColdFire Debug Library
+ *
+ * Context-based C API over the OpenLink protocol layer, the GPL flash driver
+ * and the file loaders, for test harnesses that want to keep one probe
+ * session open in-process instead of spawning m68k-gdbserver per operation.
+ *
+ *   openlink_ctx_t *ctx = openlink_open();
+ *   openlink_attach(ctx, 0);
+ *   openlink_program_file(ctx, "firmware.bin", 0);
+ *   openlink_mem_read(ctx, 0x20000000, buf, sizeof(buf));
+ *   openlink_close(ctx);
+ *
+ * Conventions: functions return 0 on success and -1 on error (details go to
+ * stderr); openlink_verify() and openlink_wait_halt() return 1 for
+ * "mismatch" and "timeout". The protocol layer keeps per-probe state in
+ * globals, so only one context can be open per process.
+ *
+ * Build with 'make lib' (libopenlink.a, libopenlink.so). Only the
+ * functions declared here are exported from the shared library.
+ *
+ * License: GPL v3
+ */
+
+#ifndef LIBOPENLINK_H
+#define LIBOPENLINK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OPENLINK_API_VERSION    1
+
+#if defined(__GNUC__)
+#define OPENLINK_API __attribute__((visibility("default")))
+#else
+#define OPENLINK_API
+#endif
+
+/* Register numbers (GDB m68k order) */
+#define OPENLINK_REG_D0     0       /* D0-D7: 0-7 */
+#define OPENLINK_REG_A0     8       /* A0-A7: 8-15 */
+#define OPENLINK_REG_SP     15
+#define OPENLINK_REG_SR     16
+#define OPENLINK_REG_PC     17
+#define OPENLINK_NUM_REGS   18
+
+typedef struct openlink_ctx openlink_ctx_t;
+
+/* API version the library was built with (OPENLINK_API_VERSION) */
+OPENLINK_API int openlink_api_version(void);
+
+/* Quiet (0) or verbose (1) output from the protocol and flash layers */
+OPENLINK_API void openlink_set_log_level(int verbose);
+
+/*
+ * Session
+ */
+
+/* Open the USB Multilink probe, NULL if not found or already open */
+OPENLINK_API openlink_ctx_t *openlink_open(void);
+
+/* Release the probe and free the context */
+OPENLINK_API void openlink_close(openlink_ctx_t *ctx);
+
+/* Bring the target into BDM
+ * full = 0 reattaches quickly if the target is already halted and set up;
+ * full = 1 always runs the complete init sequence
+ */
+OPENLINK_API int openlink_attach(openlink_ctx_t *ctx, int full);
+
+/* Flash size in bytes detected by the last attach */
+OPENLINK_API uint32_t openlink_flash_size(openlink_ctx_t *ctx);
+
+/*
+ * Memory
+ * Reads cover flash, SRAM and peripherals. Writes cover SRAM and
+ * peripherals; 1- and 2-byte writes use byte/word accesses so peripheral
+ * registers see the right width. Use the flash functions for flash.
+ */
+OPENLINK_API int openlink_mem_read(openlink_ctx_t *ctx, uint32_t addr, void *buf, uint32_t len);
+OPENLINK_API int openlink_mem_write(openlink_ctx_t *ctx, uint32_t addr, const void *buf, uint32_t len);
+
+/*
+ * Flash
+ * The flashloader is loaded on first use and kept until a memory, register
+ * or run-control call needs the target back, so back-to-back flash
+ * operations only pay for it once.
+ */
+
+/* Erase the sectors covering [addr, addr+len); len = 0 erases everything */
+OPENLINK_API int openlink_erase(openlink_ctx_t *ctx, uint32_t addr, uint32_t len);
+
+/* Erase and program a buffer */
+OPENLINK_API int openlink_program(openlink_ctx_t *ctx, uint32_t addr, const void *data, uint32_t len);
+
+/* Program a .bin (at base), .elf or .s19/.srec file */
+OPENLINK_API int openlink_program_file(openlink_ctx_t *ctx, const char *path, uint32_t base);
+
+/* Compare target memory with a buffer
+ * Returns 0 if equal, 1 on mismatch (first differing address in
+ * *mismatch_addr if not NULL), -1 on error
+ */
+OPENLINK_API int openlink_verify(openlink_ctx_t *ctx, uint32_t addr, const void *data, uint32_t len,
+                                 uint32_t *mismatch_addr);
+
+/*
+ * Run Control
+ */
+OPENLINK_API int openlink_halt(openlink_ctx_t *ctx);
+OPENLINK_API int openlink_go(openlink_ctx_t *ctx);
+OPENLINK_API int openlink_step(openlink_ctx_t *ctx);
+
+/* Poll for a halt: 0 halted, 1 still running after timeout_ms, -1 error */
+OPENLINK_API int openlink_wait_halt(openlink_ctx_t *ctx, int timeout_ms);
+
+OPENLINK_API int openlink_reg_read(openlink_ctx_t *ctx, int reg, uint32_t *value);
+OPENLINK_API int openlink_reg_write(openlink_ctx_t *ctx, int reg, uint32_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBOPENLINK_H */
@@ -0,0 +1,512 @@
+/*
+ * Live Memory Sampling for OpenLink ColdFire
+ *
+ * License: GPL v3
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "live_watch.h"
+#include "openlink_protocol.h"
+#include "file_loader.h"
+#include "log.h"
+
+#define LIVE_LINE_MAX       256     /* Command line from the client */
+#define LIVE_OUT_MAX        8192    /* One sample line */
+#define LIVE_SPAN_MAX       256     /* Largest merged read */
+#define LIVE_MERGE_GAP      16      /* Read across gaps up to this size */
+#define LIVE_STATS_MS       1000.0
+
+typedef struct {
+    char name[48];
+    uint32_t addr;
+    uint32_t size;
+} live_var_t;
+
+/* Neighbouring variables are fetched with one read */
+typedef struct {
+    uint32_t addr;
+    uint32_t len;
+    int first;                      /* Index of the first variable */
+    int count;
+} live_span_t;
+
+/* Sampling statistics for a run or a stats window */
+typedef struct {
+    unsigned long samples;
+    unsigned long missed;           /* Slots skipped because we fell behind */
+    unsigned long errors;           /* Failed reads */
+    unsigned long dropped;          /* Lines the client was too slow for */
+    double jitter_sum;
+    double jitter_max;
+    double start_ms;
+} live_stats_t;
+
+static struct {
+    int listen_fd;
+    int client_fd;
+    char rx[LIVE_LINE_MAX];
+    size_t rx_len;
+
+    live_var_t vars[LIVE_MAX_VARS];     /* Sorted by address */
+    int num_vars;
+    live_span_t spans[LIVE_MAX_VARS];
+    int num_spans;
+    int rate;
+    int json;
+
+    const symbol_table_t *symbols;      /* NULL = addresses only */
+
+    int running;
+    struct timespec t0;
+    double next_ms;
+    live_stats_t run;
+    live_stats_t window;
+} live = { .listen_fd = -1, .client_fd = -1, .rate = LIVE_RATE_DEFAULT };
+
+static double live_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - live.t0.tv_sec) * 1000.0 + (now.tv_nsec - live.t0.tv_nsec) / 1e6;
+}
+
+static void live_disconnect(void) {
+    if (live.client_fd >= 0) {
+        close(live.client_fd);
+        live.client_fd = -1;
+        LOG_INFO(LOG_TOOL, "Live client disconnected\n");
+    }
+    live.rx_len = 0;
+}
+
+/* Send a whole line; samples are dropped rather than stalling the target
+ * poll loop when the client falls behind
+ */
+static int live_send(const char *line, int droppable) {
+    size_t len = strlen(line);
+    if (live.client_fd < 0) {
+        return -1;
+    }
+
+    ssize_t n = send(live.client_fd, line, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && droppable) {
+        live.run.dropped++;
+        live.window.dropped++;
+        return 0;
+    }
+    /* A started line is always finished */
+    while (n >= 0 && (size_t)n < len) {
+        ssize_t m = send(live.client_fd, line + n, len - n, MSG_NOSIGNAL);
+        if (m < 0 && errno == EINTR) continue;
+        if (m <= 0) {
+            n = -1;
+            break;
+        }
+        n += m;
+    }
+    if (n < 0) {
+        live_disconnect();
+        return -1;
+    }
+    return 0;
+}
+
+/* Reply to a command, as a comment line (csv) or an object (json) */
+static void live_reply(int ok, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void live_reply(int ok, const char *fmt, ...) {
+    char text[LIVE_LINE_MAX];
+    char line[LIVE_LINE_MAX + 32];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(text, sizeof(text), fmt, ap);
+    va_end(ap);
+
+    if (live.json) {
+        snprintf(line, sizeof(line), "{\"%s\":\"%s\"}\n", ok ? "reply" : "error", text);
+    } else {
+        snprintf(line, sizeof(line), "# %s %s\n", ok ? "ok" : "error", text);
+    }
+    live_send(line, 0);
+}
+
+static void live_build_spans(void) {
+    live.num_spans = 0;
+    for (int i = 0; i < live.num_vars; i++) {
+        const live_var_t *v = &live.vars[i];
+        live_span_t *s = live.num_spans ? &live.spans[live.num_spans - 1] : NULL;
+        uint32_t end = v->addr + v->size;
+
+        if (s && v->addr <= s->addr + s->len + LIVE_MERGE_GAP &&
+            (end > s->addr + s->len ? end : s->addr + s->len) - s->addr <= LIVE_SPAN_MAX) {
+            if (end > s->addr + s->len) {
+                s->len = end - s->addr;
+            }
+            s->count++;
+            continue;
+        }
+        s = &live.spans[live.num_spans++];
+        s->addr = v->addr;
+        s->len = v->size;
+        s->first = i;
+        s->count = 1;
+    }
+}
+
+static void live_cmd_add(char *arg) {
+    char *what = strtok(arg, " \t");
+    char *size_arg = strtok(NULL, " \t");
+    live_var_t v = { .size = 4 };
+
+    if (!what) {
+        live_reply(0, "usage: add <symbol|addr> [size]");
+        return;
+    }
+    if (live.num_vars == LIVE_MAX_VARS) {
+        live_reply(0, "at most %d variables", LIVE_MAX_VARS);
+        return;
+    }
+
+    if (isdigit((unsigned char)what[0])) {
+        char *end;
+        v.addr = strtoul(what, &end, 0);
+        if (*end != '\0') {
+            live_reply(0, "bad address '%s'", what);
+            return;
+        }
+    } else {
+        const elf_symbol_t *sym = live.symbols ? symbol_find(live.symbols, what) : NULL;
+        if (!sym) {
+            live_reply(0, "unknown symbol '%s'%s", what, live.symbols ? "" : " (no --symbols)");
+            return;
+        }
+        v.addr = sym->addr;
+        if (sym->size) {
+            v.size = sym->size;
+        }
+    }
+    snprintf(v.name, sizeof(v.name), "%s", what);
+    if (size_arg) {
+        v.size = strtoul(size_arg, NULL, 0);
+    }
+    if (v.size == 0 || v.size > LIVE_MAX_SIZE) {
+        live_reply(0, "size must be 1-%d bytes", LIVE_MAX_SIZE);
+        return;
+    }
+
+    /* Keep the list sorted so neighbours merge into one read */
+    int i = live.num_vars;
+    while (i > 0 && live.vars[i - 1].addr > v.addr) {
+        live.vars[i] = live.vars[i - 1];
+        i--;
+    }
+    live.vars[i] = v;
+    live.num_vars++;
+    live_build_spans();
+    live_reply(1, "%s 0x%08X %u", v.name, v.addr, v.size);
+}
+
+static void live_cmd_remove(const char *name) {
+    for (int i = 0; i < live.num_vars; i++) {
+        if (strcmp(live.vars[i].name, name) == 0) {
+            memmove(&live.vars[i], &live.vars[i + 1], (live.num_vars - i - 1) * sizeof(live_var_t));
+            live.num_vars--;
+            live_build_spans();
+            live_reply(1, "removed %s", name);
+            return;
+        }
+    }
+    live_reply(0, "not watched: %s", name);
+}
+
+static void live_command(char *line) {
+    while (isspace((unsigned char)*line)) line++;
+    char *end = line + strlen(line);
+    while (end > line && isspace((unsigned char)end[-1])) *--end = '\0';
+    if (*line == '\0') {
+        return;
+    }
+
+    if (live.running) {
+        live_reply(0, "target running, stop it first");
+    } else if (strncmp(line, "add ", 4) == 0) {
+        live_cmd_add(line + 4);
+    } else if (strncmp(line, "remove ", 7) == 0) {
+        live_cmd_remove(line + 7);
+    } else if (strcmp(line, "clear") == 0) {
+        live.num_vars = 0;
+        live.num_spans = 0;
+        live_reply(1, "cleared");
+    } else if (strncmp(line, "rate ", 5) == 0) {
+        int rate = atoi(line + 5);
+        if (rate < 1 || rate > LIVE_RATE_MAX) {
+            live_reply(0, "rate must be 1-%d Hz", LIVE_RATE_MAX);
+        } else {
+            live.rate = rate;
+            live_reply(1, "rate %d", rate);
+        }
+    } else if (strcmp(line, "format csv") == 0 || strcmp(line, "format json") == 0) {
+        live.json = (line[7] == 'j');
+        live_reply(1, "format %s", line + 7);
+    } else if (strcmp(line, "list") == 0) {
+        for (int i = 0; i < live.num_vars; i++) {
+            live_reply(1, "%s 0x%08X %u", live.vars[i].name, live.vars[i].addr, live.vars[i].size);
+        }
+        live_reply(1, "%d variables, %d reads per sample, %d Hz", live.num_vars, live.num_spans, live.rate);
+    } else {
+        live_reply(0, "unknown command '%s'", line);
+    }
+}
+
+/* Read what the client sent and run complete lines */
+static void live_read_client(void) {
+    ssize_t n = recv(live.client_fd, live.rx + live.rx_len, sizeof(live.rx) - 1 - live.rx_len, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+    if (n <= 0) {
+        live_disconnect();
+        return;
+    }
+    live.rx_len += n;
+    live.rx[live.rx_len] = '\0';
+
+    char *line = live.rx;
+    char *nl;
+    while ((nl = strchr(line, '\n')) != NULL) {
+        *nl = '\0';
+        live_command(line);
+        if (live.client_fd < 0) {
+            return;
+        }
+        line = nl + 1;
+    }
+    live.rx_len = strlen(line);
+    memmove(live.rx, line, live.rx_len + 1);
+    if (live.rx_len == sizeof(live.rx) - 1) {
+        live_reply(0, "line too long");
+        live.rx_len = 0;
+    }
+}
+
+int live_watch_open(int port) {
+    live.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (live.listen_fd < 0) {
+        LOG_ERROR(LOG_TOOL, "live socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(live.listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if (bind(live.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(live.listen_fd, 1) < 0) {
+        LOG_ERROR(LOG_TOOL, "live port: %s\n", strerror(errno));
+        close(live.listen_fd);
+        live.listen_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void live_watch_set_symbols(const symbol_table_t *syms) {
+    live.symbols = syms;
+}
+
+void live_watch_close(void) {
+    live_disconnect();
+    if (live.listen_fd >= 0) {
+        close(live.listen_fd);
+        live.listen_fd = -1;
+    }
+}
+
+int live_watch_fdset(fd_set *set, int max_fd) {
+    if (live.listen_fd >= 0) {
+        FD_SET(live.listen_fd, set);
+        if (live.listen_fd > max_fd) max_fd = live.listen_fd;
+    }
+    if (live.client_fd >= 0) {
+        FD_SET(live.client_fd, set);
+        if (live.client_fd > max_fd) max_fd = live.client_fd;
+    }
+    return max_fd;
+}
+
+void live_watch_service(const fd_set *set) {
+    if (live.listen_fd >= 0 && FD_ISSET(live.listen_fd, set)) {
+        int fd = accept(live.listen_fd, NULL, NULL);
+        if (fd >= 0) {
+            /* One client at a time; a new one replaces the old */
+            live_disconnect();
+            live.client_fd = fd;
+            int nodelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+            LOG_INFO(LOG_TOOL, "Live client connected\n");
+        }
+    }
+    if (live.client_fd >= 0 && FD_ISSET(live.client_fd, set)) {
+        live_read_client();
+    }
+}
+
+int live_watch_active(void) {
+    return live.client_fd >= 0 && live.num_vars > 0;
+}
+
+static void live_send_stats(const char *event, const live_stats_t *st, double now) {
+    char line[LIVE_LINE_MAX];
+    double secs = (now - st->start_ms) / 1000.0;
+    double rate = secs > 0 ? st->samples / secs : 0.0;
+    double jitter_avg = st->samples ? st->jitter_sum / st->samples : 0.0;
+
+    if (live.json) {
+        snprintf(line, sizeof(line),
+                 "{\"event\":\"%s\",\"t\":%.3f,\"samples\":%lu,\"rate\":%.1f,\"target\":%d,"
+                 "\"jitter_avg_ms\":%.3f,\"jitter_max_ms\":%.3f,\"missed\":%lu,\"errors\":%lu,\"dropped\":%lu}\n",
+                 event, now, st->samples, rate, live.rate, jitter_avg, st->jitter_max,
+                 st->missed, st->errors, st->dropped);
+    } else {
+        snprintf(line, sizeof(line),
+                 "# %s t=%.3f samples=%lu rate=%.1f target=%d jitter_avg_ms=%.3f jitter_max_ms=%.3f "
+                 "missed=%lu errors=%lu dropped=%lu\n",
+                 event, now, st->samples, rate, live.rate, jitter_avg, st->jitter_max,
+                 st->missed, st->errors, st->dropped);
+    }
+    live_send(line, 0);
+}
+
+void live_watch_run_start(void) {
+    if (!live_watch_active()) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &live.t0);
+    memset(&live.run, 0, sizeof(live.run));
+    memset(&live.window, 0, sizeof(live.window));
+    live.next_ms = 0;
+    live.running = 1;
+
+    char line[LIVE_OUT_MAX];
+    int pos;
+    if (live.json) {
+        pos = snprintf(line, sizeof(line), "{\"event\":\"run\",\"rate\":%d,\"vars\":[", live.rate);
+        for (int i = 0; i < live.num_vars; i++) {
+            pos += snprintf(line + pos, sizeof(line) - pos, "%s\"%s\"", i ? "," : "", live.vars[i].name);
+        }
+        snprintf(line + pos, sizeof(line) - pos, "]}\n");
+    } else {
+        pos = snprintf(line, sizeof(line), "time_ms");
+        for (int i = 0; i < live.num_vars; i++) {
+            pos += snprintf(line + pos, sizeof(line) - pos, ",%s", live.vars[i].name);
+        }
+        snprintf(line + pos, sizeof(line) - pos, "\n");
+    }
+    live_send(line, 0);
+}
+
+void live_watch_run_stop(void) {
+    if (!live.running) {
+        return;
+    }
+    live.running = 0;
+    live_send_stats("stop", &live.run, live_now_ms());
+}
+
+/* Append one variable's value to a sample line */
+static int live_format_value(char *out, size_t size, const live_var_t *v, const uint8_t *data) {
+    const char *sep = live.json ? "" : ",";
+    int pos = live.json ? snprintf(out, size, ",\"%s\":", v->name) : 0;
+
+    if (v->size == 1 || v->size == 2 || v->size == 4) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < v->size; i++) {
+            value = (value << 8) | data[i];
+        }
+        return pos + snprintf(out + pos, size - pos, "%s%u", sep, value);
+    }
+
+    pos += snprintf(out + pos, size - pos, "%s%s", sep, live.json ? "\"" : "");
+    for (uint32_t i = 0; i < v->size; i++) {
+        pos += snprintf(out + pos, size - pos, "%02x", data[i]);
+    }
+    return pos + snprintf(out + pos, size - pos, "%s", live.json ? "\"" : "");
+}
+
+void live_watch_poll(libusb_device_handle *dev) {
+    if (live.listen_fd >= 0 || live.client_fd >= 0) {
+        fd_set set;
+        struct timeval tv = { 0, 0 };
+        FD_ZERO(&set);
+        int max_fd = live_watch_fdset(&set, -1);
+        if (select(max_fd + 1, &set, NULL, NULL, &tv) > 0) {
+            live_watch_service(&set);
+        }
+    }
+    if (!live.running) {
+        return;
+    }
+    if (live.client_fd < 0) {
+        live.running = 0;
+        return;
+    }
+
+    double now = live_now_ms();
+    if (now < live.next_ms) {
+        return;
+    }
+
+    /* How late this sample is against its slot; slots we could not keep
+     * up with are skipped instead of bunching samples together
+     */
+    double period = 1000.0 / live.rate;
+    double late = now - live.next_ms;
+    live.next_ms += period;
+    if (now >= live.next_ms) {
+        unsigned long skip = (unsigned long)((now - live.next_ms) / period) + 1;
+        live.run.missed += skip;
+        live.window.missed += skip;
+        live.next_ms += skip * period;
+    }
+
+    char line[LIVE_OUT_MAX];
+    int pos = snprintf(line, sizeof(line), live.json ? "{\"t\":%.3f" : "%.3f", now);
+    uint8_t buf[LIVE_SPAN_MAX];
+    for (int s = 0; s < live.num_spans; s++) {
+        const live_span_t *span = &live.spans[s];
+        if (openlink_read_memory(dev, span->addr, span->len, buf) != 0) {
+            live.run.errors++;
+            live.window.errors++;
+            return;
+        }
+        for (int i = span->first; i < span->first + span->count; i++) {
+            const live_var_t *v = &live.vars[i];
+            pos += live_format_value(line + pos, sizeof(line) - pos, v, buf + (v->addr - span->addr));
+        }
+    }
+    snprintf(line + pos, sizeof(line) - pos, "%s\n", live.json ? "}" : "");
+
+    live.run.samples++;
+    live.run.jitter_sum += late;
+    if (late > live.run.jitter_max) live.run.jitter_max = late;
+    live.window.samples++;
+    live.window.jitter_sum += late;
+    if (late > live.window.jitter_max) live.window.jitter_max = late;
+    live_send(line, 1);
+
+    if (now - live.window.start_ms >= LIVE_STATS_MS) {
+        live_send_stats("stats", &live.window, now);
+        memset(&live.window, 0, sizeof(live.window));
+        live.window.start_ms = now;
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * Live Memory Sampling for OpenLink ColdFire
+ *
+ * ColdFire V2 BDM can read memory while the core runs. While GDB has the
+ * target running, the server samples a list of variables at a fixed rate
+ * and streams the values to a client on a separate TCP port (--live-port).
+ *
+ * The client sends one command per line:
+ *
+ *   add <symbol|addr> [size]   Watch a variable; a symbol needs --symbols,
+ *                              its size defaults to the symbol size
+ *   remove <name>              Stop watching (name = symbol or address)
+ *   clear                      Remove all variables
+ *   rate <hz>                  Sampling rate (default 100, max 1000)
+ *   format csv|json            Output format (default csv)
+ *   list                       Show the watched variables
+ *
+ * and gets, each time the target runs:
+ *
+ *   csv:  time_ms,counter,state          json: {"event":"run",...}
+ *         12.013,1041,3                        {"t":12.013,"counter":1041,...}
+ *         # stats rate=99.9 ...                {"event":"stats","rate":99.9,...}
+ *
+ * Values of 1, 2 and 4 bytes are big-endian integers, larger ones hex.
+ * Replies and statistics are '#' lines in CSV and objects in JSON. The
+ * statistics give the achieved rate and the sampling jitter (how late a
+ * sample was against its schedule) once a second and when the target
+ * stops.
+ *
+ * License: GPL v3
+ */
+
+#ifndef LIVE_WATCH_H
+#define LIVE_WATCH_H
+
+#include <sys/select.h>
+#include <libusb-1.0/libusb.h>
+#include "file_loader.h"
+
+/* Limits */
+#define LIVE_MAX_VARS       32
+#define LIVE_MAX_SIZE       64      /* Bytes per variable */
+#define LIVE_RATE_DEFAULT   100
+#define LIVE_RATE_MAX       1000
+
+/*
+ * Listen for a live client
+ *
+ * @param port          TCP port
+ * @return              0 on success, -1 on error
+ */
+int live_watch_open(int port);
+
+/* Resolve "add <symbol>" in this table (kept by reference) */
+void live_watch_set_symbols(const symbol_table_t *syms);
+
+void live_watch_close(void);
+
+/* Add the live sockets to a select() set; returns the new highest fd */
+int live_watch_fdset(fd_set *set, int max_fd);
+
+/* Accept a client and handle its commands if select() flagged them */
+void live_watch_service(const fd_set *set);
+
+/* Non-zero when a client is connected and watches at least one variable */
+int live_watch_active(void);
+
+/* Target resumed / halted: start and finish one sampling run */
+void live_watch_run_start(void);
+void live_watch_run_stop(void);
+
+/* Call often while the target runs; samples when the next one is due */
+void live_watch_poll(libusb_device_handle *dev);
+
+#endif /* LIVE_WATCH_H */
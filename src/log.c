@@ -0,0 +1,234 @@
+/*
+ * Leveled Logging for OpenLink ColdFire
+ *
+ * The ring is a bounded multi-producer queue: a producer claims an entry
+ * by advancing 'head' with compare-and-swap and publishes it by storing
+ * the entry's sequence number; the writer thread consumes entries in
+ * order. When the ring is full, messages are dropped and counted rather
+ * than blocking the caller.
+ *
+ * License: GPL v3
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "log.h"
+
+volatile int g_log_levels[LOG_NUM_CATEGORIES] = {
+    [LOG_RSP]   = LOG_LEVEL_INFO,
+    [LOG_USB]   = LOG_LEVEL_INFO,
+    [LOG_FLASH] = LOG_LEVEL_INFO,
+    [LOG_RUN]   = LOG_LEVEL_INFO,
+    [LOG_TOOL]  = LOG_LEVEL_INFO,
+};
+
+static const char *const category_names[LOG_NUM_CATEGORIES] = {
+    [LOG_RSP] = "rsp", [LOG_USB] = "usb", [LOG_FLASH] = "flash", [LOG_RUN] = "run",
+    [LOG_TOOL] = "tool"
+};
+
+static const char *const level_names[] = {
+    [LOG_LEVEL_OFF] = "off", [LOG_LEVEL_ERROR] = "error", [LOG_LEVEL_WARN] = "warn",
+    [LOG_LEVEL_INFO] = "info", [LOG_LEVEL_DEBUG] = "debug"
+};
+
+typedef struct {
+    atomic_size_t seq;          /* == index when free, index + 1 when filled */
+    uint8_t level;
+    char msg[LOG_MSG_SIZE];
+} log_entry_t;
+
+static log_entry_t ring[LOG_RING_SIZE];
+static atomic_size_t head;      /* Next entry to claim */
+static size_t tail;             /* Next entry to write (writer thread only) */
+static atomic_ulong dropped;
+static atomic_int running;
+static pthread_t writer_thread;
+
+/* Write one message to its stream */
+static void emit(log_level_t level, const char *msg) {
+    fputs(msg, level <= LOG_LEVEL_WARN ? stderr : stdout);
+}
+
+/* Write all published entries; returns the number written */
+static int drain(void) {
+    int count = 0;
+
+    for (;;) {
+        log_entry_t *e = &ring[tail & (LOG_RING_SIZE - 1)];
+        if (atomic_load_explicit(&e->seq, memory_order_acquire) != tail + 1) {
+            break;
+        }
+        emit(e->level, e->msg);
+        atomic_store_explicit(&e->seq, tail + LOG_RING_SIZE, memory_order_release);
+        tail++;
+        count++;
+    }
+
+    unsigned long n = atomic_exchange(&dropped, 0);
+    if (n) {
+        fprintf(stderr, "log: %lu messages dropped\n", n);
+    }
+    if (count) {
+        fflush(stdout);
+    }
+    return count;
+}
+
+/* Background writer: drain, then back off while idle */
+static void *writer_main(void *arg) {
+    (void)arg;
+    useconds_t idle = 1000;
+
+    while (atomic_load(&running)) {
+        if (drain()) {
+            idle = 1000;
+        } else {
+            usleep(idle);
+            if (idle < 20000) idle *= 2;
+        }
+    }
+    drain();
+    return NULL;
+}
+
+int log_init(void) {
+    if (atomic_load(&running)) {
+        return 0;
+    }
+    for (size_t i = 0; i < LOG_RING_SIZE; i++) {
+        atomic_init(&ring[i].seq, i);
+    }
+    atomic_init(&head, 0);
+    tail = 0;
+
+    atomic_store(&running, 1);
+    if (pthread_create(&writer_thread, NULL, writer_main, NULL) != 0) {
+        atomic_store(&running, 0);
+        return -1;
+    }
+    return 0;
+}
+
+void log_shutdown(void) {
+    if (!atomic_load(&running)) {
+        return;
+    }
+    atomic_store(&running, 0);
+    pthread_join(writer_thread, NULL);
+    fflush(stdout);
+}
+
+void log_write(log_category_t cat, log_level_t level, const char *fmt, ...) {
+    va_list ap;
+    (void)cat;
+
+    if (!atomic_load_explicit(&running, memory_order_relaxed)) {
+        /* No writer thread - write synchronously */
+        va_start(ap, fmt);
+        vfprintf(level <= LOG_LEVEL_WARN ? stderr : stdout, fmt, ap);
+        va_end(ap);
+        return;
+    }
+
+    /* Claim an entry */
+    size_t pos = atomic_load_explicit(&head, memory_order_relaxed);
+    log_entry_t *e;
+    for (;;) {
+        e = &ring[pos & (LOG_RING_SIZE - 1)];
+        size_t seq = atomic_load_explicit(&e->seq, memory_order_acquire);
+        if (seq == pos) {
+            if (atomic_compare_exchange_weak_explicit(&head, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (seq < pos) {
+            /* Ring full */
+            atomic_fetch_add(&dropped, 1);
+            return;
+        } else {
+            pos = atomic_load_explicit(&head, memory_order_relaxed);
+        }
+    }
+
+    va_start(ap, fmt);
+    vsnprintf(e->msg, sizeof(e->msg), fmt, ap);
+    va_end(ap);
+    e->level = level;
+
+    /* Publish */
+    atomic_store_explicit(&e->seq, pos + 1, memory_order_release);
+}
+
+void log_write_lines(log_category_t cat, log_level_t level, const char *text) {
+    if (!log_enabled(cat, level)) {
+        return;
+    }
+    while (*text) {
+        const char *nl = strchr(text, '\n');
+        int len = nl ? (int)(nl - text) : (int)strlen(text);
+        log_write(cat, level, "%.*s\n", len, text);
+        text += nl ? len + 1 : len;
+    }
+}
+
+void log_set_level(log_category_t cat, log_level_t level) {
+    if (cat == LOG_NUM_CATEGORIES) {
+        for (int i = 0; i < LOG_NUM_CATEGORIES; i++) {
+            g_log_levels[i] = level;
+        }
+    } else if (cat < LOG_NUM_CATEGORIES) {
+        g_log_levels[cat] = level;
+    }
+}
+
+/* Look up a name in a table; returns index or -1 */
+static int lookup(const char *name, size_t len, const char *const *table, int count) {
+    for (int i = 0; i < count; i++) {
+        if (strlen(table[i]) == len && strncasecmp(name, table[i], len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int log_parse_spec(const char *spec) {
+    const int num_levels = sizeof(level_names) / sizeof(level_names[0]);
+
+    while (*spec) {
+        size_t item_len = strcspn(spec, ",");
+        const char *eq = memchr(spec, '=', item_len);
+        int cat = LOG_NUM_CATEGORIES;
+        const char *level_str = spec;
+        size_t level_len = item_len;
+
+        if (eq) {
+            cat = lookup(spec, eq - spec, category_names, LOG_NUM_CATEGORIES);
+            if (cat < 0) {
+                fprintf(stderr, "log: unknown category '%.*s'\n", (int)(eq - spec), spec);
+                return -1;
+            }
+            level_str = eq + 1;
+            level_len = item_len - (eq + 1 - spec);
+        }
+
+        int level = lookup(level_str, level_len, level_names, num_levels);
+        if (level < 0) {
+            fprintf(stderr, "log: unknown level '%.*s'\n", (int)level_len, level_str);
+            return -1;
+        }
+        log_set_level((log_category_t)cat, (log_level_t)level);
+
+        spec += item_len;
+        if (*spec == ',') spec++;
+    }
+    return 0;
+}
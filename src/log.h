@@ -0,0 +1,99 @@
+/*
+ * Leveled Logging for OpenLink ColdFire
+ *
+ * Messages are formatted by the caller into a lock-free ring buffer and
+ * written to stdout/stderr by a background thread, so a slow terminal or
+ * log pipe never stalls USB or RSP traffic. A disabled message costs a
+ * single level check.
+ *
+ * Levels are set per category, e.g. "--log rsp=debug,flash=warn".
+ * Before log_init() (and after log_shutdown()) messages are written
+ * synchronously.
+ *
+ * License: GPL v3
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+/* Severity levels */
+typedef enum {
+    LOG_LEVEL_OFF = 0,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG
+} log_level_t;
+
+/* Categories */
+typedef enum {
+    LOG_RSP = 0,    /* GDB remote protocol traffic */
+    LOG_USB,        /* Probe commands */
+    LOG_FLASH,      /* Flash erase/program/verify */
+    LOG_RUN,        /* Run control: continue, step, breakpoints */
+    LOG_TOOL,       /* Dump, core, snapshot, profile, script, patch, daemon */
+    LOG_NUM_CATEGORIES
+} log_category_t;
+
+/* Ring buffer configuration */
+#define LOG_RING_SIZE   4096    /* Entries, must be a power of two */
+#define LOG_MSG_SIZE    240     /* Longest message, longer ones are cut */
+
+extern volatile int g_log_levels[LOG_NUM_CATEGORIES];
+
+/* True if a message of this category and level would be written */
+#define log_enabled(cat, level) ((int)(level) <= g_log_levels[(cat)])
+
+#define LOG(cat, level, ...) \
+    do { if (log_enabled(cat, level)) log_write((cat), (level), __VA_ARGS__); } while (0)
+#define LOG_ERROR(cat, ...) LOG(cat, LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(cat, ...)  LOG(cat, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(cat, ...)  LOG(cat, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(cat, ...) LOG(cat, LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+/*
+ * Start the background writer thread
+ *
+ * @return          0 on success, -1 on error (logging stays synchronous)
+ */
+int log_init(void);
+
+/*
+ * Write out everything still queued and stop the writer thread
+ */
+void log_shutdown(void);
+
+/*
+ * Queue a message (use the LOG_* macros so disabled levels cost nothing)
+ *
+ * @param cat       Category
+ * @param level     Level; LOG_LEVEL_ERROR and LOG_LEVEL_WARN go to stderr
+ * @param fmt       printf format, including the trailing newline
+ */
+void log_write(log_category_t cat, log_level_t level, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/*
+ * Queue a multi-line text as one message per line
+ *
+ * @param cat       Category
+ * @param level     Level
+ * @param text      Lines separated by newlines; the last one may lack it
+ */
+void log_write_lines(log_category_t cat, log_level_t level, const char *text);
+
+/*
+ * Set the level of one category, or of all if cat is LOG_NUM_CATEGORIES
+ */
+void log_set_level(log_category_t cat, log_level_t level);
+
+/*
+ * Apply a level specification
+ *
+ * @param spec      Comma-separated "level" or "category=level" items,
+ *                  e.g. "info", "rsp=debug,flash=warn"
+ * @return          0 on success, -1 on an unknown category or level
+ */
+int log_parse_spec(const char *spec);
+
+#endif /* LOG_H */
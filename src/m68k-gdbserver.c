@@ -19,10 +19,15 @@
 #include <string.h>
 #include <unistd.h>
 #include <signal.h>
+#include <time.h>
+#include <limits.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/stat.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
@@ -31,21 +36,44 @@
 
 #include "flash_gpl.h"
 #include "file_loader.h"
+#include "agent_expr.h"
+#include "log.h"
+#include "init_seq.h"
+#include "board_patch.h"
+#include "live_watch.h"
+#include "profile.h"
+#include "target_ctl.h"
 
 /* Operation modes */
 typedef enum {
     MODE_GDB,       /* GDB server mode (default) */
     MODE_ERASE,     /* Erase only */
-    MODE_PROGRAM    /* Program file to flash */
+    MODE_PROGRAM,   /* Program file to flash */
+    MODE_DAEMON,    /* GDB server plus control socket for CLI requests */
+    MODE_SCRIPT,    /* Batch of operations in one session */
+    MODE_DUMP,      /* Read memory to a file */
+    MODE_COREDUMP,  /* Write an ELF core of the target */
+    MODE_PROFILE    /* Sample the PC of the running target */
 } operation_mode_t;
 
 #define DEFAULT_PORT 3333
-#define MAX_PACKET_SIZE 4096
+#define DEFAULT_CONTROL_SOCKET "/tmp/openlink-coldfire.sock"
+#define CONTROL_LINE_MAX 1024
+#define MAX_PACKET_SIZE 16384       /* Reported to GDB as PacketSize */
+#define RSP_RX_INITIAL  (MAX_PACKET_SIZE + 64)
+#define RSP_RX_LIMIT    (4 * MAX_PACKET_SIZE + 64)  /* Fully escaped packet + framing */
+#define RSP_IOV_MAX     16
 
 /* Common flash configuration */
 #define FLASH_BASE           0x00000000
 #define FLASH_SIZE           0x40000    /* 256KB */
 
+/* MCF52233 SRAM and peripheral window */
+#define SRAM_BASE            0x20000000
+#define SRAM_SIZE            0x8000     /* 32KB */
+#define IPSBAR_BASE          0x40000000
+#define IPSBAR_SIZE          0x200000   /* 2MB */
+
 /* Flash configuration - uses 2KB sectors */
 #define SECTOR_SIZE          FLASH_SECTOR_SIZE  /* 2KB from flash_gpl.h */
 #define MAX_SECTORS          FLASH_NUM_SECTORS  /* 128 sectors from flash_gpl.h */
@@ -59,13 +87,13 @@ typedef enum {
  *   D0-D7, A0-A7, SR, PC
  * Total: 18 registers (17 general + PC)
  */
-#define NUM_REGISTERS 18
-#define REG_D0  0
+#define NUM_REGISTERS TARGET_NUM_REGS
+#define REG_D0  TARGET_REG_D0
 #define REG_D7  7
-#define REG_A0  8
-#define REG_A7  15  /* Also SP */
-#define REG_SR  16
-#define REG_PC  17
+#define REG_A0  TARGET_REG_A0
+#define REG_A7  TARGET_REG_A7   /* Also SP */
+#define REG_SR  TARGET_REG_SR
+#define REG_PC  TARGET_REG_PC
 
 /* BDM register window for CPU registers */
 #define BDM_WINDOW_CPU 0x28800000
@@ -74,8 +102,13 @@ typedef enum {
 static libusb_device_handle *g_usb_dev = NULL;
 static int g_server_socket = -1;
 static int g_client_socket = -1;
+static int g_control_socket = -1;           /* Daemon mode: CLI requests */
+static const char *g_control_path = DEFAULT_CONTROL_SOCKET;
+static int g_target_reinit = 0;             /* Flashloader ran since last init */
 static volatile int g_running = 1;
 static int g_target_halted = 1;
+static int g_noack_mode = 0;    /* QStartNoAckMode agreed - no '+'/'-' */
+static int g_ack_pending = 0;   /* '+' for the current packet not sent yet */
 static int g_step_count = 0;  /* Track single-steps for BDM reset workaround */
 
 /* Signal handler for clean shutdown */
@@ -94,22 +127,115 @@ static uint8_t calc_checksum(const char *data, int len) {
     return sum;
 }
 
-/* Send a GDB RSP packet */
-static int send_packet(int sock, const char *data) {
-    char packet[MAX_PACKET_SIZE];
-    int len = strlen(data);
-    uint8_t checksum = calc_checksum(data, len);
+/* Streaming RSP packet writer
+ * A reply is assembled as a list of payload slices with a running
+ * checksum and handed to writev() in one go, so the payload is never
+ * copied into a packet buffer and may contain binary data. Slices must
+ * stay valid until rsp_end(); if more than RSP_IOV_MAX are appended the
+ * ones so far are written out early.
+ */
+typedef struct {
+    int sock;
+    uint8_t checksum;
+    size_t payload_len;
+    int iovcnt;
+    struct iovec iov[RSP_IOV_MAX];
+    char trailer[3];            /* "#xx" */
+    int error;
+} rsp_writer_t;
+
+/* Write all queued slices */
+static int rsp_flush(rsp_writer_t *w) {
+    struct iovec *iov = w->iov;
+    int iovcnt = w->iovcnt;
+
+    while (iovcnt > 0 && !w->error) {
+        ssize_t n = writev(w->sock, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR(LOG_RSP, "writev: %s\n", strerror(errno));
+            w->error = 1;
+            break;
+        }
+        /* Skip what was written, handling short writes */
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    w->iovcnt = 0;
+    return w->error ? -1 : 0;
+}
 
-    int pkt_len = snprintf(packet, sizeof(packet), "$%s#%02x", data, checksum);
+/* Queue raw bytes (no checksum) */
+static void rsp_queue(rsp_writer_t *w, const void *data, size_t len) {
+    if (len == 0) return;
+    if (w->iovcnt == RSP_IOV_MAX) {
+        rsp_flush(w);
+    }
+    w->iov[w->iovcnt].iov_base = (void *)data;
+    w->iov[w->iovcnt].iov_len = len;
+    w->iovcnt++;
+}
 
-    printf("TX: %s\n", packet);
-    fflush(stdout);
+/* Start a packet, preceded by the ack of the packet being answered */
+static void rsp_begin(rsp_writer_t *w, int sock) {
+    w->sock = sock;
+    w->checksum = 0;
+    w->payload_len = 0;
+    w->iovcnt = 0;
+    w->error = 0;
+    if (g_ack_pending) {
+        rsp_queue(w, "+", 1);
+        g_ack_pending = 0;
+    }
+    rsp_queue(w, "$", 1);
+}
 
-    if (send(sock, packet, pkt_len, 0) != pkt_len) {
-        perror("send");
-        return -1;
+/* Append a payload slice */
+static void rsp_append(rsp_writer_t *w, const void *data, size_t len) {
+    w->checksum += calc_checksum(data, len);
+    w->payload_len += len;
+    rsp_queue(w, data, len);
+}
+
+/* Finish the packet and send it */
+static int rsp_end(rsp_writer_t *w) {
+    static const char hex[] = "0123456789abcdef";
+    w->trailer[0] = '#';
+    w->trailer[1] = hex[w->checksum >> 4];
+    w->trailer[2] = hex[w->checksum & 0xF];
+    rsp_queue(w, w->trailer, 3);
+    return rsp_flush(w);
+}
+
+/* Send a GDB RSP packet with a payload of known length */
+static int send_packet_len(int sock, const char *data, size_t len) {
+    rsp_writer_t w;
+    rsp_begin(&w, sock);
+    rsp_append(&w, data, len);
+
+    LOG_DEBUG(LOG_RSP, "TX: $%.*s#%02x\n", (int)(len > 256 ? 256 : len), data, w.checksum);
+
+    return rsp_end(&w);
+}
+
+/* Send a GDB RSP packet */
+static int send_packet(int sock, const char *data) {
+    return send_packet_len(sock, data, strlen(data));
+}
+
+/* Send the ack for the current packet now rather than with the reply */
+static void send_pending_ack(int sock) {
+    if (g_ack_pending) {
+        g_ack_pending = 0;
+        send(sock, "+", 1, 0);
     }
-    return 0;
 }
 
 /* Send an empty/OK response */
@@ -260,6 +386,27 @@ static uint32_t g_cached_sp = 0;
 static uint32_t g_cached_pc = 0;
 static int g_registers_initialized = 0;
 
+/* Register snapshot of the halted target, filled lazily and kept until
+ * the target resumes. Stop-reason checks, breakpoint conditions and
+ * 'g'/'p' reuse it instead of asking the target again; register writes
+ * update it.
+ */
+static uint32_t g_halt_regs[NUM_REGISTERS];
+static uint32_t g_halt_regs_valid = 0;  /* Bit n set = g_halt_regs[n] valid */
+
+/* SRAM contents read since the last halt, see read_target_memory() */
+#define SRAM_CACHE_LINE      64
+static struct {
+    uint8_t data[SRAM_SIZE];
+    uint8_t valid[SRAM_SIZE / SRAM_CACHE_LINE];
+} sram_cache;
+
+/* Forget state captured at the last halt (call before the target runs) */
+static void invalidate_halt_state(void) {
+    g_halt_regs_valid = 0;
+    memset(sram_cache.valid, 0, sizeof(sram_cache.valid));
+}
+
 /* Initialize register cache from flash vector table */
 static void init_register_cache(void) {
     if (g_registers_initialized) return;
@@ -273,99 +420,83 @@ static void init_register_cache(void) {
     }
 }
 
-/* Read a ColdFire CPU register via BDM
- * Uses the correct BDM read methods:
- * - PC: cmd_read_pc() (uses 07 11 with window 0x2980)
- * - SR: cmd_read_sr() (uses 07 11 with window 0x2980)
- * - D0-D7, A0-A7: cmd_07_13() (uses 07 13 with opcode 0x218x)
+/* Read a ColdFire CPU register via BDM (see target_reg_read())
+ * Returns: 0 on success, 1 if a fallback value was substituted
  */
-static int read_cpu_register(int reg_num, uint32_t *value) {
+static int read_cpu_register_bdm(int reg_num, uint32_t *value) {
     init_register_cache();
 
-    /* For PC, use cmd_read_pc() which properly reads via 07 11
-     * Note: cmd_07_13 with 0x298F returns stale data after a PC write!
-     */
+    if (reg_num < 0 || reg_num >= NUM_REGISTERS) {
+        *value = 0;
+        return 0;
+    }
+    int r = target_reg_read(g_usb_dev, reg_num, value);
+
     if (reg_num == REG_PC) {
-        int r = cmd_read_pc(g_usb_dev, value);
         if (r != 0) {
             *value = g_cached_pc;  /* Fall back to cached value on error */
+            return 1;
         }
         return 0;
     }
 
-    /* For SR, use cmd_read_sr() */
     if (reg_num == REG_SR) {
-        int r = cmd_read_sr(g_usb_dev, value);
         if (r != 0) {
             *value = 0x2700;  /* Default: supervisor mode, interrupts disabled */
+            return 1;
         }
         return 0;
     }
 
-    /* For SP (A7), try BDM read first, fall back to cached */
+    /* For SP (A7), fall back to the cached value */
     if (reg_num == REG_A7) {
-        int r = cmd_07_13(g_usb_dev, 0x218F, value);
         if (r != 0 || *value == 0) {
-            printf("A7 read: r=%d, value=0x%08X, using cached=0x%08X\n", r, *value, g_cached_sp);
+            LOG_DEBUG(LOG_RUN, "A7 read: r=%d, value=0x%08X, using cached=0x%08X\n", r, *value, g_cached_sp);
             *value = g_cached_sp;  /* Fall back to cached value */
+            return 1;
         }
         return 0;
     }
 
-    /* Read D0-D7, A0-A6 via BDM using correct READ addresses
-     * From MCF52235 Reference Manual:
-     *   Read A/D register: 0x218{A/D,Reg[2:0]}
-     *   - D0-D7: 0x2180-0x2187 (READ)
-     *   - A0-A7: 0x2188-0x218F (READ)
-     */
-    uint16_t bdm_reg;
-    if (reg_num >= REG_D0 && reg_num <= REG_D7) {
-        bdm_reg = 0x2180 + reg_num;  /* D0=0x2180, D7=0x2187 */
-    } else if (reg_num >= REG_A0 && reg_num <= REG_A7) {
-        bdm_reg = 0x2188 + (reg_num - REG_A0);  /* A0=0x2188, A7=0x218F */
-    } else {
-        *value = 0;
-        return 0;
-    }
-
-    int r = cmd_07_13(g_usb_dev, bdm_reg, value);
     if (r != 0) {
         *value = 0;  /* Return 0 on error */
+        return 1;
     }
     return 0;
 }
 
-/* Write a ColdFire CPU register via BDM
- * Uses cmd_write_pc() for PC (includes sync), cmd_07_14_write_bdm_reg for others
- *
- * BDM Store (write) register addresses:
- *   D0-D7: 0x0180-0x0187
- *   A0-A6: 0x0188-0x018E
- *   A7:    0x018F (active stack pointer)
- *   PC:    0x080F (handled by cmd_write_pc)
- *   SR:    0x080E
- */
-static int write_cpu_register(int reg_num, uint32_t value) {
-    /* For PC, use cmd_write_pc() which includes proper sync command */
-    if (reg_num == REG_PC) {
-        return cmd_write_pc(g_usb_dev, value);
+/* Read a CPU register, served from the halt-time snapshot when possible */
+static int read_cpu_register(int reg_num, uint32_t *value) {
+    if (reg_num < 0 || reg_num >= NUM_REGISTERS) {
+        *value = 0;
+        return 0;
     }
 
-    uint16_t bdm_reg;
+    if (g_halt_regs_valid & (1u << reg_num)) {
+        *value = g_halt_regs[reg_num];
+        return 0;
+    }
 
-    if (reg_num >= REG_D0 && reg_num <= REG_D7) {
-        /* D0-D7: BDM store registers 0x0180-0x0187 */
-        bdm_reg = 0x0180 + reg_num;
-    } else if (reg_num >= REG_A0 && reg_num <= REG_A7) {
-        /* A0-A7: BDM store registers 0x0188-0x018F */
-        bdm_reg = 0x0188 + (reg_num - REG_A0);
-    } else if (reg_num == REG_SR) {
-        bdm_reg = 0x080E;  /* SR */
-    } else {
-        return -1;
+    /* Fallback values are not cached so the next read tries again */
+    if (read_cpu_register_bdm(reg_num, value) == 0 && g_target_halted) {
+        g_halt_regs[reg_num] = *value;
+        g_halt_regs_valid |= 1u << reg_num;
     }
+    return 0;
+}
 
-    return cmd_07_14_write_bdm_reg(g_usb_dev, bdm_reg, value);
+/* Write a CPU register and keep the halt-time snapshot in step */
+static int write_cpu_register(int reg_num, uint32_t value) {
+    int r = target_reg_write(g_usb_dev, reg_num, value);
+    if (reg_num >= 0 && reg_num < NUM_REGISTERS) {
+        if (r == 0) {
+            g_halt_regs[reg_num] = value;
+            g_halt_regs_valid |= 1u << reg_num;
+        } else {
+            g_halt_regs_valid &= ~(1u << reg_num);
+        }
+    }
+    return r;
 }
 
 /* Handle 'g' - read all registers */
@@ -456,6 +587,365 @@ static int handle_write_register(int sock, const char *data) {
     return send_ok(sock);
 }
 
+/*
+ * Memory Access
+ */
+
+/* Flash content cache
+ * Flash only changes through this server's own erase/program paths, so a
+ * host-side copy of the 256KB array is filled lazily one sector at a time
+ * and kept exact by flash_cache_erased()/flash_cache_programmed().
+ */
+#define FLASH_CACHE_PAGES   (FLASH_SIZE / SECTOR_SIZE)
+
+static struct {
+    uint8_t data[FLASH_SIZE];
+    uint8_t valid[FLASH_CACHE_PAGES];   /* Sector contents are known */
+} flash_cache;
+
+/* Read target memory over BDM, in the largest blocks the probe supports */
+static int read_target_direct(uint32_t addr, uint8_t *buf, uint32_t len) {
+    return openlink_read_memory(g_usb_dev, addr, len, buf);
+}
+
+/* Make sure the flash sectors covering addr..addr+len are cached */
+static int flash_cache_fill(uint32_t addr, uint32_t len) {
+    uint32_t last = (addr + len - 1) / SECTOR_SIZE;
+    for (uint32_t page = addr / SECTOR_SIZE; page <= last; page++) {
+        if (flash_cache.valid[page]) {
+            continue;
+        }
+        uint32_t run = page;
+        while (run + 1 <= last && !flash_cache.valid[run + 1]) {
+            run++;
+        }
+        if (read_target_direct(page * SECTOR_SIZE, flash_cache.data + page * SECTOR_SIZE,
+                               (run - page + 1) * SECTOR_SIZE) != 0) {
+            return -1;
+        }
+        memset(&flash_cache.valid[page], 1, run - page + 1);
+        page = run;
+    }
+    return 0;
+}
+
+/* Serve a read that lies entirely inside flash from the cache */
+static int flash_cache_read(uint32_t addr, uint8_t *buf, uint32_t len) {
+    if (flash_cache_fill(addr, len) != 0) {
+        return -1;
+    }
+    memcpy(buf, flash_cache.data + addr, len);
+    return 0;
+}
+
+/* Forget cached flash contents (all of flash if len is 0) */
+static void flash_cache_invalidate(uint32_t addr, uint32_t len) {
+    if (len == 0) {
+        memset(flash_cache.valid, 0, sizeof(flash_cache.valid));
+        return;
+    }
+    if (addr >= FLASH_SIZE) {
+        return;
+    }
+    uint32_t end = (addr + len > FLASH_SIZE) ? FLASH_SIZE : addr + len;
+    for (uint32_t page = addr / SECTOR_SIZE; page * SECTOR_SIZE < end; page++) {
+        flash_cache.valid[page] = 0;
+    }
+}
+
+/* Sectors covering addr..addr+len were erased (the flashloader erases
+ * whole sectors), so their contents are known without reading them back
+ */
+static void flash_cache_erased(uint32_t addr, uint32_t len) {
+    for (uint32_t page = addr / SECTOR_SIZE;
+         page * SECTOR_SIZE < addr + len && page < FLASH_CACHE_PAGES; page++) {
+        memset(flash_cache.data + page * SECTOR_SIZE, 0xFF, SECTOR_SIZE);
+        flash_cache.valid[page] = 1;
+    }
+}
+
+/* Data was programmed at addr - programming can only clear bits, so a
+ * known sector becomes old & new. Right after an erase this seeds the
+ * cache with the image GDB just loaded.
+ */
+static void flash_cache_programmed(uint32_t addr, const uint8_t *data, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        if (flash_cache.valid[(addr + i) / SECTOR_SIZE]) {
+            flash_cache.data[addr + i] &= data[i];
+        }
+    }
+}
+
+/* Make sure the SRAM lines covering addr..addr+len are cached
+ * Missing lines are fetched in runs so a large read is still one pass.
+ */
+static int sram_cache_fill(uint32_t addr, uint32_t len) {
+    uint32_t first = (addr - SRAM_BASE) / SRAM_CACHE_LINE;
+    uint32_t last = (addr + len - 1 - SRAM_BASE) / SRAM_CACHE_LINE;
+
+    for (uint32_t line = first; line <= last; line++) {
+        if (sram_cache.valid[line]) {
+            continue;
+        }
+        uint32_t run = line;
+        while (run + 1 <= last && !sram_cache.valid[run + 1]) {
+            run++;
+        }
+        uint32_t offset = line * SRAM_CACHE_LINE;
+        if (read_target_direct(SRAM_BASE + offset, sram_cache.data + offset,
+                               (run - line + 1) * SRAM_CACHE_LINE) != 0) {
+            return -1;
+        }
+        memset(&sram_cache.valid[line], 1, run - line + 1);
+        line = run;
+    }
+    return 0;
+}
+
+/* Serve a read that lies entirely inside SRAM from the halt cache */
+static int sram_cache_read(uint32_t addr, uint8_t *buf, uint32_t len) {
+    if (sram_cache_fill(addr, len) != 0) {
+        return -1;
+    }
+    memcpy(buf, sram_cache.data + (addr - SRAM_BASE), len);
+    return 0;
+}
+
+/* How reads of a region may be cached */
+typedef enum {
+    MEM_CACHE_NONE,     /* Always read the target (side effects) */
+    MEM_CACHE_FLASH,    /* Until the server erases/programs it */
+    MEM_CACHE_HALT      /* Until the target runs again */
+} mem_cache_policy_t;
+
+/* Target memory map - also reported to GDB by qXfer:memory-map */
+static const struct {
+    uint32_t start;
+    uint32_t length;
+    const char *type;       /* GDB memory type: "flash" or "ram" */
+    uint32_t blocksize;     /* Flash erase unit */
+    mem_cache_policy_t cache;
+} mem_regions[] = {
+    { FLASH_BASE,  FLASH_SIZE,  "flash", SECTOR_SIZE, MEM_CACHE_FLASH },
+    { SRAM_BASE,   SRAM_SIZE,   "ram",   0,           MEM_CACHE_HALT  },
+    { IPSBAR_BASE, IPSBAR_SIZE, "ram",   0,           MEM_CACHE_NONE  },  /* Peripherals */
+};
+#define NUM_MEM_REGIONS (sizeof(mem_regions) / sizeof(mem_regions[0]))
+
+/* Find the region containing addr, or the first region above it.
+ * Returns NUM_MEM_REGIONS when addr is above every region.
+ */
+static unsigned find_mem_region(uint32_t addr) {
+    unsigned i;
+    for (i = 0; i < NUM_MEM_REGIONS; i++) {
+        if (addr < mem_regions[i].start + mem_regions[i].length) {
+            break;
+        }
+    }
+    return i;
+}
+
+/* Read target memory, using the cache policy of each region it touches */
+static int read_target_memory(uint32_t addr, uint8_t *buf, uint32_t len) {
+    while (len > 0) {
+        unsigned i = find_mem_region(addr);
+        uint32_t n = len;
+        mem_cache_policy_t cache = MEM_CACHE_NONE;
+
+        if (i < NUM_MEM_REGIONS) {
+            if (addr < mem_regions[i].start) {
+                /* Unmapped gap below the region */
+                if (n > mem_regions[i].start - addr) {
+                    n = mem_regions[i].start - addr;
+                }
+            } else {
+                if (n > mem_regions[i].start + mem_regions[i].length - addr) {
+                    n = mem_regions[i].start + mem_regions[i].length - addr;
+                }
+                cache = mem_regions[i].cache;
+            }
+        }
+
+        int r;
+        if (cache == MEM_CACHE_FLASH) {
+            r = flash_cache_read(addr, buf, n);
+        } else if (cache == MEM_CACHE_HALT && g_target_halted) {
+            r = sram_cache_read(addr, buf, n);
+        } else {
+            r = read_target_direct(addr, buf, n);
+        }
+        if (r != 0) {
+            return -1;
+        }
+        addr += n;
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Sequential read detection
+ * GDB disassembles, dumps arrays and scans strings with a stream of small
+ * 'm' packets. Once two reads in a row continue where the previous one
+ * ended, the following window is fetched into the cache after the reply
+ * has been sent, i.e. while GDB is busy with it. The window doubles on
+ * each sequential hit up to the probe's block size.
+ */
+#define READ_AHEAD_MIN       256
+
+static struct {
+    uint32_t next_addr;     /* Where a sequential read would start */
+    uint32_t window;        /* Current read-ahead size, 0 = not sequential */
+} read_ahead;
+
+/* Note a GDB memory read and prefetch behind it if it is sequential */
+static void read_ahead_after(uint32_t addr, uint32_t len) {
+    if (addr != read_ahead.next_addr || len == 0) {
+        read_ahead.next_addr = addr + len;
+        read_ahead.window = 0;
+        return;
+    }
+    read_ahead.next_addr = addr + len;
+
+    if (read_ahead.window == 0) {
+        read_ahead.window = READ_AHEAD_MIN;
+    } else if (read_ahead.window < (uint32_t)openlink_read_block_size(g_usb_dev)) {
+        read_ahead.window *= 2;
+    }
+
+    /* Cached lines/sectors are skipped by the fill, so only the part not
+     * covered by earlier read-ahead goes to the target
+     */
+    uint32_t start = addr + len;
+    uint32_t end = start + read_ahead.window;
+
+    unsigned i = find_mem_region(start);
+    if (i >= NUM_MEM_REGIONS || start < mem_regions[i].start) {
+        return;
+    }
+    if (end > mem_regions[i].start + mem_regions[i].length) {
+        end = mem_regions[i].start + mem_regions[i].length;
+    }
+
+    if (mem_regions[i].cache == MEM_CACHE_FLASH) {
+        flash_cache_fill(start, end - start);
+    } else if (mem_regions[i].cache == MEM_CACHE_HALT && g_target_halted) {
+        sram_cache_fill(start, end - start);
+    }
+    /* Peripherals are never read speculatively */
+}
+
+/* Keep the caches in step with data written to the target */
+static void memory_cache_written(uint32_t addr, const uint8_t *data, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        uint32_t a = addr + i;
+        if (a < FLASH_BASE + FLASH_SIZE) {
+            /* Flash ignores bus writes - re-read it rather than trust the cache */
+            flash_cache.valid[(a - FLASH_BASE) / SECTOR_SIZE] = 0;
+        } else if (a >= SRAM_BASE && a < SRAM_BASE + SRAM_SIZE &&
+                   sram_cache.valid[(a - SRAM_BASE) / SRAM_CACHE_LINE]) {
+            sram_cache.data[a - SRAM_BASE] = data[i];
+        }
+    }
+}
+
+/* Write one longword (big-endian value) to the target with cmd_07_19 */
+static int write_target_long(uint32_t addr, uint32_t value) {
+    if (cmd_07_19(g_usb_dev, addr, value) != 0) {
+        return -1;
+    }
+    uint8_t bytes[4] = { value >> 24, value >> 16, value >> 8, value };
+    memory_cache_written(addr, bytes, 4);
+    return 0;
+}
+
+/* Writes of at least this many bytes to RAM go out as bb 66 blocks */
+#define BULK_WRITE_THRESHOLD 64
+
+/* Write peripheral registers with accesses of their natural width: bytes
+ * and words at unaligned edges, longwords in between. Nothing is read
+ * back - reading a register can clear status or FIFO bits, and a wider
+ * write would overwrite its neighbours.
+ */
+static int write_target_sized(uint32_t addr, const uint8_t *buf, uint32_t len) {
+    while (len > 0) {
+        uint32_t n;
+        int r;
+        if ((addr & 3) == 0 && len >= 4) {
+            n = 4;
+            r = write_target_long(addr, ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) |
+                                        ((uint32_t)buf[2] << 8) | buf[3]);
+        } else if ((addr & 1) == 0 && len >= 2) {
+            n = 2;
+            r = cmd_write_memory_word_addr(g_usb_dev, addr, (buf[0] << 8) | buf[1]);
+        } else {
+            n = 1;
+            r = cmd_write_memory_byte_addr(g_usb_dev, addr, buf[0]);
+        }
+        if (r != 0) {
+            return -1;
+        }
+        addr += n;
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Write target memory
+ * Large writes that lie inside one cacheable RAM region use the block
+ * download path; peripherals get sized accesses (write_target_sized());
+ * everything else is written a longword at a time with cmd_07_19.
+ * Returns: 0 on success, -1 on failure
+ */
+static int write_target_memory(uint32_t addr, const uint8_t *buf, uint32_t len) {
+    unsigned region = find_mem_region(addr);
+    if (len >= BULK_WRITE_THRESHOLD && region < NUM_MEM_REGIONS &&
+        mem_regions[region].cache == MEM_CACHE_HALT && addr >= mem_regions[region].start &&
+        addr + len <= mem_regions[region].start + mem_regions[region].length) {
+        if (openlink_write_memory(g_usb_dev, addr, buf, len) != 0) {
+            return -1;
+        }
+        memory_cache_written(addr, buf, len);
+        return 0;
+    }
+
+    /* Read-modify-write of a partial longword is only safe in memory */
+    if (region >= NUM_MEM_REGIONS || addr < mem_regions[region].start ||
+        mem_regions[region].cache == MEM_CACHE_NONE) {
+        return write_target_sized(addr, buf, len);
+    }
+
+    for (uint32_t i = 0; i < len; i += 4) {
+        uint32_t value = 0;
+        uint32_t bytes_to_write = (len - i >= 4) ? 4 : (len - i);
+
+        if (bytes_to_write < 4) {
+            /* Keep the bytes after the end of the write */
+            uint8_t word[4];
+            if (read_target_memory(addr + i, word, 4) != 0) {
+                return -1;
+            }
+            memcpy(word, buf + i, bytes_to_write);
+            value = ((uint32_t)word[0] << 24) | ((uint32_t)word[1] << 16) |
+                    ((uint32_t)word[2] << 8) | word[3];
+        } else {
+            value = ((uint32_t)buf[i] << 24) | ((uint32_t)buf[i + 1] << 16) |
+                    ((uint32_t)buf[i + 2] << 8) | buf[i + 3];
+        }
+
+        if (write_target_long(addr + i, value) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Breakpoint shadowing, defined with the breakpoint table below */
+static void breakpoint_shadow_read(uint32_t addr, uint8_t *buf, uint32_t len);
+static void breakpoint_shadow_write(uint32_t addr, uint8_t *buf, uint32_t len);
+static int count_watchpoints(void);
+
 /* Handle 'm' - read memory */
 static int handle_read_memory(int sock, const char *data) {
     char *comma = strchr(data, ',');
@@ -475,11 +965,12 @@ static int handle_read_memory(int sock, const char *data) {
         return send_error(sock, 12);  /* ENOMEM */
     }
 
-    int result = cmd_0717_read_memory(g_usb_dev, addr, len, buffer, len);
+    int result = read_target_memory(addr, buffer, len);
     if (result != 0) {
         free(buffer);
         return send_error(sock, 5);  /* EIO */
     }
+    breakpoint_shadow_read(addr, buffer, len);
 
     char *response = malloc(len * 2 + 1);
     if (!response) {
@@ -492,6 +983,9 @@ static int handle_read_memory(int sock, const char *data) {
 
     free(buffer);
     free(response);
+
+    /* Prefetch while GDB processes the reply */
+    read_ahead_after(addr, len);
     return ret;
 }
 
@@ -507,31 +1001,60 @@ static int handle_write_memory(int sock, const char *data) {
     uint32_t len = strtoul(comma + 1, NULL, 16);
     const char *hex_data = colon + 1;
 
-    /* Write memory using cmd_07_19 (32-bit writes) */
-    for (uint32_t i = 0; i < len; i += 4) {
-        uint32_t value = 0;
-        int bytes_to_write = (len - i >= 4) ? 4 : (len - i);
+    uint8_t *buffer = malloc(len ? len : 1);
+    if (!buffer) {
+        return send_error(sock, 12);  /* ENOMEM */
+    }
+    if (hex_to_bytes(hex_data, buffer, len) != (int)len) {
+        free(buffer);
+        return send_error(sock, 1);
+    }
 
-        for (int j = 0; j < bytes_to_write; j++) {
-            int hi = hex_to_nibble(hex_data[(i + j) * 2]);
-            int lo = hex_to_nibble(hex_data[(i + j) * 2 + 1]);
-            if (hi >= 0 && lo >= 0) {
-                value |= ((hi << 4) | lo) << (24 - j * 8);
-            }
-        }
+    /* Keep installed software breakpoints armed */
+    breakpoint_shadow_write(addr, buffer, len);
 
-        if (cmd_07_19(g_usb_dev, addr + i, value) != 0) {
-            return send_error(sock, 5);
-        }
+    if (write_target_memory(addr, buffer, len) != 0) {
+        free(buffer);
+        return send_error(sock, 5);
     }
 
+    free(buffer);
     return send_ok(sock);
 }
 
-/* CSR bit definitions for ColdFire V2 Debug Module */
-#define CSR_SSM     (1 << 4)    /* Single Step Mode */
-#define CSR_READ    0x2D80      /* Read CSR address */
-#define CSR_WRITE   0x2C80      /* Write CSR address */
+/* Handle 'X' - write memory, binary data
+ * Format: Xaddr,length:binary
+ * The payload is un-escaped in place in the packet buffer and written
+ * from there. GDB probes support with a zero-length write at load time.
+ */
+static int handle_write_memory_binary(int sock, char *data, int data_len) {
+    char *colon = memchr(data, ':', data_len);
+    char *comma = strchr(data, ',');
+    if (!comma || !colon || comma > colon) {
+        return send_error(sock, 1);
+    }
+
+    uint32_t addr = strtoul(data, NULL, 16);
+    uint32_t len = strtoul(comma + 1, NULL, 16);
+    uint8_t *buffer = (uint8_t *)colon + 1;
+    size_t bin_len = data_len - (colon + 1 - data);
+
+    if (rsp_unescape_binary(buffer, bin_len) != len) {
+        LOG_WARN(LOG_RSP, "X: length mismatch at 0x%08X (expected %u)\n", addr, len);
+        return send_error(sock, 1);
+    }
+    if (len == 0) {
+        return send_ok(sock);
+    }
+
+    /* Keep installed software breakpoints armed */
+    breakpoint_shadow_write(addr, buffer, len);
+
+    if (write_target_memory(addr, buffer, len) != 0) {
+        return send_error(sock, 5);
+    }
+    return send_ok(sock);
+}
 
 /* ColdFire V2 Debug Module Registers (DRc[4-0])
  * From MCF52235 Reference Manual Table 31-3
@@ -571,26 +1094,40 @@ static int handle_write_memory(int sock, const char *data) {
 #define DBMR_READ   0x2D8F
 #define DBMR_WRITE  0x2C8F
 
-/* TDR bit definitions */
+/* TDR bit definitions (MCF52235 RM, Trigger Definition Register)
+ * TDR[31:30] is the trigger response, TDR[29:16] the level 2 trigger and
+ * TDR[13:0] the level 1 trigger. Only level 1 is used.
+ */
 #define TDR_TRC_HALT    (1 << 30)  /* Halt on trigger */
-#define TDR_LPC1_ANY    (3 << 28)  /* PC breakpoint 1 any */
-#define TDR_LPC_MASK    0x0F000000 /* PC breakpoint enable mask */
 #define TDR_EBL1        (1 << 13)  /* Enable breakpoint level 1 */
-#define TDR_EDLW1       (1 << 12)  /* Enable data/longword level 1 */
-#define TDR_EAI1        (1 << 11)  /* Enable address/instruction level 1 */
-#define TDR_EAR1        (1 << 10)  /* Enable address range level 1 */
-#define TDR_EPC1        (1 << 9)   /* Enable PC level 1 */
-
-/* Address comparison mode bits in TDR */
-#define TDR_EAL_MASK    (0x3 << 14) /* Address level comparison mode */
-#define TDR_EAL_INSIDE  (0x1 << 14) /* Trigger when inside range */
-#define TDR_EAL_OUTSIDE (0x2 << 14) /* Trigger when outside range */
-#define TDR_EAL_EXACT   (0x0 << 14) /* Trigger on exact address match */
-
-/* Data/RW mode bits */
-#define TDR_DRW_READ    (1 << 21)  /* Match on read */
-#define TDR_DRW_WRITE   (1 << 20)  /* Match on write */
-#define TDR_DRW_RW      (3 << 20)  /* Match on read or write */
+#define TDR_EDLW1       (1 << 12)  /* Data longword, bits 31..0 */
+#define TDR_EDWL1       (1 << 11)  /* Lower word, bits 15..0 */
+#define TDR_EDWU1       (1 << 10)  /* Upper word, bits 31..16 */
+#define TDR_EDLL1       (1 << 9)   /* Byte, bits 7..0 */
+#define TDR_EDLM1       (1 << 8)   /* Byte, bits 15..8 */
+#define TDR_EDUM1       (1 << 7)   /* Byte, bits 23..16 */
+#define TDR_EDUU1       (1 << 6)   /* Byte, bits 31..24 */
+#define TDR_ED1_MASK    (0x7F << 6) /* All level 1 data enables */
+#define TDR_DI1         (1 << 5)   /* Invert the data compare */
+#define TDR_EAI1        (1 << 4)   /* Address outside ABLR..ABHR */
+#define TDR_EAR1        (1 << 3)   /* Address inside ABLR..ABHR */
+#define TDR_EAL1        (1 << 2)   /* Address equal to ABLR */
+#define TDR_EA1_MASK    (TDR_EAI1 | TDR_EAR1 | TDR_EAL1)
+#define TDR_EPC1        (1 << 1)   /* PC breakpoint (PBR0-PBR3) */
+#define TDR_PCI1        (1 << 0)   /* Invert the PC breakpoint */
+
+/* Read/write qualification of the address trigger lives in AATR, not TDR.
+ * Reset value 0x0005 matches supervisor data writes only.
+ */
+#define AATR_RM         (1 << 15)  /* Ignore R: match reads and writes */
+#define AATR_R          (1 << 7)   /* Match reads (clear: writes) */
+#define AATR_DATA       0x0405     /* Normal data access; TMM masks the S bit */
+
+/* PBR1-PBR3 only compare while their valid bit is set. PBR0 has no valid
+ * bit, so an unused PBR0 holds an address where no code can run.
+ */
+#define PBR_VALID       (1 << 0)
+#define PBR0_UNUSED     0xFFFFFFFE
 
 /* Breakpoint state tracking */
 #define MAX_HW_BREAKPOINTS 4
@@ -603,23 +1140,60 @@ static int hw_breakpoint_used[MAX_HW_BREAKPOINTS] = {0, 0, 0, 0};
  */
 static uint32_t tdr_shadow = 0;
 
-/* Software breakpoint tracking */
-#define MAX_SW_BREAKPOINTS 32
+/* Software breakpoint opcode */
 #define COLDFIRE_HALT_OPCODE 0x4AC8  /* HALT instruction */
-static struct {
+
+/* Breakpoint table (Z0/Z1)
+ * Z and z packets only update the desired state ('want') of an entry. Nothing
+ * is written to the target until the next resume, when sync_breakpoints()
+ * compares the desired state against what is installed and applies only the
+ * net difference. GDB removes and re-inserts every breakpoint around each
+ * stop, so an unchanged breakpoint set costs no target I/O at all.
+ *
+ * Entries live in a chained hash table keyed by address. It grows on demand,
+ * so the number of software breakpoints is limited only by host memory.
+ */
+#define BP_WANT_SW  0x01    /* Requested via Z0 (hardware used if available) */
+#define BP_WANT_HW  0x02    /* Requested via Z1 (hardware only) */
+#define BP_HASH_INITIAL_BITS 6  /* 64 buckets */
+
+/* Condition bytecode attached to a breakpoint (ConditionalBreakpoints+).
+ * The target stops only if at least one condition evaluates non-zero.
+ */
+typedef struct bp_cond {
+    struct bp_cond *next;
+    size_t len;
+    uint8_t code[];         /* Agent expression bytecode */
+} bp_cond_t;
+
+typedef struct breakpoint {
     uint32_t addr;
-    uint16_t original_insn;
-    int active;
-} sw_breakpoints[MAX_SW_BREAKPOINTS];
+    uint8_t want;           /* BP_WANT_* flags, 0 = removed by GDB */
+    int8_t hw_slot;         /* Installed PBR slot, -1 if not in hardware */
+    uint8_t sw_installed;   /* HALT opcode currently in target memory */
+    uint16_t original_insn; /* Instruction replaced by HALT */
+    bp_cond_t *conds;       /* Conditions, NULL = unconditional */
+    struct breakpoint *next;  /* Hash chain */
+} breakpoint_t;
+
+static breakpoint_t **bp_hash = NULL;
+static unsigned bp_hash_bits = 0;
+static unsigned bp_count = 0;           /* Entries in the table */
+static unsigned bp_hw_wanted = 0;       /* Entries requested via Z1 */
+static unsigned bp_sw_installed = 0;    /* HALT opcodes in target memory */
 
 /* Watchpoint (data breakpoint) tracking
- * ColdFire V2 supports ONE address range watchpoint via ABLR/ABHR/TDR
+ * ColdFire V2 has ONE address range comparator (ABLR/ABHR) and one data
+ * comparator (DBR/DBMR). Several GDB watchpoints share the comparator by
+ * programming the range that covers all of them; halts that hit none of
+ * them are filtered out in the server (see check_watchpoint_hit()).
  * Types:
  *   2 = write watchpoint (break on write)
  *   3 = read watchpoint (break on read)
  *   4 = access watchpoint (break on read or write)
  */
-#define MAX_WATCHPOINTS 1
+#define MAX_WATCHPOINTS 4
+#define WP_SNAPSHOT_MAX 8   /* Bytes compared to find which write watch hit */
 typedef enum {
     WP_TYPE_NONE = 0,
     WP_TYPE_WRITE = 2,      /* GDB Z2 */
@@ -632,8 +1206,33 @@ static struct {
     uint32_t length;        /* Size of watched region */
     watchpoint_type_t type; /* Type of watchpoint */
     int active;             /* Is this slot in use? */
+    uint8_t snapshot[WP_SNAPSHOT_MAX];  /* Contents before the last resume */
+    bp_cond_t *conds;       /* Z2/Z3/Z4 cond_list, NULL = unconditional */
 } watchpoints[MAX_WATCHPOINTS];
 
+/* Data value match (DBR/DBMR). A watchpoint whose condition compares the
+ * variable with a constant arms it directly (see watch_condition_value());
+ * otherwise "monitor watch-value" sets it here. GDB removes its
+ * watchpoints at every stop and inserts them again on resume, so the
+ * monitor match belongs to the watched variable (addr/length), not to a
+ * slot, and is armed whenever that variable is the only one watched. The
+ * value is placed in the variable's byte lanes and only those lanes are
+ * compared.
+ */
+static struct {
+    int active;
+    uint32_t addr;          /* Watched variable the match belongs to */
+    uint32_t length;
+    uint32_t value;         /* Value as the user gave it */
+    uint32_t mask;          /* Bits of 'value' that must match */
+} watch_data;
+
+/* Most recent Z2/Z3/Z4, the variable "monitor watch-value" refers to */
+static struct {
+    uint32_t addr;
+    uint32_t length;
+} watch_last;
+
 /* Flash programming state for vFlash* commands */
 static struct {
     int initialized;           /* Flashloader initialized */
@@ -649,29 +1248,7 @@ static struct {
 
 /* Read the Debug Module CSR */
 static int read_csr(uint32_t *value) {
-    return cmd_07_13(g_usb_dev, CSR_READ, value);
-}
-
-/* Write the Debug Module CSR */
-static int write_csr(uint32_t value) {
-    /* Use cmd_07_14_write_bdm_reg which uses the proper BDM register write protocol
-     * with window base 0x28800000 (command 07 14), not memory write (command 07 16)
-     */
-    return cmd_07_14_write_bdm_reg(g_usb_dev, CSR_WRITE, value);
-}
-
-/* Wait for target to halt with timeout */
-static int wait_for_halt(int timeout_ms) {
-    int elapsed = 0;
-    while (elapsed < timeout_ms) {
-        uint8_t is_frozen = 0;
-        if (cmd_bdm_freeze(g_usb_dev, &is_frozen) == 0 && is_frozen) {
-            return 0; /* Halted */
-        }
-        usleep(1000); /* 1ms */
-        elapsed++;
-    }
-    return -1; /* Timeout */
+    return target_read_csr(g_usb_dev, value);
 }
 
 /*
@@ -735,141 +1312,104 @@ static int write_tdr(uint32_t value) {
     return cmd_07_12(g_usb_dev, 0xFFFF);
 }
 
-/* Set a hardware breakpoint at the given address
- * Returns: breakpoint index (0-3) on success, -1 on failure
+/* Install a PC breakpoint in a PBR slot
+ * Only the PBR is written here; the TDR enable bits are updated once for all
+ * slots by update_hw_breakpoint_tdr().
+ * Returns: 0 on success, -1 on failure
  */
-static int set_hw_breakpoint(uint32_t addr) {
-    /* Find a free breakpoint slot */
-    int slot = -1;
-    for (int i = 0; i < MAX_HW_BREAKPOINTS; i++) {
-        if (!hw_breakpoint_used[i]) {
-            slot = i;
-            break;
-        }
-    }
-
-    if (slot < 0) {
-        printf("No free hardware breakpoint slots\n");
-        return -1;
-    }
-
-    /* Write the breakpoint address to PBRn
-     * NOTE: PBR registers are write-only - cannot verify!
-     */
-    printf("DEBUG: Writing PBR%d = 0x%08X (DRc=0x%02X)\n", slot, addr, pbr_reg[slot]);
-    if (write_pbr(slot, addr) != 0) {
-        printf("Failed to write PBR%d\n", slot);
-        return -1;
-    }
-
-    /* Build TDR value to enable PC breakpoint triggering:
-     * - TRC_HALT: Halt processor on trigger (bit 30)
-     * - EBL1: Enable breakpoint level 1 (bit 13)
-     * - EPC1: Enable PC level 1 (bit 9)
-     * - Set LPC bits for which PBRs are active (bits 24-27)
-     *
-     * NOTE: TDR is write-only - we use the global tdr_shadow to track state
-     */
-    tdr_shadow |= TDR_TRC_HALT | TDR_EBL1 | TDR_EPC1;
-    /* Enable the specific PBR slot in bits 24-27 */
-    tdr_shadow |= (1 << (24 + slot));
-
-    printf("DEBUG: Writing TDR = 0x%08X (DRc=0x%02X)\n", tdr_shadow, DEBUG_REG_TDR);
-    if (write_tdr(tdr_shadow) != 0) {
-        printf("Failed to write TDR\n");
+static int install_hw_breakpoint(int slot, uint32_t addr) {
+    /* NOTE: PBR registers are write-only - cannot verify! */
+    uint32_t pbr = slot == 0 ? addr : addr | PBR_VALID;
+    LOG_DEBUG(LOG_RUN, "Writing PBR%d = 0x%08X (DRc=0x%02X)\n", slot, pbr, pbr_reg[slot]);
+    if (write_pbr(slot, pbr) != 0) {
+        LOG_ERROR(LOG_RUN, "Failed to write PBR%d\n", slot);
         return -1;
     }
 
     hw_breakpoints[slot] = addr;
     hw_breakpoint_used[slot] = 1;
-    printf("Hardware breakpoint %d set at 0x%08X (TDR=0x%08X)\n", slot, addr, tdr_shadow);
+    LOG_INFO(LOG_RUN, "Hardware breakpoint %d set at 0x%08X\n", slot, addr);
+    return 0;
+}
 
-    return slot;
+/* Disarm a PBR: clear the valid bit, or park PBR0 */
+static int disable_pbr(int slot) {
+    return write_pbr(slot, slot == 0 ? PBR0_UNUSED : 0);
 }
 
-/* Clear a hardware breakpoint at the given address
- * Returns: 0 on success, -1 on failure
+/* Release a PBR slot
+ * TDR EPC1 enables all PBRs at once, so the slot itself is disarmed.
  */
-static int clear_hw_breakpoint(uint32_t addr) {
-    /* Find the breakpoint slot for this address */
-    int slot = -1;
-    for (int i = 0; i < MAX_HW_BREAKPOINTS; i++) {
-        if (hw_breakpoint_used[i] && hw_breakpoints[i] == addr) {
-            slot = i;
-            break;
-        }
-    }
-
-    if (slot < 0) {
-        printf("No hardware breakpoint at 0x%08X\n", addr);
-        return -1;
+static void remove_hw_breakpoint(int slot) {
+    if (disable_pbr(slot) != 0) {
+        LOG_WARN(LOG_RUN, "Failed to disable PBR%d\n", slot);
     }
+    LOG_INFO(LOG_RUN, "Hardware breakpoint %d cleared (was at 0x%08X)\n", slot, hw_breakpoints[slot]);
+    hw_breakpoints[slot] = 0;
+    hw_breakpoint_used[slot] = 0;
+}
 
-    /* Clear the PBR register */
-    write_pbr(slot, 0);
-
-    /* Update TDR shadow to disable this breakpoint slot
-     * NOTE: TDR is write-only, so we use the shadow copy
-     */
-    tdr_shadow &= ~(1 << (24 + slot));
-
-    /* If no more breakpoints active, disable PC breakpoint triggering */
+/* Rebuild the PC breakpoint bits of the TDR shadow from the PBR slot usage
+ * and write it to the target.
+ *
+ * - TRC_HALT: Halt processor on trigger (bit 30)
+ * - EBL1: Enable breakpoint level 1 (bit 13)
+ * - EPC1: Enable PC breakpoints (bit 1); unused PBRs are disarmed
+ *
+ * NOTE: TDR is write-only - we use the global tdr_shadow to track state
+ */
+static int update_hw_breakpoint_tdr(void) {
     int any_active = 0;
+
     for (int i = 0; i < MAX_HW_BREAKPOINTS; i++) {
-        if (i != slot && hw_breakpoint_used[i]) {
+        if (hw_breakpoint_used[i]) {
             any_active = 1;
-            break;
         }
     }
-    if (!any_active) {
-        tdr_shadow &= ~(TDR_EBL1 | TDR_EPC1);
-    }
-
-    write_tdr(tdr_shadow);
 
-    hw_breakpoints[slot] = 0;
-    hw_breakpoint_used[slot] = 0;
-    printf("Hardware breakpoint %d cleared (was at 0x%08X)\n", slot, addr);
+    if (any_active) {
+        tdr_shadow |= TDR_TRC_HALT | TDR_EBL1 | TDR_EPC1;
+    } else {
+        tdr_shadow &= ~TDR_EPC1;
+        /* Level 1 stays enabled while the watchpoint still needs it */
+        if (count_watchpoints() == 0) {
+            tdr_shadow &= ~(TDR_TRC_HALT | TDR_EBL1);
+        }
+    }
 
+    LOG_DEBUG(LOG_RUN, "Writing TDR = 0x%08X (DRc=0x%02X)\n", tdr_shadow, DEBUG_REG_TDR);
+    if (write_tdr(tdr_shadow) != 0) {
+        LOG_ERROR(LOG_RUN, "Failed to write TDR\n");
+        return -1;
+    }
     return 0;
 }
 
+/* Find a free PBR slot, -1 if all are in use */
+static int find_free_hw_slot(void) {
+    for (int i = 0; i < MAX_HW_BREAKPOINTS; i++) {
+        if (!hw_breakpoint_used[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 /*
  * Software Breakpoint Functions
  * Insert HALT instruction (0x4AC8) at breakpoint address
  */
 
-/* Initialize software breakpoint table */
-static void init_sw_breakpoints(void) {
-    for (int i = 0; i < MAX_SW_BREAKPOINTS; i++) {
-        sw_breakpoints[i].addr = 0;
-        sw_breakpoints[i].original_insn = 0;
-        sw_breakpoints[i].active = 0;
-    }
-}
-
-/* Set a software breakpoint at the given address
+/* Write the HALT opcode over the instruction at bp->addr
  * Returns: 0 on success, -1 on failure
  */
-static int set_sw_breakpoint(uint32_t addr) {
-    /* Find a free slot */
-    int slot = -1;
-    for (int i = 0; i < MAX_SW_BREAKPOINTS; i++) {
-        if (!sw_breakpoints[i].active) {
-            slot = i;
-            break;
-        }
-    }
-
-    if (slot < 0) {
-        printf("No free software breakpoint slots\n");
-        return -1;
-    }
+static int set_sw_breakpoint(breakpoint_t *bp) {
+    uint32_t addr = bp->addr;
 
     /* Read original instruction */
     uint8_t insn_bytes[2];
     if (cmd_0717_read_memory(g_usb_dev, addr, 2, insn_bytes, 2) != 0) {
-        printf("Failed to read instruction at 0x%08X\n", addr);
+        LOG_ERROR(LOG_RUN, "Failed to read instruction at 0x%08X\n", addr);
         return -1;
     }
     uint16_t original = (insn_bytes[0] << 8) | insn_bytes[1];
@@ -884,298 +1424,888 @@ static int set_sw_breakpoint(uint32_t addr) {
         next_bytes[1] = 0xFF;
     }
     uint32_t write_val = (COLDFIRE_HALT_OPCODE << 16) | (next_bytes[0] << 8) | next_bytes[1];
-    if (cmd_07_19(g_usb_dev, addr, write_val) != 0) {
-        printf("Failed to write HALT instruction at 0x%08X\n", addr);
+    if (write_target_long(addr, write_val) != 0) {
+        LOG_ERROR(LOG_RUN, "Failed to write HALT instruction at 0x%08X\n", addr);
         return -1;
     }
 
-    sw_breakpoints[slot].addr = addr;
-    sw_breakpoints[slot].original_insn = original;
-    sw_breakpoints[slot].active = 1;
-    printf("Software breakpoint set at 0x%08X (original insn: 0x%04X)\n", addr, original);
+    bp->original_insn = original;
+    bp->sw_installed = 1;
+    bp_sw_installed++;
+    LOG_INFO(LOG_RUN, "Software breakpoint set at 0x%08X (original insn: 0x%04X)\n", addr, original);
 
     return 0;
 }
 
-/* Clear a software breakpoint at the given address
+/* Restore the original instruction under a software breakpoint
  * Returns: 0 on success, -1 on failure
  */
-static int clear_sw_breakpoint(uint32_t addr) {
-    /* Find the breakpoint */
-    int slot = -1;
-    for (int i = 0; i < MAX_SW_BREAKPOINTS; i++) {
-        if (sw_breakpoints[i].active && sw_breakpoints[i].addr == addr) {
-            slot = i;
-            break;
-        }
-    }
-
-    if (slot < 0) {
-        printf("No software breakpoint at 0x%08X\n", addr);
-        return -1;
-    }
+static int clear_sw_breakpoint(breakpoint_t *bp) {
+    uint32_t addr = bp->addr;
 
     /* Restore original instruction */
-    uint16_t original = sw_breakpoints[slot].original_insn;
+    uint16_t original = bp->original_insn;
     uint8_t next_bytes[2];
     if (cmd_0717_read_memory(g_usb_dev, addr + 2, 2, next_bytes, 2) != 0) {
         next_bytes[0] = 0xFF;
         next_bytes[1] = 0xFF;
     }
     uint32_t write_val = (original << 16) | (next_bytes[0] << 8) | next_bytes[1];
-    if (cmd_07_19(g_usb_dev, addr, write_val) != 0) {
-        printf("Failed to restore instruction at 0x%08X\n", addr);
+    if (write_target_long(addr, write_val) != 0) {
+        LOG_ERROR(LOG_RUN, "Failed to restore instruction at 0x%08X\n", addr);
         return -1;
     }
 
-    sw_breakpoints[slot].active = 0;
-    printf("Software breakpoint cleared at 0x%08X (restored insn: 0x%04X)\n", addr, original);
+    bp->sw_installed = 0;
+    bp_sw_installed--;
+    LOG_INFO(LOG_RUN, "Software breakpoint cleared at 0x%08X (restored insn: 0x%04X)\n", addr, original);
 
     return 0;
 }
 
-/* Check if we stopped at a software breakpoint and adjust PC if needed */
-static int check_sw_breakpoint_hit(void) {
-    uint32_t pc;
-    read_cpu_register(REG_PC, &pc);
-
-    for (int i = 0; i < MAX_SW_BREAKPOINTS; i++) {
-        if (sw_breakpoints[i].active && sw_breakpoints[i].addr == pc) {
-            printf("Hit software breakpoint at 0x%08X\n", pc);
-            return 1;
-        }
-    }
-    return 0;
-}
-
 /*
- * Watchpoint (Data Breakpoint) Functions
- * ColdFire V2 Debug Module supports address range triggering via:
- *   - ABLR: Address Bound Low Register
- *   - ABHR: Address Bound High Register
- *   - TDR: Trigger Definition Register (controls R/W mode)
- *
- * Note: Only ONE watchpoint can be active at a time due to hardware limitations.
+ * Breakpoint Table Functions
  */
 
-/* Initialize watchpoint tracking */
-static void init_watchpoints(void) {
-    for (int i = 0; i < MAX_WATCHPOINTS; i++) {
-        watchpoints[i].addr = 0;
-        watchpoints[i].length = 0;
-        watchpoints[i].type = WP_TYPE_NONE;
-        watchpoints[i].active = 0;
-    }
+/* Bucket index for an address (Fibonacci hashing, instructions are
+ * word aligned so bit 0 carries no information)
+ */
+static unsigned bp_hash_index(uint32_t addr) {
+    return (uint32_t)((addr >> 1) * 2654435761u) >> (32 - bp_hash_bits);
 }
 
-/* Write Address Bound Low Register */
-static int write_ablr(uint32_t addr) {
-    return cmd_07_14_write_bdm_reg(g_usb_dev, ABLR_WRITE, addr);
+/* Free a list of breakpoint conditions */
+static void free_conditions(bp_cond_t *cond) {
+    while (cond) {
+        bp_cond_t *next = cond->next;
+        free(cond);
+        cond = next;
+    }
 }
 
-/* Write Address Bound High Register */
-static int write_abhr(uint32_t addr) {
-    return cmd_07_14_write_bdm_reg(g_usb_dev, ABHR_WRITE, addr);
+/* Free every entry and (re)allocate an empty table */
+static void init_breakpoints(void) {
+    if (bp_hash) {
+        for (unsigned b = 0; b < (1u << bp_hash_bits); b++) {
+            breakpoint_t *bp = bp_hash[b];
+            while (bp) {
+                breakpoint_t *next = bp->next;
+                free_conditions(bp->conds);
+                free(bp);
+                bp = next;
+            }
+        }
+        free(bp_hash);
+    }
+
+    bp_hash_bits = BP_HASH_INITIAL_BITS;
+    bp_hash = calloc(1u << bp_hash_bits, sizeof(*bp_hash));
+    bp_count = 0;
+    bp_hw_wanted = 0;
+    bp_sw_installed = 0;
 }
 
-/* Read Address Bound Low Register */
-static int read_ablr(uint32_t *addr) {
-    return cmd_07_13(g_usb_dev, ABLR_READ, addr);
+/* Double the bucket count once chains average more than two entries */
+static void grow_breakpoint_table(void) {
+    unsigned old_size = 1u << bp_hash_bits;
+    breakpoint_t **new_hash = calloc(old_size * 2, sizeof(*new_hash));
+    if (!new_hash) {
+        return;  /* Keep the old table; chains just get longer */
+    }
+
+    breakpoint_t **old_hash = bp_hash;
+    bp_hash = new_hash;
+    bp_hash_bits++;
+
+    for (unsigned b = 0; b < old_size; b++) {
+        breakpoint_t *bp = old_hash[b];
+        while (bp) {
+            breakpoint_t *next = bp->next;
+            unsigned idx = bp_hash_index(bp->addr);
+            bp->next = bp_hash[idx];
+            bp_hash[idx] = bp;
+            bp = next;
+        }
+    }
+    free(old_hash);
 }
 
-/* Read Address Bound High Register */
-static int read_abhr(uint32_t *addr) {
-    return cmd_07_13(g_usb_dev, ABHR_READ, addr);
+/* Find the table entry for an address, NULL if none */
+static breakpoint_t *find_breakpoint(uint32_t addr) {
+    if (!bp_hash) {
+        return NULL;
+    }
+    for (breakpoint_t *bp = bp_hash[bp_hash_index(addr)]; bp; bp = bp->next) {
+        if (bp->addr == addr) {
+            return bp;
+        }
+    }
+    return NULL;
 }
 
-/* Set a watchpoint (data breakpoint) at the given address range
- * Parameters:
- *   addr   - Start address of memory region to watch
- *   length - Size of memory region (1, 2, 4 bytes typically)
- *   type   - Watchpoint type (WP_TYPE_WRITE, WP_TYPE_READ, WP_TYPE_ACCESS)
- * Returns: 0 on success, -1 on failure
- */
-static int set_watchpoint(uint32_t addr, uint32_t length, watchpoint_type_t type) {
-    /* Check if watchpoint slot is available */
-    if (watchpoints[0].active) {
-        printf("Watchpoint already active (only 1 supported)\n");
-        return -1;
+/* Unlink and free an entry */
+static void free_breakpoint(breakpoint_t *bp) {
+    breakpoint_t **link = &bp_hash[bp_hash_index(bp->addr)];
+    while (*link && *link != bp) {
+        link = &(*link)->next;
     }
+    if (*link) {
+        *link = bp->next;
+        bp_count--;
+    }
+    free_conditions(bp->conds);
+    free(bp);
+}
 
-    /* Calculate address range */
-    uint32_t addr_low = addr;
-    uint32_t addr_high = addr + length - 1;
+/* Is anything currently written to the target for this entry? */
+static int breakpoint_installed(const breakpoint_t *bp) {
+    return bp->hw_slot >= 0 || bp->sw_installed;
+}
 
-    printf("Setting watchpoint: addr=0x%08X-0x%08X, type=%d\n",
-           addr_low, addr_high, type);
+/* Record that GDB wants a breakpoint (Z0/Z1) - no target I/O
+ * Returns: 0 on success, -1 if the breakpoint can never be installed
+ */
+static int request_breakpoint(uint32_t addr, uint8_t flag) {
+    breakpoint_t *bp = find_breakpoint(addr);
 
-    /* Program address bound registers */
-    if (write_ablr(addr_low) != 0) {
-        printf("Failed to write ABLR\n");
-        return -1;
+    if (bp && (bp->want & flag)) {
+        return 0;  /* Already requested */
     }
 
-    if (write_abhr(addr_high) != 0) {
-        printf("Failed to write ABHR\n");
+    /* Z1 is limited by the number of PBR slots */
+    if (flag == BP_WANT_HW && bp_hw_wanted >= MAX_HW_BREAKPOINTS) {
+        LOG_WARN(LOG_RUN, "No free hardware breakpoint slots\n");
         return -1;
     }
 
-    /* Configure TDR for address range watchpoint
-     * NOTE: TDR is write-only, so we use the global shadow copy
-     */
-
-    /* Set trigger to halt on address range match */
-    tdr_shadow |= TDR_TRC_HALT;    /* Halt processor on trigger */
-    tdr_shadow |= TDR_EBL1;        /* Enable breakpoint level 1 */
-    tdr_shadow |= TDR_EAR1;        /* Enable address range level 1 */
-    tdr_shadow |= TDR_EAL_INSIDE;  /* Trigger when address is inside range */
-
-    /* Set read/write mode based on watchpoint type */
-    tdr_shadow &= ~TDR_DRW_RW;     /* Clear R/W bits first */
-    switch (type) {
-        case WP_TYPE_WRITE:
-            tdr_shadow |= TDR_DRW_WRITE;
-            break;
-        case WP_TYPE_READ:
-            tdr_shadow |= TDR_DRW_READ;
-            break;
-        case WP_TYPE_ACCESS:
-            tdr_shadow |= TDR_DRW_RW;
-            break;
-        default:
-            printf("Invalid watchpoint type\n");
+    if (!bp) {
+        if (!bp_hash) {
+            init_breakpoints();
+        }
+        if (!bp_hash || !(bp = calloc(1, sizeof(*bp)))) {
+            LOG_ERROR(LOG_RUN, "Out of memory for breakpoint at 0x%08X\n", addr);
             return -1;
+        }
+        bp->addr = addr;
+        bp->hw_slot = -1;
+
+        unsigned idx = bp_hash_index(addr);
+        bp->next = bp_hash[idx];
+        bp_hash[idx] = bp;
+        if (++bp_count > (2u << bp_hash_bits)) {
+            grow_breakpoint_table();
+        }
     }
 
-    if (write_tdr(tdr_shadow) != 0) {
-        printf("Failed to write TDR\n");
-        return -1;
+    bp->want |= flag;
+    if (flag == BP_WANT_HW) {
+        bp_hw_wanted++;
     }
-
-    /* Record watchpoint in tracking array */
-    watchpoints[0].addr = addr;
-    watchpoints[0].length = length;
-    watchpoints[0].type = type;
-    watchpoints[0].active = 1;
-
-    printf("Watchpoint set: 0x%08X-0x%08X (type=%d, TDR=0x%08X)\n",
-           addr_low, addr_high, type, tdr_shadow);
-
     return 0;
 }
 
-/* Clear a watchpoint at the given address
- * Returns: 0 on success, -1 on failure
- */
-static int clear_watchpoint(uint32_t addr, uint32_t length, watchpoint_type_t type) {
-    /* Find matching watchpoint */
-    if (!watchpoints[0].active) {
-        printf("No active watchpoint to clear\n");
-        return -1;
+/* Record that GDB removed a breakpoint (z0/z1) - no target I/O */
+static void release_breakpoint(uint32_t addr, uint8_t flag) {
+    breakpoint_t *bp = find_breakpoint(addr);
+    if (!bp || !(bp->want & flag)) {
+        return;
     }
 
-    if (watchpoints[0].addr != addr ||
-        watchpoints[0].length != length ||
-        watchpoints[0].type != type) {
-        printf("Watchpoint mismatch: requested 0x%08X/%u/%d, active 0x%08X/%u/%d\n",
-               addr, length, type,
-               watchpoints[0].addr, watchpoints[0].length, watchpoints[0].type);
-        return -1;
+    bp->want &= ~flag;
+    if (flag == BP_WANT_HW) {
+        bp_hw_wanted--;
     }
+    if (!bp->want && !breakpoint_installed(bp)) {
+        free_breakpoint(bp);
+    }
+}
 
-    /* Clear address bound registers */
-    write_ablr(0);
-    write_abhr(0);
+/* Apply the desired breakpoint state to the target
+ * Called right before the target resumes. Removals are applied first so
+ * their PBR slots can be reused, then Z1 entries are placed (they need a
+ * PBR), then Z0 entries take the remaining PBRs or fall back to HALT.
+ * TDR is written at most once per sync.
+ *
+ * 'keep' (may be NULL) is the breakpoint at the resume PC: GDB removes it
+ * before stepping over it, but the server steps over it itself, so its
+ * removal is left for the next sync instead of rewriting code memory twice.
+ * Returns: 0 if everything wanted is installed, -1 otherwise
+ */
+static int sync_breakpoints(const breakpoint_t *keep) {
+    int tdr_dirty = 0;
+    int result = 0;
 
-    /* Update TDR shadow to disable address range triggering
-     * NOTE: TDR is write-only, so we use the global shadow copy
-     */
+    if (!bp_hash) {
+        return 0;
+    }
 
-    /* Clear address range and R/W bits */
-    tdr_shadow &= ~TDR_EAR1;       /* Disable address range */
-    tdr_shadow &= ~TDR_EAL_MASK;   /* Clear address level mode */
-    tdr_shadow &= ~TDR_DRW_RW;     /* Clear R/W bits */
+    /* Pass 1: removals */
+    for (unsigned b = 0; b < (1u << bp_hash_bits); b++) {
+        breakpoint_t *bp = bp_hash[b];
+        while (bp) {
+            breakpoint_t *next = bp->next;
 
-    /* If no more breakpoints/watchpoints, disable triggering entirely */
-    int any_bp_active = 0;
-    for (int i = 0; i < MAX_HW_BREAKPOINTS; i++) {
-        if (hw_breakpoint_used[i]) {
-            any_bp_active = 1;
-            break;
+            if (bp == keep) {
+                bp = next;
+                continue;
+            }
+            if (!bp->want && bp->hw_slot >= 0) {
+                remove_hw_breakpoint(bp->hw_slot);
+                bp->hw_slot = -1;
+                tdr_dirty = 1;
+            }
+            /* Also lift a HALT opcode when the entry now needs hardware */
+            if (bp->sw_installed && (!bp->want || (bp->want & BP_WANT_HW))) {
+                if (clear_sw_breakpoint(bp) != 0) {
+                    result = -1;
+                }
+            }
+            if (!bp->want && !breakpoint_installed(bp)) {
+                free_breakpoint(bp);
+            }
+
+            bp = next;
         }
     }
-    if (!any_bp_active) {
-        tdr_shadow &= ~(TDR_TRC_HALT | TDR_EBL1);
+
+    /* Pass 2: hardware-only insertions, then everything else */
+    for (int pass = 0; pass < 2; pass++) {
+        for (unsigned b = 0; b < (1u << bp_hash_bits); b++) {
+            for (breakpoint_t *bp = bp_hash[b]; bp; bp = bp->next) {
+                if (!bp->want || breakpoint_installed(bp)) continue;
+                if (pass == 0 && !(bp->want & BP_WANT_HW)) continue;
+
+                int slot = find_free_hw_slot();
+                if (slot >= 0 && install_hw_breakpoint(slot, bp->addr) == 0) {
+                    bp->hw_slot = slot;
+                    tdr_dirty = 1;
+                } else if (!(bp->want & BP_WANT_HW) && set_sw_breakpoint(bp) == 0) {
+                    /* Installed as software breakpoint */
+                } else {
+                    LOG_ERROR(LOG_RUN, "Failed to install breakpoint at 0x%08X\n", bp->addr);
+                    result = -1;
+                }
+            }
+        }
     }
 
-    write_tdr(tdr_shadow);
+    if (tdr_dirty && update_hw_breakpoint_tdr() != 0) {
+        result = -1;
+    }
 
-    /* Clear tracking */
-    watchpoints[0].addr = 0;
-    watchpoints[0].length = 0;
-    watchpoints[0].type = WP_TYPE_NONE;
-    watchpoints[0].active = 0;
+    return result;
+}
 
-    printf("Watchpoint cleared at 0x%08X\n", addr);
-    return 0;
+/* Drop every breakpoint and take them out of the target (detach/disconnect) */
+static void remove_all_breakpoints(void) {
+    if (!bp_hash) {
+        return;
+    }
+    for (unsigned b = 0; b < (1u << bp_hash_bits); b++) {
+        for (breakpoint_t *bp = bp_hash[b]; bp; bp = bp->next) {
+            bp->want = 0;
+        }
+    }
+    bp_hw_wanted = 0;
+    sync_breakpoints(NULL);
 }
 
-/* Check if we hit a watchpoint (returns the watched address, or 0 if no hit) */
-static uint32_t check_watchpoint_hit(void) {
-    if (!watchpoints[0].active) {
-        return 0;
+/* Call fn for every installed software breakpoint whose opcode overlaps
+ * [addr, addr+len). Short ranges are looked up word by word so the cost
+ * does not depend on the table size.
+ */
+typedef void (*bp_range_fn)(breakpoint_t *bp, uint32_t addr, uint8_t *buf, uint32_t len);
+
+static void for_each_sw_breakpoint_in(uint32_t addr, uint8_t *buf, uint32_t len, bp_range_fn fn) {
+    if (bp_sw_installed == 0 || len == 0) {
+        return;
     }
 
-    /* NOTE: TDR is write-only, so we can't read it to check trigger status.
-     * Instead, we check our shadow copy to see if a watchpoint was armed.
-     * If the target halted and we have an active watchpoint with EAR1 set
-     * in our shadow, we assume the watchpoint triggered.
-     *
-     * In the future, we could potentially read CSR (which IS readable via BDM)
-     * to get more precise trigger information.
-     */
-    if ((tdr_shadow & TDR_EAR1) && (tdr_shadow & TDR_TRC_HALT)) {
-        printf("Watchpoint may have triggered at 0x%08X\n", watchpoints[0].addr);
-        return watchpoints[0].addr;
+    uint32_t words = len / 2 + 2;
+    if (words < bp_count) {
+        uint32_t start = (addr - 1) & ~1u;
+        for (uint32_t n = 0; n < words; n++) {
+            breakpoint_t *bp = find_breakpoint(start + n * 2);
+            if (bp && bp->sw_installed) {
+                fn(bp, addr, buf, len);
+            }
+        }
+    } else {
+        for (unsigned b = 0; b < (1u << bp_hash_bits); b++) {
+            for (breakpoint_t *bp = bp_hash[b]; bp; bp = bp->next) {
+                if (bp->sw_installed) {
+                    fn(bp, addr, buf, len);
+                }
+            }
+        }
     }
+}
 
-    return 0;
+static void shadow_read_one(breakpoint_t *bp, uint32_t addr, uint8_t *buf, uint32_t len) {
+    for (int j = 0; j < 2; j++) {
+        uint32_t a = bp->addr + j;
+        if (a - addr < len) {
+            buf[a - addr] = (j == 0) ? (bp->original_insn >> 8) : (bp->original_insn & 0xFF);
+        }
+    }
 }
 
-/*
- * Flash Programming Functions for vFlash* GDB commands
+static void shadow_write_one(breakpoint_t *bp, uint32_t addr, uint8_t *buf, uint32_t len) {
+    for (int j = 0; j < 2; j++) {
+        uint32_t a = bp->addr + j;
+        if (a - addr < len) {
+            if (j == 0) {
+                bp->original_insn = (bp->original_insn & 0x00FF) | (buf[a - addr] << 8);
+                buf[a - addr] = COLDFIRE_HALT_OPCODE >> 8;
+            } else {
+                bp->original_insn = (bp->original_insn & 0xFF00) | buf[a - addr];
+                buf[a - addr] = COLDFIRE_HALT_OPCODE & 0xFF;
+            }
+        }
+    }
+}
+
+/* Replace HALT opcodes in data read from the target with the original
+ * instructions, so GDB sees memory as if no breakpoints were inserted.
+ * Needed because removals are deferred until the next resume.
  */
+static void breakpoint_shadow_read(uint32_t addr, uint8_t *buf, uint32_t len) {
+    for_each_sw_breakpoint_in(addr, buf, len, shadow_read_one);
+}
 
-/*
- * GPL Flashloader Implementation
- * Uses the ELF-based flashloader from flashloader/flashloader.elf
+/* Memory written over an installed software breakpoint replaces the saved
+ * original instruction; the HALT opcode is kept in the data sent to the
+ * target so the breakpoint stays armed.
  */
+static void breakpoint_shadow_write(uint32_t addr, uint8_t *buf, uint32_t len) {
+    for_each_sw_breakpoint_in(addr, buf, len, shadow_write_one);
+}
 
-/* Initialize flashloader (must be called before erase/program) */
-static int flash_init_loader(void) {
-    if (flash_state.initialized) {
-        return 0;  /* Already initialized */
-    }
+/* Parse the cond_list of a Z packet: ";X<len>,<hex bytecode>" entries,
+ * optionally followed by ";cmds:..." which is not supported and ignored.
+ * Returns: 0 on success (*out is NULL when there are no conditions), -1 on
+ * a malformed list
+ */
+static int parse_conditions(const char *str, bp_cond_t **out) {
+    bp_cond_t *head = NULL;
+    bp_cond_t **tail = &head;
+
+    *out = NULL;
+    while (str && *str == ';' && str[1] == 'X') {
+        char *end = NULL;
+        unsigned long len = strtoul(str + 2, &end, 16);
+        if (!end || *end != ',' || len == 0 || len > MAX_PACKET_SIZE) {
+            free_conditions(head);
+            return -1;
+        }
 
-    printf("Flash: Initializing GPL flashloader...\n");
+        bp_cond_t *cond = malloc(sizeof(*cond) + len);
+        if (!cond) {
+            free_conditions(head);
+            return -1;
+        }
+        cond->next = NULL;
+        cond->len = len;
+        if (hex_to_bytes(end + 1, cond->code, (int)len) != (int)len) {
+            free(cond);
+            free_conditions(head);
+            return -1;
+        }
 
-    int r = gpl_flash_init(&flash_state.gpl_state, g_usb_dev, NULL);
-    if (r != 0) {
-        printf("Flash: GPL flashloader init failed\n");
-        return -1;
+        *tail = cond;
+        tail = &cond->next;
+        str = end + 1 + len * 2;
     }
 
-    flash_state.initialized = 1;
-    printf("Flash: GPL flashloader initialized (entry=0x%08X)\n",
-           gpl_flash_get_entry_point(&flash_state.gpl_state));
+    *out = head;
     return 0;
 }
 
-/* Erase flash sectors covering addr to addr+length */
-static int flash_erase_region(uint32_t addr, uint32_t length) {
-    if (addr + length > FLASH_SIZE) {
-        printf("Flash: Erase region 0x%08X-0x%08X exceeds flash size\n",
-               addr, addr + length);
+/* Agent expression accessors: registers come from the halt-time snapshot,
+ * memory is read with breakpoint opcodes shadowed out
+ */
+static int ax_read_reg(void *ctx, int regnum, uint32_t *value) {
+    (void)ctx;
+    if (regnum < 0 || regnum >= NUM_REGISTERS) {
+        return -1;
+    }
+    return read_cpu_register(regnum, value);
+}
+
+static int ax_read_mem(void *ctx, uint32_t addr, uint8_t *buf, uint32_t len) {
+    (void)ctx;
+    if (read_target_memory(addr, buf, len) != 0) {
+        return -1;
+    }
+    breakpoint_shadow_read(addr, buf, len);
+    return 0;
+}
+
+/* Should the target stop for this breakpoint or watchpoint?
+ * An evaluation error reports the stop, so a broken condition is never
+ * silently skipped.
+ */
+static int conditions_met(const bp_cond_t *conds, uint32_t addr) {
+    if (!conds) {
+        return 1;
+    }
+
+    const ax_target_t target = { ax_read_reg, ax_read_mem, NULL };
+    for (const bp_cond_t *cond = conds; cond; cond = cond->next) {
+        int64_t value = 0;
+        if (ax_eval(cond->code, cond->len, &target, &value) != 0) {
+            LOG_WARN(LOG_RUN, "Condition at 0x%08X failed to evaluate\n", addr);
+            return 1;
+        }
+        if (value != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Check if we stopped at a software breakpoint
+ * Uses the PC captured at halt time, so no extra target read is needed.
+ */
+static int check_sw_breakpoint_hit(uint32_t pc) {
+    breakpoint_t *bp = find_breakpoint(pc);
+    if (bp && bp->sw_installed) {
+        LOG_INFO(LOG_RUN, "Hit software breakpoint at 0x%08X\n", pc);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Watchpoint (Data Breakpoint) Functions
+ * ColdFire V2 Debug Module supports address range triggering via:
+ *   - ABLR: Address Bound Low Register
+ *   - ABHR: Address Bound High Register
+ *   - TDR: Trigger Definition Register (controls R/W mode)
+ * and data value triggering via:
+ *   - DBR: Data Breakpoint Register
+ *   - DBMR: Data Breakpoint Mask Register (1 = bit ignored)
+ *
+ * Note: there is only one comparator set, shared by all watchpoints.
+ */
+
+/* Initialize watchpoint tracking */
+static void init_watchpoints(void) {
+    memset(watchpoints, 0, sizeof(watchpoints));
+    memset(&watch_data, 0, sizeof(watch_data));
+    memset(&watch_last, 0, sizeof(watch_last));
+}
+
+/* Write Address Bound Low Register */
+static int write_ablr(uint32_t addr) {
+    return cmd_07_14_write_bdm_reg(g_usb_dev, ABLR_WRITE, addr);
+}
+
+/* Write Address Bound High Register */
+static int write_abhr(uint32_t addr) {
+    return cmd_07_14_write_bdm_reg(g_usb_dev, ABHR_WRITE, addr);
+}
+
+/* Read Address Bound Low Register */
+static int read_ablr(uint32_t *addr) {
+    return cmd_07_13(g_usb_dev, ABLR_READ, addr);
+}
+
+/* Read Address Bound High Register */
+static int read_abhr(uint32_t *addr) {
+    return cmd_07_13(g_usb_dev, ABHR_READ, addr);
+}
+
+/* Write a data comparator register (DBR/DBMR) followed by the sync */
+static int write_data_breakpoint_reg(uint16_t reg, uint32_t value) {
+    int r = cmd_07_14_write_debug_reg(g_usb_dev, reg, value);
+    if (r != 0) return r;
+    return cmd_07_12(g_usb_dev, 0xFFFF);
+}
+
+/* Number of active watchpoints */
+static int count_watchpoints(void) {
+    int n = 0;
+    for (int i = 0; i < MAX_WATCHPOINTS; i++) {
+        if (watchpoints[i].active) n++;
+    }
+    return n;
+}
+
+/* TDR lane enables and shift for a data compare on addr/length
+ * Returns: the enable bits, or 0 if the variable isn't a naturally
+ * aligned byte, word or longword (the comparator can't match it)
+ */
+static uint32_t watch_data_lanes(uint32_t addr, uint32_t length, uint32_t *shift) {
+    static const uint32_t byte_lane[4] = { TDR_EDUU1, TDR_EDUM1, TDR_EDLM1, TDR_EDLL1 };
+
+    /* Big-endian: byte 0 of the longword is bits 31..24 */
+    *shift = (4 - (addr & 3) - length) * 8;
+    if (length == 1) {
+        return byte_lane[addr & 3];
+    }
+    if (length == 2 && (addr & 1) == 0) {
+        return (addr & 2) ? TDR_EDWL1 : TDR_EDWU1;
+    }
+    if (length == 4 && (addr & 3) == 0) {
+        return TDR_EDLW1;
+    }
+    return 0;
+}
+
+/* Data value a watchpoint's condition asks for
+ * Only a single condition comparing the watched variable with a constant
+ * can be left to the comparator; every condition is still evaluated at the
+ * halt (see watch_condition_met()).
+ * Returns: 0 with value/mask set, -1 if the comparator can't do it
+ */
+static int watch_condition_value(int slot, uint32_t *value, uint32_t *mask) {
+    const bp_cond_t *cond = watchpoints[slot].conds;
+    uint32_t shift;
+    if (!cond || cond->next ||
+        watch_data_lanes(watchpoints[slot].addr, watchpoints[slot].length, &shift) == 0) {
+        return -1;
+    }
+    return ax_match_compare(cond->code, cond->len, watchpoints[slot].addr,
+                            watchpoints[slot].length, value, mask);
+}
+
+/* Program the comparators for the current watchpoint set
+ * The address range is the union of all watched regions, the R/W mode the
+ * union of their types. The data comparator is only used while a single
+ * variable is watched, with a condition or "monitor watch-value" value.
+ * Returns: 0 on success, -1 on failure
+ */
+static int apply_watchpoints(void) {
+    uint32_t addr_low = 0xFFFFFFFF;
+    uint32_t addr_high = 0;
+    int want_read = 0, want_write = 0;
+    int active = -1;
+
+    for (int i = 0; i < MAX_WATCHPOINTS; i++) {
+        if (!watchpoints[i].active) continue;
+        if (watchpoints[i].addr < addr_low) {
+            addr_low = watchpoints[i].addr;
+        }
+        if (watchpoints[i].addr + watchpoints[i].length - 1 > addr_high) {
+            addr_high = watchpoints[i].addr + watchpoints[i].length - 1;
+        }
+        want_read |= (watchpoints[i].type != WP_TYPE_WRITE);
+        want_write |= (watchpoints[i].type != WP_TYPE_READ);
+        active = i;
+    }
+
+    /* Update TDR shadow
+     * NOTE: TDR is write-only, so we use the global shadow copy
+     */
+    tdr_shadow &= ~(TDR_EA1_MASK | TDR_ED1_MASK);
+
+    if (active < 0) {
+        /* Clear address bound registers */
+        write_ablr(0);
+        write_abhr(0);
+
+        /* If no more breakpoints/watchpoints, disable triggering entirely */
+        int any_bp_active = 0;
+        for (int i = 0; i < MAX_HW_BREAKPOINTS; i++) {
+            if (hw_breakpoint_used[i]) {
+                any_bp_active = 1;
+                break;
+            }
+        }
+        if (!any_bp_active) {
+            tdr_shadow &= ~(TDR_TRC_HALT | TDR_EBL1);
+        }
+        return write_tdr(tdr_shadow);
+    }
+
+    LOG_DEBUG(LOG_RUN, "Setting watch range: addr=0x%08X-0x%08X (%s%s)\n",
+              addr_low, addr_high, want_read ? "R" : "", want_write ? "W" : "");
+
+    /* Program address bound registers */
+    if (write_ablr(addr_low) != 0) {
+        LOG_ERROR(LOG_RUN, "Failed to write ABLR\n");
+        return -1;
+    }
+    if (write_abhr(addr_high) != 0) {
+        LOG_ERROR(LOG_RUN, "Failed to write ABHR\n");
+        return -1;
+    }
+    uint32_t aatr = AATR_DATA;
+    if (want_read && want_write) {
+        aatr |= AATR_RM;
+    } else if (want_read) {
+        aatr |= AATR_R;
+    }
+    if (write_data_breakpoint_reg(DEBUG_REG_AATR, aatr) != 0) {
+        LOG_ERROR(LOG_RUN, "Failed to write AATR\n");
+        return -1;
+    }
+
+    /* Set trigger to halt on address range match */
+    tdr_shadow |= TDR_TRC_HALT;    /* Halt processor on trigger */
+    tdr_shadow |= TDR_EBL1;        /* Enable breakpoint level 1 */
+    tdr_shadow |= TDR_EAR1;        /* Trigger when address is inside range */
+
+    /* Data value match, qualified by the address range: from the
+     * watchpoint's own condition, else from "monitor watch-value"
+     */
+    uint32_t match_value = 0, match_mask = 0;
+    int match = 0;
+    if (count_watchpoints() == 1) {
+        match = watch_condition_value(active, &match_value, &match_mask) == 0;
+        if (!match && watch_data.active &&
+            watchpoints[active].addr == watch_data.addr &&
+            watchpoints[active].length == watch_data.length) {
+            match_value = watch_data.value;
+            match_mask = watch_data.mask;
+            match = 1;
+        }
+    }
+    if (match) {
+        uint32_t length = watchpoints[active].length;
+        uint32_t lane_shift;
+        uint32_t lanes = watch_data_lanes(watchpoints[active].addr, length, &lane_shift);
+        uint32_t lane_mask = length == 4 ? 0xFFFFFFFF
+                           : ((1u << (length * 8)) - 1) << lane_shift;
+        uint32_t dbr = (match_value << lane_shift) & lane_mask;
+        uint32_t dbmr = ~((match_mask << lane_shift) & lane_mask);
+
+        LOG_DEBUG(LOG_RUN, "Data match: DBR=0x%08X DBMR=0x%08X\n", dbr, dbmr);
+        if (write_data_breakpoint_reg(DEBUG_REG_DBR, dbr) != 0 ||
+            write_data_breakpoint_reg(DEBUG_REG_DBMR, dbmr) != 0) {
+            LOG_ERROR(LOG_RUN, "Failed to write DBR/DBMR\n");
+            return -1;
+        }
+        tdr_shadow |= lanes;
+    }
+
+    if (write_tdr(tdr_shadow) != 0) {
+        LOG_ERROR(LOG_RUN, "Failed to write TDR\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Set a watchpoint (data breakpoint) at the given address range
+ * Parameters:
+ *   addr   - Start address of memory region to watch
+ *   length - Size of memory region (1, 2, 4 bytes typically)
+ *   type   - Watchpoint type (WP_TYPE_WRITE, WP_TYPE_READ, WP_TYPE_ACCESS)
+ *   conds  - Conditions from the Z packet, owned by the watchpoint on
+ *            success (NULL = unconditional)
+ * Returns: 0 on success, -1 on failure
+ */
+static int set_watchpoint(uint32_t addr, uint32_t length, watchpoint_type_t type,
+                          bp_cond_t *conds) {
+    if (length == 0 || type < WP_TYPE_WRITE || type > WP_TYPE_ACCESS) {
+        LOG_WARN(LOG_RUN, "Invalid watchpoint\n");
+        return -1;
+    }
+
+    int slot = -1;
+    for (int i = 0; i < MAX_WATCHPOINTS; i++) {
+        if (!watchpoints[i].active) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        LOG_WARN(LOG_RUN, "No free watchpoint slots (%d supported)\n", MAX_WATCHPOINTS);
+        return -1;
+    }
+
+    watchpoints[slot].addr = addr;
+    watchpoints[slot].length = length;
+    watchpoints[slot].type = type;
+    watchpoints[slot].active = 1;
+    watchpoints[slot].conds = conds;
+    watch_last.addr = addr;
+    watch_last.length = length;
+
+    if (apply_watchpoints() != 0) {
+        watchpoints[slot].active = 0;
+        watchpoints[slot].conds = NULL;
+        apply_watchpoints();
+        return -1;
+    }
+
+    LOG_INFO(LOG_RUN, "Watchpoint set: 0x%08X-0x%08X (type=%d, TDR=0x%08X)\n",
+             addr, addr + length - 1, type, tdr_shadow);
+    return 0;
+}
+
+/* Clear a watchpoint at the given address
+ * Returns: 0 on success, -1 on failure
+ */
+static int clear_watchpoint(uint32_t addr, uint32_t length, watchpoint_type_t type) {
+    for (int i = 0; i < MAX_WATCHPOINTS; i++) {
+        if (watchpoints[i].active &&
+            watchpoints[i].addr == addr &&
+            watchpoints[i].length == length &&
+            watchpoints[i].type == type) {
+            watchpoints[i].active = 0;
+            free_conditions(watchpoints[i].conds);
+            watchpoints[i].conds = NULL;
+            apply_watchpoints();
+            LOG_INFO(LOG_RUN, "Watchpoint cleared at 0x%08X\n", addr);
+            return 0;
+        }
+    }
+
+    LOG_WARN(LOG_RUN, "No watchpoint 0x%08X/%u/%d to clear\n", addr, length, type);
+    return -1;
+}
+
+/* Set or clear the data value a watched variable must match
+ * The variable is the only watchpoint GDB has inserted or, between stops
+ * (when GDB has removed them all), the one it inserted last.
+ * Returns: 0 on success, -1 if there is no single variable or the
+ * comparator can't match its size/alignment
+ */
+static int set_watch_value(int enable, uint32_t value, uint32_t mask) {
+    if (!enable) {
+        watch_data.active = 0;
+        return apply_watchpoints();
+    }
+
+    uint32_t addr = watch_last.addr, length = watch_last.length;
+    int count = count_watchpoints();
+    if (count > 1) {
+        LOG_WARN(LOG_RUN, "Data value match needs exactly one watchpoint\n");
+        return -1;
+    }
+    for (int i = 0; i < MAX_WATCHPOINTS && count == 1; i++) {
+        if (watchpoints[i].active) {
+            addr = watchpoints[i].addr;
+            length = watchpoints[i].length;
+        }
+    }
+    uint32_t shift;
+    if (length == 0 || watch_data_lanes(addr, length, &shift) == 0) {
+        LOG_WARN(LOG_RUN, "Data value match needs an aligned 1, 2 or 4 byte watchpoint\n");
+        return -1;
+    }
+
+    watch_data.active = 1;
+    watch_data.addr = addr;
+    watch_data.length = length;
+    watch_data.value = value;
+    watch_data.mask = mask;
+    LOG_INFO(LOG_RUN, "Data value match on 0x%08X/%u: 0x%X mask 0x%X\n", addr, length, value, mask);
+    return apply_watchpoints();
+}
+
+/* Remember watched contents before resuming, so a halt inside the shared
+ * address range can be attributed to the write watchpoint that changed
+ * (only needed when several watchpoints share the comparator)
+ */
+static void snapshot_watchpoints(void) {
+    if (count_watchpoints() < 2) {
+        return;
+    }
+    for (int i = 0; i < MAX_WATCHPOINTS; i++) {
+        if (watchpoints[i].active && watchpoints[i].type == WP_TYPE_WRITE) {
+            uint32_t n = watchpoints[i].length < WP_SNAPSHOT_MAX ? watchpoints[i].length : WP_SNAPSHOT_MAX;
+            cmd_0717_read_memory(g_usb_dev, watchpoints[i].addr, n, watchpoints[i].snapshot, n);
+        }
+    }
+}
+
+/* Did a debug module trigger (address or PC breakpoint) stop the core?
+ * 'csr' is the status read at the halt (the bits clear on read).
+ */
+static int halt_by_trigger(uint32_t csr) {
+    if (csr & CSR_HALT) {
+        return 0;       /* HALT instruction */
+    }
+    return (csr & (CSR_TRG | CSR_BKPT)) || (csr & CSR_BSTAT_MASK) == CSR_BSTAT_L1HIT;
+}
+
+#define WP_HIT_NONE     (-1)    /* Not a watchpoint halt, report it */
+#define WP_HIT_SPURIOUS (-2)    /* Trigger inside the shared range, resume */
+
+/* Find the watchpoint that caused the halt
+ * NOTE: CSR doesn't say which address matched, so:
+ *   - a halt that isn't a trigger halt is never a watchpoint
+ *   - with one watchpoint armed, a trigger halt is attributed to it
+ *   - with several, a write watch whose contents changed wins; if all of
+ *     them are write watches and none changed, the trigger came from an
+ *     access between them (or a write of the same value) and is spurious;
+ *     with read/access watches it can't be attributed and is reported as
+ *     a plain stop
+ * Returns: watchpoint index, WP_HIT_NONE or WP_HIT_SPURIOUS
+ */
+static int check_watchpoint_hit(uint32_t csr) {
+    int count = count_watchpoints();
+    if (count == 0 || !(tdr_shadow & TDR_TRC_HALT) || !halt_by_trigger(csr)) {
+        return WP_HIT_NONE;
+    }
+
+    if (count == 1) {
+        for (int i = 0; i < MAX_WATCHPOINTS; i++) {
+            if (watchpoints[i].active) {
+                LOG_INFO(LOG_RUN, "Watchpoint may have triggered at 0x%08X\n", watchpoints[i].addr);
+                return i;
+            }
+        }
+    }
+
+    for (int i = 0; i < MAX_WATCHPOINTS; i++) {
+        if (watchpoints[i].active && watchpoints[i].type == WP_TYPE_WRITE) {
+            uint8_t now[WP_SNAPSHOT_MAX];
+            uint32_t n = watchpoints[i].length < WP_SNAPSHOT_MAX ? watchpoints[i].length : WP_SNAPSHOT_MAX;
+            if (cmd_0717_read_memory(g_usb_dev, watchpoints[i].addr, n, now, n) == 0 &&
+                memcmp(now, watchpoints[i].snapshot, n) != 0) {
+                return i;
+            }
+        }
+    }
+    for (int i = 0; i < MAX_WATCHPOINTS; i++) {
+        if (watchpoints[i].active && watchpoints[i].type != WP_TYPE_WRITE) {
+            return WP_HIT_NONE;
+        }
+    }
+    return WP_HIT_SPURIOUS;
+}
+
+/*
+ * Flash Programming Functions for vFlash* GDB commands
+ */
+
+/*
+ * GPL Flashloader Implementation
+ * Uses the ELF-based flashloader from flashloader/flashloader.elf
+ */
+
+/* Initialize flashloader (must be called before erase/program) */
+static int flash_init_loader(void) {
+    if (flash_state.initialized) {
+        return 0;  /* Already initialized */
+    }
+
+    printf("Flash: Initializing GPL flashloader...\n");
+
+    /* The flashloader is loaded into SRAM and runs on the target */
+    invalidate_halt_state();
+
+    int r = gpl_flash_init(&flash_state.gpl_state, g_usb_dev, NULL);
+    if (r != 0) {
+        printf("Flash: GPL flashloader init failed\n");
+        return -1;
+    }
+
+    flash_state.initialized = 1;
+    printf("Flash: GPL flashloader initialized (entry=0x%08X)\n",
+           gpl_flash_get_entry_point(&flash_state.gpl_state));
+    return 0;
+}
+
+/* Erase flash sectors covering addr to addr+length */
+static int flash_erase_region(uint32_t addr, uint32_t length) {
+    if (addr + length > FLASH_SIZE) {
+        printf("Flash: Erase region 0x%08X-0x%08X exceeds flash size\n",
+               addr, addr + length);
         return -1;
     }
 
@@ -1187,8 +2317,13 @@ static int flash_erase_region(uint32_t addr, uint32_t length) {
     r = gpl_flash_erase_range(&flash_state.gpl_state, addr, length);
     if (r != 0) {
         printf("Flash: GPL erase failed\n");
+        flash_cache_invalidate(addr, length);
         return -1;
     }
+    flash_cache_erased(addr, length);
+
+    /* The flashloader ran in SRAM */
+    invalidate_halt_state();
 
     /* Track erased region */
     if (!flash_state.erased || addr < flash_state.erase_start) {
@@ -1218,8 +2353,11 @@ static int flash_program_region(uint32_t addr, const uint8_t *data, uint32_t len
     r = gpl_flash_program(&flash_state.gpl_state, addr, data, length);
     if (r != 0) {
         printf("Flash: GPL program failed\n");
+        flash_cache_invalidate(addr, length);
         return -1;
     }
+    flash_cache_programmed(addr, data, length);
+    invalidate_halt_state();
 
     return 0;
 }
@@ -1243,27 +2381,246 @@ static void flash_reset_state(void) {
 }
 
 
-/* Handle 'c' - continue execution */
-static int handle_continue(int sock, const char *data) {
-    /* Optional: resume from address if specified */
-    if (data && *data) {
-        uint32_t addr = strtoul(data, NULL, 16);
-        write_cpu_register(REG_PC, addr);
-    }
+/* PC-sampling profiler
+ * V2 BDM cannot read the PC of a running core, so each sample is a short
+ * halt: stop, read PC and the A6 frame-pointer chain, resume. The time the
+ * core spends stopped is the profiler's overhead and is reported with the
+ * achieved sample rate.
+ */
+#define PROFILE_RATE_DEFAULT    100
+#define PROFILE_RATE_MAX        1000
+#define PROFILE_DEPTH_DEFAULT   8
 
-    /* Debug: read PC before continue */
-    uint32_t pc_before = 0;
-    cmd_read_pc(g_usb_dev, &pc_before);
-    printf("DEBUG continue: PC before GO = 0x%08X\n", pc_before);
+/* CSR status of the last halt run_until_halt() saw (the bits clear on
+ * read, so whoever reads CSR first at a halt records it here)
+ */
+static uint32_t g_halt_csr = 0;
 
-    /* Enter BDM mode 0xF8 and send BDM GO to resume target */
-    cmd_enter_mode(g_usb_dev, 0xF8);
-    int go_result = cmd_07_02_bdm_go(g_usb_dev);  /* BDM GO - start execution from current PC */
-    printf("DEBUG continue: BDM GO returned %d\n", go_result);
-    g_target_halted = 0;
+/* Firmware symbols from --symbols or --profile */
+static symbol_table_t g_symbols;
 
-    /* Give target time to start executing before polling for halt */
-    usleep(100000);  /* 100ms delay */
+static struct {
+    int active;
+    profile_t prof;
+    int rate;                   /* Samples per second */
+    int depth;                  /* Return addresses per sample */
+    double next_ms;             /* Schedule, on the profile_clock_ms() clock */
+    double run_ms;              /* Time the target ran while profiling */
+    double halted_ms;           /* Time the target was stopped for samples */
+    double halted_max_ms;
+    uint32_t errors;
+} g_profile;
+
+static double profile_clock_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+static int profile_start(int rate, int depth) {
+    if (g_profile.active) {
+        profile_free(&g_profile.prof);
+    }
+    memset(&g_profile, 0, sizeof(g_profile));
+    if (profile_init(&g_profile.prof, &g_symbols) != 0) {
+        return -1;
+    }
+    g_profile.rate = rate;
+    g_profile.depth = depth;
+    g_profile.next_ms = profile_clock_ms();
+    g_profile.active = 1;
+    return 0;
+}
+
+/* Return addresses from the A6 frame chain: each frame holds the caller's
+ * A6 and then the return address. Stops at anything that does not look
+ * like a frame in SRAM or a return into known code.
+ */
+static int profile_walk_frames(uint32_t *frames, int depth, int max_depth) {
+    uint32_t fp;
+    if (read_cpu_register_bdm(REG_A0 + 6, &fp) != 0) {
+        return depth;
+    }
+    while (depth < max_depth && (fp & 1) == 0 &&
+           fp >= SRAM_BASE && fp + 8 <= SRAM_BASE + SRAM_SIZE) {
+        uint8_t frame[8];
+        if (read_target_direct(fp, frame, sizeof(frame)) != 0) {
+            break;
+        }
+        uint32_t next = (frame[0] << 24) | (frame[1] << 16) | (frame[2] << 8) | frame[3];
+        uint32_t ret = (frame[4] << 24) | (frame[5] << 16) | (frame[6] << 8) | frame[7];
+        if (!symbol_at(&g_symbols, ret - 2)) {
+            break;
+        }
+        frames[depth++] = ret;
+        if (next <= fp) {
+            break;      /* Callers' frames are above ours */
+        }
+        fp = next;
+    }
+    return depth;
+}
+
+/* Take one sample of the running target
+ * Returns: 0 sampled and resumed, 1 the target had stopped by itself
+ * (it is left halted), -1 the sample failed
+ */
+static int profile_sample(void) {
+    uint32_t frames[PROFILE_MAX_DEPTH];
+    uint32_t csr;
+    uint8_t is_frozen = 0;
+    double t0 = profile_clock_ms();
+
+    /* Catch a halt that happened since the last poll before stopping the
+     * core ourselves, so a breakpoint is never mistaken for a sample
+     */
+    if (cmd_bdm_freeze(g_usb_dev, &is_frozen) == 0 && is_frozen) {
+        cmd_enter_mode(g_usb_dev, 0xF8);
+        read_csr(&g_halt_csr);
+        return 1;
+    }
+    cmd_bdm_halt(g_usb_dev);
+    for (int i = 0; i < 10 && !is_frozen; i++) {
+        cmd_bdm_freeze(g_usb_dev, &is_frozen);
+    }
+    if (!is_frozen) {
+        g_profile.errors++;
+        return -1;
+    }
+    cmd_enter_mode(g_usb_dev, 0xF8);
+
+    /* Reading CSR also clears the status of our own halt, so
+     * run_until_halt() doesn't take it for a breakpoint. A HALT
+     * instruction or trigger that beat our halt shows up here.
+     */
+    if (read_csr(&csr) == 0 && (csr & (CSR_HALT | CSR_TRG))) {
+        g_halt_csr = csr;
+        return 1;
+    }
+
+    int depth = 0;
+    if (read_cpu_register_bdm(REG_PC, &frames[0]) == 0) {
+        depth = profile_walk_frames(frames, 1, g_profile.depth + 1);
+        profile_add(&g_profile.prof, frames, depth);
+    } else {
+        g_profile.errors++;
+    }
+
+    cmd_enter_mode(g_usb_dev, 0xF8);
+    invalidate_halt_state();
+    cmd_07_02_bdm_go(g_usb_dev);
+
+    double ms = profile_clock_ms() - t0;
+    g_profile.halted_ms += ms;
+    if (ms > g_profile.halted_max_ms) {
+        g_profile.halted_max_ms = ms;
+    }
+    return depth ? 0 : -1;
+}
+
+/* Call often while the target runs; samples when the next one is due.
+ * Returns 1 if the target was found stopped by itself.
+ */
+static int profile_poll(void) {
+    if (!g_profile.active) {
+        return 0;
+    }
+    double now = profile_clock_ms();
+    if (now < g_profile.next_ms) {
+        return 0;
+    }
+    /* Fall back onto the schedule instead of bursting after a stall */
+    g_profile.next_ms += 1000.0 / g_profile.rate;
+    if (g_profile.next_ms < now) {
+        g_profile.next_ms = now + 1000.0 / g_profile.rate;
+    }
+    return profile_sample() == 1;
+}
+
+/* Stop profiling and write <prefix>.txt / <prefix>.folded
+ * 'summary' gets the statistics followed by the hottest functions.
+ */
+static int profile_stop(const char *prefix, char *summary, size_t size) {
+    char header[512];
+    char top[1024];
+    uint32_t samples = g_profile.prof.samples;
+    double secs = g_profile.run_ms / 1000.0;
+    double achieved = secs > 0 ? samples / secs : 0.0;
+    double overhead = g_profile.run_ms > 0 ? 100.0 * g_profile.halted_ms / g_profile.run_ms : 0.0;
+    double avg_us = samples ? 1000.0 * g_profile.halted_ms / samples : 0.0;
+
+    snprintf(header, sizeof(header),
+             "# %u samples in %.2f s: %.1f Hz (target %d Hz), depth %d\n"
+             "# halt per sample avg %.0f us max %.0f us, overhead %.2f%%, errors %u",
+             samples, secs, achieved, g_profile.rate, g_profile.depth,
+             avg_us, 1000.0 * g_profile.halted_max_ms, overhead, g_profile.errors);
+
+    int ret = profile_write(&g_profile.prof, prefix, header, top, sizeof(top), 10);
+    snprintf(summary, size, "%s\n%s%s", header, ret == 0 ? "" : "# Failed to write profile\n",
+             ret == 0 ? top : "");
+    profile_free(&g_profile.prof);
+    g_profile.active = 0;
+    return ret;
+}
+
+/* Set when the last run_until_halt() was stopped by GDB (Ctrl-C) */
+static int g_run_interrupted = 0;
+
+
+/* GDB sent Ctrl-C (or went away) while the target runs */
+static int gdb_interrupt_pending(void) {
+    for (;;) {
+        fd_set readfds;
+        struct timeval tv = { 0, 0 };
+        char c;
+        if (g_client_socket < 0) {
+            return 0;
+        }
+        FD_ZERO(&readfds);
+        FD_SET(g_client_socket, &readfds);
+        if (select(g_client_socket + 1, &readfds, NULL, NULL, &tv) <= 0) {
+            return 0;
+        }
+        ssize_t n = recv(g_client_socket, &c, 1, MSG_PEEK);
+        if (n <= 0) {
+            return 1;   /* Disconnected */
+        }
+        if (c != 0x03 && c != '+') {
+            return 0;   /* A packet; handle_client() will see it */
+        }
+        recv(g_client_socket, &c, 1, 0);
+        if (c == 0x03) {
+            return 1;
+        }
+    }
+}
+
+/* Resume the target and wait until it halts
+ * While a live-watch client or the profiler is sampling there is no
+ * timeout: the target runs until it halts by itself or GDB interrupts it.
+ * Returns: 1 if the target halted by itself (breakpoint, watchpoint,
+ * exception), 0 if it had to be halted after the timeout or an interrupt
+ */
+static int run_until_halt(void) {
+    /* Enter BDM mode 0xF8 and send BDM GO to resume target */
+    cmd_enter_mode(g_usb_dev, 0xF8);
+    invalidate_halt_state();
+    int go_result = cmd_07_02_bdm_go(g_usb_dev);  /* BDM GO - start execution from current PC */
+    LOG_DEBUG(LOG_RUN, "Continue: BDM GO returned %d\n", go_result);
+    g_target_halted = 0;
+    g_run_interrupted = 0;
+    g_halt_csr = 0;
+
+    int live = live_watch_active() || g_profile.active;
+    double run_start = profile_clock_ms();
+    live_watch_run_start();
+
+    /* Give target time to start executing before polling for halt */
+    for (int i = 0; i < 100; i++) {  /* 100ms delay */
+        usleep(1000);
+        live_watch_poll(g_usb_dev);
+        profile_poll();     /* A self-halt is caught by the loop below */
+    }
 
     /* Wait for target to halt (breakpoint, exception, or user interrupt)
      * Poll for halt status with timeout - target should halt on:
@@ -1273,14 +2630,24 @@ static int handle_continue(int sock, const char *data) {
      * - Manual halt (Ctrl-C)
      */
     int halted = 0;
-    for (int i = 0; i < 5000; i++) {  /* 5 second timeout */
+    for (int i = 0; live || i < 5000; i++) {  /* 5 second timeout */
         usleep(1000);  /* 1ms between polls */
+        live_watch_poll(g_usb_dev);
 
         uint8_t is_frozen = 0;
         int poll_result = cmd_bdm_freeze(g_usb_dev, &is_frozen);
 
         if (poll_result == 0 && is_frozen) {
-            printf("Target halted after %d ms (freeze detected)\n", i);
+            LOG_DEBUG(LOG_RUN, "Target halted after %d ms (freeze detected)\n", i);
+            if (g_halt_csr == 0) {
+                cmd_enter_mode(g_usb_dev, 0xF8);
+                read_csr(&g_halt_csr);
+            }
+            halted = 1;
+            break;
+        }
+        if (profile_poll()) {
+            LOG_DEBUG(LOG_RUN, "Target halted after %d ms (seen by the profiler)\n", i);
             halted = 1;
             break;
         }
@@ -1290,12 +2657,18 @@ static int handle_continue(int sock, const char *data) {
          * but CSR bit 24 (BKPT) is set when a hardware breakpoint triggers.
          */
         if ((i % 10) == 9) {
+            if (gdb_interrupt_pending() || !g_running) {
+                LOG_INFO(LOG_RUN, "Interrupted after %d ms\n", i);
+                g_run_interrupted = 1;
+                break;
+            }
             cmd_enter_mode(g_usb_dev, 0xF8);
             uint32_t csr = 0;
             if (read_csr(&csr) == 0) {
                 int bkpt_bit = (csr >> 24) & 1;
                 if (bkpt_bit) {
-                    printf("Target halted after %d ms (BKPT detected, CSR=0x%08X)\n", i, csr);
+                    LOG_DEBUG(LOG_RUN, "Target halted after %d ms (BKPT detected, CSR=0x%08X)\n", i, csr);
+                    g_halt_csr = csr;
                     halted = 1;
                     break;
                 }
@@ -1303,193 +2676,273 @@ static int handle_continue(int sock, const char *data) {
         }
     }
 
+    live_watch_run_stop();
+    if (g_profile.active) {
+        g_profile.run_ms += profile_clock_ms() - run_start;
+    }
+
     if (!halted) {
         /* Timeout - force halt */
-        printf("Continue timeout, forcing halt\n");
-        cmd_bdm_halt(g_usb_dev);
-
-        /* Wait for target to actually halt */
-        usleep(10000);  /* 10ms delay */
-
-        /* Re-enter BDM mode after halt to enable register access */
-        cmd_enter_mode(g_usb_dev, 0xF8);
-
-        /* Verify target is now halted */
-        uint8_t is_frozen = 0;
-        for (int i = 0; i < 10; i++) {
-            cmd_bdm_freeze(g_usb_dev, &is_frozen);
-            if (is_frozen) break;
-            usleep(1000);
+        if (!g_run_interrupted) {
+            LOG_WARN(LOG_RUN, "Continue timeout, forcing halt\n");
         }
-        printf("DEBUG: After halt, is_frozen=%d\n", is_frozen);
+        int is_frozen = target_halt(g_usb_dev) == 0;
+        LOG_DEBUG(LOG_RUN, "After halt, is_frozen=%d\n", is_frozen);
 
         /* Read CSR to see target state */
         uint32_t csr = 0;
         read_csr(&csr);
-        printf("DEBUG: CSR after halt = 0x%08X (HALT=%d, BKPT=%d)\n",
-               csr, (csr >> 25) & 1, (csr >> 24) & 1);
-
-        /* Debug: read PC after halt */
-        uint32_t pc_after = 0;
-        cmd_read_pc(g_usb_dev, &pc_after);
-        printf("DEBUG: PC after halt = 0x%08X\n", pc_after);
+        LOG_DEBUG(LOG_RUN, "CSR after halt = 0x%08X (HALT=%d, BKPT=%d)\n",
+                  csr, (csr >> 25) & 1, (csr >> 24) & 1);
     }
 
     g_target_halted = 1;
+    return halted;
+}
+
+/* Execute a single instruction (see target_step())
+ * Returns: 0 if the target halted by itself, -1 on error or forced halt
+ */
+static int single_step_target(void) {
+    invalidate_halt_state();
+    int r = target_step(g_usb_dev, &g_step_count);
+    g_target_halted = 1;
+    return r;
+}
 
-    /* Check if we hit a watchpoint - report with watch reason */
-    uint32_t wp_addr = check_watchpoint_hit();
-    if (wp_addr != 0) {
-        char response[64];
-        /* GDB expects: T05watch:ADDR; for watchpoint hits */
-        snprintf(response, sizeof(response), "T05watch:%x;", wp_addr);
-        printf("Watchpoint hit at 0x%08X\n", wp_addr);
-        return send_packet(sock, response);
+/* Move an installed software breakpoint into a free PBR slot
+ * Breakpoints that get stepped over repeatedly (conditional breakpoints,
+ * GDB resuming from them) then no longer need code memory rewritten.
+ * Returns: 0 if the breakpoint is now in hardware, -1 otherwise
+ */
+static int migrate_to_hw_breakpoint(breakpoint_t *bp) {
+    int slot = find_free_hw_slot();
+    if (slot < 0 || !bp->want) {
+        return -1;
     }
-
-    /* Check if we hit a software breakpoint */
-    if (check_sw_breakpoint_hit()) {
-        /* PC is at the HALT instruction - report breakpoint */
+    if (clear_sw_breakpoint(bp) != 0) {
+        return -1;
     }
-
-    /* Report stop reason: SIGTRAP (breakpoint/trace trap) */
-    return send_packet(sock, "S05");
+    if (install_hw_breakpoint(slot, bp->addr) != 0) {
+        set_sw_breakpoint(bp);
+        return -1;
+    }
+    bp->hw_slot = slot;
+    update_hw_breakpoint_tdr();
+    LOG_INFO(LOG_RUN, "Breakpoint at 0x%08X moved to PBR%d\n", bp->addr, slot);
+    return 0;
 }
 
-/*
- * Reset BDM single-step capability using mode transition sequence.
+/* Execute the instruction under an installed breakpoint without reporting
+ * a stop, leaving the breakpoint armed afterwards. GDB is not involved.
  *
- * The Multilink USB-ML-12 firmware has an internal counter that limits single-step
- * operations to 2 before getting stuck. The sequence F8->F0->F8 resets this
- * counter. This is a workaround discovered through reverse engineering.
- *
- * The mode transitions don't affect CPU state (registers/memory) but do
- * affect the BDM controller state. PC is preserved by reading it before
- * and restoring it after the reset sequence.
+ * PBR breakpoints are masked in TDR for the step, so code memory is never
+ * touched. Software breakpoints move to a free PBR first when one exists;
+ * otherwise the original instruction is put back for the step, reusing the
+ * word read once for both the restore and the re-arm write.
+ * Returns: 0 on success, -1 on failure
  */
-static void reset_single_step_capability(void) {
-    uint32_t saved_pc;
+static int step_over_breakpoint(breakpoint_t *bp) {
+    int r;
 
-    /* Save current PC (mode transitions may affect it) */
-    read_cpu_register(REG_PC, &saved_pc);
+    if (bp->sw_installed) {
+        migrate_to_hw_breakpoint(bp);
+    }
 
-    /* Apply the magic reset sequence: F8 -> F0 -> F8 */
-    cmd_enter_mode(g_usb_dev, 0xF8);
-    cmd_enter_mode(g_usb_dev, 0xF0);
-    cmd_enter_mode(g_usb_dev, 0xF8);
+    if (bp->sw_installed) {
+        uint8_t next_bytes[2];
+        if (cmd_0717_read_memory(g_usb_dev, bp->addr + 2, 2, next_bytes, 2) != 0) {
+            return -1;
+        }
+        uint32_t tail = (next_bytes[0] << 8) | next_bytes[1];
+
+        if (write_target_long(bp->addr, ((uint32_t)bp->original_insn << 16) | tail) != 0) {
+            return -1;
+        }
+        r = single_step_target();
+        if (write_target_long(bp->addr, ((uint32_t)COLDFIRE_HALT_OPCODE << 16) | tail) != 0) {
+            LOG_ERROR(LOG_RUN, "Failed to re-arm breakpoint at 0x%08X\n", bp->addr);
+            bp->sw_installed = 0;
+            bp_sw_installed--;
+            r = -1;
+        }
+    } else if (bp->hw_slot >= 0) {
+        /* Mask the PBR in TDR for one step */
+        uint32_t saved_tdr = tdr_shadow;
+        tdr_shadow &= ~(1 << (24 + bp->hw_slot));
+        write_tdr(tdr_shadow);
+        r = single_step_target();
+        tdr_shadow = saved_tdr;
+        if (write_tdr(tdr_shadow) != 0) {
+            r = -1;
+        }
+    } else {
+        r = single_step_target();
+    }
+
+    LOG_INFO(LOG_RUN, "Stepped over breakpoint at 0x%08X\n", bp->addr);
+    return r;
+}
 
-    /* Restore PC */
-    write_cpu_register(REG_PC, saved_pc);
+/* Apply pending breakpoint changes before a resume
+ * Returns the installed breakpoint at the current PC that the resume has to
+ * step over, or NULL
+ */
+static breakpoint_t *prepare_resume(void) {
+    uint32_t pc = 0;
+    read_cpu_register(REG_PC, &pc);
 
-    /* Reset step counter */
-    g_step_count = 0;
+    breakpoint_t *bp = find_breakpoint(pc);
+    sync_breakpoints(bp);
 
-    printf("BDM single-step capability reset (PC=0x%08X)\n", saved_pc);
+    /* sync may have freed an entry that was neither wanted nor installed */
+    bp = find_breakpoint(pc);
+    return (bp && breakpoint_installed(bp)) ? bp : NULL;
 }
 
-/* Handle 's' - single step */
-static int handle_step(int sock, const char *data) {
-    /* Optional: step from address if specified */
+/* Handle 'c' - continue execution */
+static int handle_continue(int sock, const char *data) {
+    /* Optional: resume from address if specified */
     if (data && *data) {
         uint32_t addr = strtoul(data, NULL, 16);
         write_cpu_register(REG_PC, addr);
     }
 
-    /*
-     * BDM single-step workaround: The Multilink USB-ML-12 firmware has a 2-step
-     * limit before getting stuck. Reset the BDM state every 2 steps.
+    /* Apply breakpoint changes GDB made while the target was halted */
+    breakpoint_t *at_pc = prepare_resume();
+
+    /* Debug: read PC before continue */
+    uint32_t pc_before = 0;
+    cmd_read_pc(g_usb_dev, &pc_before);
+    LOG_DEBUG(LOG_RUN, "Continue: PC before GO = 0x%08X\n", pc_before);
+
+    /* Resuming from a breakpoint: execute its instruction first so the
+     * target doesn't stop again immediately
      */
-    if (g_step_count >= 2) {
-        reset_single_step_capability();
+    if (at_pc) {
+        step_over_breakpoint(at_pc);
+        if (!at_pc->want) {
+            sync_breakpoints(NULL);  /* GDB had removed it */
+        }
     }
 
-    printf("Single stepping... (step %d)\n", g_step_count + 1);
+    uint32_t halt_pc = 0;
+    int wp = -1;
+    for (;;) {
+        snapshot_watchpoints();
+        int halted = run_until_halt();
 
-    /* Read PC before step */
-    uint32_t pc_before = 0;
-    read_cpu_register(REG_PC, &pc_before);
-    printf("PC before step: 0x%08X\n", pc_before);
-
-    /* ColdFire single step sequence:
-     * 1. Read current CSR
-     * 2. Set SSM (Single Step Mode) bit
-     * 3. Write CSR
-     * 4. Execute GO command
-     * 5. Wait for target to halt
-     * 6. Clear SSM bit
-     */
+        /* Capture the halt-time PC once; stop-reason checks below and GDB's
+         * register reads use it without another target round trip
+         */
+        read_cpu_register(REG_PC, &halt_pc);
+        LOG_DEBUG(LOG_RUN, "PC after halt = 0x%08X\n", halt_pc);
+
+        /* Conditional breakpoint: evaluate on the target side and resume
+         * without involving GDB while the condition is false
+         */
+        breakpoint_t *bp = halted ? find_breakpoint(halt_pc) : NULL;
+        if (bp && bp->want && breakpoint_installed(bp) && !conditions_met(bp->conds, bp->addr)) {
+            LOG_INFO(LOG_RUN, "Breakpoint condition false at 0x%08X, resuming\n", halt_pc);
+            if (step_over_breakpoint(bp) != 0) {
+                break;
+            }
+            continue;
+        }
 
-    /* Step 1: Read current CSR */
-    uint32_t csr = 0;
-    if (read_csr(&csr) != 0) {
-        printf("Failed to read CSR\n");
-        return send_packet(sock, "S05"); /* Report halt anyway */
+        /* Anything else that isn't a breakpoint: was it a watchpoint? A
+         * trigger inside the shared watch range that no watchpoint claims
+         * is not reported to GDB; every other halt is.
+         */
+        if (halted && !(bp && breakpoint_installed(bp))) {
+            wp = check_watchpoint_hit(g_halt_csr);
+            if (wp == WP_HIT_SPURIOUS) {
+                LOG_INFO(LOG_RUN, "Access outside watched variables, resuming\n");
+                continue;
+            }
+            if (wp >= 0 && !conditions_met(watchpoints[wp].conds, watchpoints[wp].addr)) {
+                LOG_INFO(LOG_RUN, "Watch condition false at 0x%08X, resuming\n", watchpoints[wp].addr);
+                wp = WP_HIT_NONE;
+                continue;
+            }
+        }
+        break;
     }
-    printf("CSR before step: 0x%08X\n", csr);
 
-    /* Step 2-3: Set SSM bit and write */
-    csr |= CSR_SSM;
-    if (write_csr(csr) != 0) {
-        printf("Failed to write CSR with SSM\n");
-        return send_packet(sock, "S05");
+    /* Check if we hit a watchpoint - report with watch reason */
+    if (wp >= 0) {
+        static const char *const reason[] = {
+            [WP_TYPE_WRITE] = "watch", [WP_TYPE_READ] = "rwatch", [WP_TYPE_ACCESS] = "awatch"
+        };
+        char response[64];
+        /* GDB expects: T05watch:ADDR; (rwatch/awatch for read/access) */
+        snprintf(response, sizeof(response), "T05%s:%x;",
+                 reason[watchpoints[wp].type], watchpoints[wp].addr);
+        LOG_INFO(LOG_RUN, "Watchpoint hit at 0x%08X\n", watchpoints[wp].addr);
+        return send_packet(sock, response);
     }
 
-    /* Step 4: Execute GO */
-    cmd_07_02_bdm_go(g_usb_dev);
+    if (g_run_interrupted) {
+        return send_packet(sock, "S02");  /* SIGINT */
+    }
 
-    /* Step 5: Wait for auto-halt (single-step mode should halt after one instruction)
-     * The ColdFire should automatically halt when SSM is set, but we need to
-     * poll to detect when it happens
-     */
-    int halted = 0;
-    for (int i = 0; i < 100; i++) {  /* Up to 100ms timeout */
-        usleep(1000);  /* 1ms between checks */
-        uint8_t is_frozen = 0;
-        cmd_bdm_freeze(g_usb_dev, &is_frozen);
-        if (is_frozen) {
-            printf("Target halted after %d ms\n", i + 1);
-            halted = 1;
-            break;
-        }
+    /* Check if we hit a software breakpoint */
+    if (check_sw_breakpoint_hit(halt_pc)) {
+        /* PC is at the HALT instruction - report breakpoint */
     }
 
-    /* Force halt if auto-halt didn't work */
-    if (!halted) {
-        printf("Auto-halt timeout, forcing halt\n");
-        cmd_bdm_halt(g_usb_dev);
+    /* Report stop reason: SIGTRAP (breakpoint/trace trap) */
+    return send_packet(sock, "S05");
+}
+
+/* Handle 's' - single step */
+static int handle_step(int sock, const char *data) {
+    /* Optional: step from address if specified */
+    if (data && *data) {
+        uint32_t addr = strtoul(data, NULL, 16);
+        write_cpu_register(REG_PC, addr);
     }
 
-    /* Step 6: Clear SSM bit */
-    if (read_csr(&csr) == 0) {
-        csr &= ~CSR_SSM;
-        write_csr(csr);
-        printf("CSR after step: 0x%08X\n", csr);
+    /* Apply breakpoint changes GDB made while the target was halted */
+    breakpoint_t *at_pc = prepare_resume();
+
+    LOG_DEBUG(LOG_RUN, "Single stepping... (step %d)\n", g_step_count + 1);
+
+    /* Read PC before step */
+    uint32_t pc_before = 0;
+    read_cpu_register(REG_PC, &pc_before);
+    LOG_DEBUG(LOG_RUN, "PC before step: 0x%08X\n", pc_before);
+
+    /* Stepping off a breakpoint is handled here; if GDB removed it for the
+     * step it stays armed and the next sync takes it out, unless GDB puts
+     * it back first (the usual z/s/Z/c sequence), which then costs nothing
+     */
+    if (at_pc) {
+        step_over_breakpoint(at_pc);
+    } else {
+        single_step_target();
     }
 
     /* Read PC after step and report */
     uint32_t pc_after = 0;
     read_cpu_register(REG_PC, &pc_after);
-    printf("PC after step: 0x%08X\n", pc_after);
+    LOG_DEBUG(LOG_RUN, "PC after step: 0x%08X\n", pc_after);
 
     if (pc_after == pc_before) {
-        printf("WARNING: PC did not advance! Instruction at PC may be invalid.\n");
+        LOG_WARN(LOG_RUN, "PC did not advance! Instruction at PC may be invalid.\n");
         /* Read instruction at PC for debugging */
         uint32_t opcode = 0;
         cmd_read_memory_long_addr(g_usb_dev, pc_before, &opcode);
-        printf("Opcode at PC: 0x%08X\n", opcode);
+        LOG_DEBUG(LOG_RUN, "Opcode at PC: 0x%08X\n", opcode);
         if (opcode == 0xFFFFFFFF) {
-            printf("  -> Erased flash (no valid code)\n");
+            LOG_DEBUG(LOG_RUN, "  -> Erased flash (no valid code)\n");
         } else if (opcode == 0x00000000) {
-            printf("  -> Zero/uninitialized memory\n");
+            LOG_DEBUG(LOG_RUN, "  -> Zero/uninitialized memory\n");
         }
     } else {
-        printf("PC advanced by %d bytes\n", (int)(pc_after - pc_before));
+        LOG_DEBUG(LOG_RUN, "PC advanced by %d bytes\n", (int)(pc_after - pc_before));
     }
 
-    /* Increment step counter for BDM reset workaround */
-    g_step_count++;
-
-    g_target_halted = 1;
     return send_packet(sock, "S05"); /* SIGTRAP - stepped */
 }
 
@@ -1505,12 +2958,19 @@ static int handle_set_thread(int sock, const char *data) {
     return send_ok(sock);
 }
 
+static int do_coredump(const char *filename, int with_periph, double *elapsed_ms);
+
+/* SRAM snapshots, defined with the batch modes below */
+#define SNAPSHOT_SLOTS      8
+static int snapshot_save(int slot, double *elapsed_ms);
+static int snapshot_restore(int slot, double *elapsed_ms);
+
 /* Handle 'q' - general query */
 static int handle_query(int sock, const char *data) {
     if (strncmp(data, "Supported", 9) == 0) {
         /* Report supported features */
         /* Report supported features including flash programming and memory map */
-        return send_packet(sock, "PacketSize=1000;qXfer:features:read+;qXfer:memory-map:read+;vFlash+");
+        return send_packet(sock, "PacketSize=4000;qXfer:features:read+;qXfer:memory-map:read+;vFlash+;ConditionalBreakpoints+;QStartNoAckMode+");
     }
     else if (strncmp(data, "Attached", 8) == 0) {
         /* We're always attached to an existing process */
@@ -1539,35 +2999,11 @@ static int handle_query(int sock, const char *data) {
             return send_error(sock, 2);
         }
 
-        /* Read memory from target in chunks
-         * cmd_0717 uses 6-byte-per-4-byte format (1.5x expansion)
-         * with 256-byte USB buffer, max actual data is ~160 bytes
-         * Use 128 bytes to be safe
-         */
-        #define MAX_READ_CHUNK 128
-        uint32_t offset = 0;
-        int chunk_num = 0;
-        while (offset < length) {
-            uint32_t chunk = length - offset;
-            if (chunk > MAX_READ_CHUNK) {
-                chunk = MAX_READ_CHUNK;
-            }
-            int r = cmd_0717_read_memory(g_usb_dev, addr + offset, chunk, buffer + offset, chunk);
-            if (r != 0) {
-                fprintf(stderr, "qCRC: Failed to read memory at 0x%08X\n", addr + offset);
-                free(buffer);
-                return send_error(sock, 3);
-            }
-            /* Debug: show first 16 bytes of each chunk for first few chunks */
-            if (chunk_num < 4 && addr == 0) {
-                printf("qCRC: Chunk %d @ 0x%08X: ", chunk_num, addr + offset);
-                for (int i = 0; i < 16 && i < (int)chunk; i++) {
-                    printf("%02X ", buffer[offset + i]);
-                }
-                printf("\n");
-            }
-            offset += chunk;
-            chunk_num++;
+        /* Read memory from target (flash comes from the cache) */
+        if (read_target_memory(addr, buffer, length) != 0) {
+            fprintf(stderr, "qCRC: Failed to read memory at 0x%08X\n", addr);
+            free(buffer);
+            return send_error(sock, 3);
         }
 
         /* Debug: show first 32 bytes of read data */
@@ -1589,6 +3025,8 @@ static int handle_query(int sock, const char *data) {
             }
         }
 
+        breakpoint_shadow_read(addr, buffer, length);
+
         /* Calculate CRC32 using GDB-compatible xcrc32 (init=0xFFFFFFFF) */
         uint32_t crc = xcrc32(buffer, length, 0xFFFFFFFF);
         free(buffer);
@@ -1622,21 +3060,32 @@ static int handle_query(int sock, const char *data) {
         return send_packet(sock, xml);
     }
     else if (strncmp(data, "Xfer:memory-map:read:", 21) == 0) {
-        /* Memory map - defines flash and RAM regions */
-        /* MCF52233: 256KB flash at 0x00000000, 32KB SRAM at 0x20000000 */
-        /* IPSBAR: peripheral registers at 0x40000000 (2MB) */
-        /* Flash has 8KB hardware sectors, but we chunk erase/program in 0x800 (2KB) blocks */
-        const char *xml =
+        /* Memory map - built from mem_regions[]
+         * MCF52233: 256KB flash at 0x00000000, 32KB SRAM at 0x20000000
+         * IPSBAR: peripheral registers at 0x40000000 (2MB)
+         * Flash has 8KB hardware sectors, but we chunk erase/program in 0x800 (2KB) blocks
+         */
+        char xml[1024];
+        int pos = snprintf(xml, sizeof(xml),
             "l<?xml version=\"1.0\"?>"
             "<!DOCTYPE memory-map PUBLIC \"+//IDN gnu.org//DTD GDB Memory Map V1.0//EN\" "
             "\"http://sourceware.org/gdb/gdb-memory-map.dtd\">"
-            "<memory-map>"
-            "<memory type=\"flash\" start=\"0x00000000\" length=\"0x40000\">"
-            "<property name=\"blocksize\">0x800</property>"
-            "</memory>"
-            "<memory type=\"ram\" start=\"0x20000000\" length=\"0x8000\"/>"
-            "<memory type=\"ram\" start=\"0x40000000\" length=\"0x200000\"/>"
-            "</memory-map>";
+            "<memory-map>");
+        for (unsigned i = 0; i < NUM_MEM_REGIONS; i++) {
+            if (mem_regions[i].blocksize) {
+                pos += snprintf(xml + pos, sizeof(xml) - pos,
+                    "<memory type=\"%s\" start=\"0x%08X\" length=\"0x%X\">"
+                    "<property name=\"blocksize\">0x%X</property>"
+                    "</memory>",
+                    mem_regions[i].type, mem_regions[i].start, mem_regions[i].length,
+                    mem_regions[i].blocksize);
+            } else {
+                pos += snprintf(xml + pos, sizeof(xml) - pos,
+                    "<memory type=\"%s\" start=\"0x%08X\" length=\"0x%X\"/>",
+                    mem_regions[i].type, mem_regions[i].start, mem_regions[i].length);
+            }
+        }
+        snprintf(xml + pos, sizeof(xml) - pos, "</memory-map>");
         return send_packet(sock, xml);
     }
     else if (strncmp(data, "Rcmd,", 5) == 0) {
@@ -1688,6 +3137,7 @@ static int handle_query(int sock, const char *data) {
             /* Set PC last (includes sync) */
             cmd_write_pc(g_usb_dev, reset_pc);
 
+            invalidate_halt_state();
             g_target_halted = 1;
             printf("Reset complete: PC=0x%08X, SP=0x%08X\n", reset_pc, reset_sp);
             fflush(stdout);
@@ -1699,6 +3149,7 @@ static int handle_query(int sock, const char *data) {
             /* Halt target */
             printf("Halting target...\n");
             cmd_bdm_halt(g_usb_dev);
+            invalidate_halt_state();
             g_target_halted = 1;
             return send_packet(sock, "4f4b0a");  /* "OK\n" */
         }
@@ -1706,10 +3157,126 @@ static int handle_query(int sock, const char *data) {
             /* Resume target execution */
             printf("Resuming target...\n");
             cmd_enter_mode(g_usb_dev, 0xF8);
+            invalidate_halt_state();
             cmd_07_02_bdm_go(g_usb_dev);
             g_target_halted = 0;
             return send_packet(sock, "4f4b0a");  /* "OK\n" */
         }
+        else if (strncmp(cmd_buf, "watch-value", 11) == 0) {
+            /* Data value match for the active watchpoint:
+             *   monitor watch-value <value> [mask]
+             *   monitor watch-value off
+             */
+            const char *arg = cmd_buf + 11;
+            while (*arg == ' ') arg++;
+            int r;
+            if (strcmp(arg, "off") == 0 || *arg == '\0') {
+                r = set_watch_value(0, 0, 0);
+            } else {
+                char *end;
+                uint32_t value = strtoul(arg, &end, 0);
+                uint32_t mask = 0xFFFFFFFF;
+                if (*end == ' ') {
+                    mask = strtoul(end, NULL, 0);
+                }
+                r = set_watch_value(1, value, mask);
+            }
+            if (r != 0) {
+                return send_packet(sock, "4e65656473206f6e6520616c69676e656420312c2032206f7220342062797465207761746368706f696e740a");  /* "Needs one aligned 1, 2 or 4 byte watchpoint\n" */
+            }
+            return send_packet(sock, "4f4b0a");  /* "OK\n" */
+        }
+        else if (strncmp(cmd_buf, "coredump", 8) == 0) {
+            /* Post-mortem core for m68k-elf-gdb:
+             *   monitor coredump <file> [periph]
+             */
+            char path[200];
+            char periph[16] = "";
+            double ms = 0;
+            if (sscanf(cmd_buf + 8, "%199s %15s", path, periph) < 1) {
+                return send_packet(sock, "55736167653a20636f726564756d70203c66696c653e205b7065726970685d0a");  /* "Usage: coredump <file> [periph]\n" */
+            }
+            char msg[256];
+            if (do_coredump(path, strcmp(periph, "periph") == 0, &ms) == 0) {
+                snprintf(msg, sizeof(msg), "Core written to %s in %.0f ms\n", path, ms);
+            } else {
+                snprintf(msg, sizeof(msg), "Core dump failed, see server log\n");
+            }
+            char reply[sizeof(msg) * 2 + 1];
+            bytes_to_hex((const uint8_t *)msg, strlen(msg), reply);
+            return send_packet(sock, reply);
+        }
+        else if (strncmp(cmd_buf, "snapshot", 8) == 0) {
+            /* Test fixture reset without reflashing:
+             *   monitor snapshot save <slot>
+             *   monitor snapshot restore <slot>
+             */
+            char op[16];
+            int slot;
+            double ms = 0;
+            char msg[128];
+            if (sscanf(cmd_buf + 8, "%15s %d", op, &slot) != 2 || slot < 0 || slot >= SNAPSHOT_SLOTS ||
+                (strcmp(op, "save") != 0 && strcmp(op, "restore") != 0)) {
+                snprintf(msg, sizeof(msg), "Usage: snapshot save|restore <0-%d>\n", SNAPSHOT_SLOTS - 1);
+            } else if (strcmp(op, "save") == 0) {
+                if (snapshot_save(slot, &ms) == 0) {
+                    snprintf(msg, sizeof(msg), "Saved slot %d in %.0f ms\n", slot, ms);
+                } else {
+                    snprintf(msg, sizeof(msg), "Snapshot failed, see server log\n");
+                }
+            } else {
+                int pages = snapshot_restore(slot, &ms);
+                if (pages >= 0) {
+                    snprintf(msg, sizeof(msg), "Restored slot %d (%d pages) in %.0f ms\n", slot, pages, ms);
+                } else {
+                    snprintf(msg, sizeof(msg), "Restore failed, see server log\n");
+                }
+            }
+            char reply[sizeof(msg) * 2 + 1];
+            bytes_to_hex((const uint8_t *)msg, strlen(msg), reply);
+            return send_packet(sock, reply);
+        }
+        else if (strncmp(cmd_buf, "profile", 7) == 0) {
+            /* PC sampling while the target runs:
+             *   monitor profile start [rate] [depth]
+             *   monitor profile stop [prefix]      writes <prefix>.txt/.folded
+             */
+            char op[16] = "";
+            char arg[200] = "";
+            int depth = PROFILE_DEPTH_DEFAULT;
+            char msg[2048];
+            sscanf(cmd_buf + 7, "%15s %199s %d", op, arg, &depth);
+            if (strcmp(op, "start") == 0) {
+                int rate = arg[0] ? atoi(arg) : PROFILE_RATE_DEFAULT;
+                if (g_symbols.count == 0) {
+                    snprintf(msg, sizeof(msg), "Profiling needs --symbols <elf>\n");
+                } else if (rate <= 0 || rate > PROFILE_RATE_MAX || depth < 0 || depth >= PROFILE_MAX_DEPTH) {
+                    snprintf(msg, sizeof(msg), "Rate must be 1-%d Hz, depth 0-%d\n",
+                             PROFILE_RATE_MAX, PROFILE_MAX_DEPTH - 1);
+                } else if (profile_start(rate, depth) != 0) {
+                    snprintf(msg, sizeof(msg), "Out of memory\n");
+                } else {
+                    snprintf(msg, sizeof(msg), "Profiling at %d Hz, depth %d; samples are taken while the target runs\n",
+                             rate, depth);
+                }
+            } else if (strcmp(op, "stop") == 0) {
+                const char *prefix = arg[0] ? arg : "profile";
+                char summary[1600];
+                if (!g_profile.active) {
+                    snprintf(msg, sizeof(msg), "Profiler is not running\n");
+                } else if (profile_stop(prefix, summary, sizeof(summary)) == 0) {
+                    snprintf(msg, sizeof(msg), "%sWrote %s.txt and %s.folded\n", summary, prefix, prefix);
+                } else {
+                    snprintf(msg, sizeof(msg), "%s", summary);
+                }
+            } else {
+                snprintf(msg, sizeof(msg), "Usage: profile start [rate] [depth] | profile stop [prefix]\n");
+            }
+            log_write_lines(LOG_TOOL, LOG_LEVEL_INFO, msg);
+            char reply[sizeof(msg) * 2 + 1];
+            bytes_to_hex((const uint8_t *)msg, strlen(msg), reply);
+            return send_packet(sock, reply);
+        }
         else {
             /* Unknown command */
             printf("Unknown monitor command: %s\n", cmd_buf);
@@ -1862,6 +3429,7 @@ static int handle_v_command(int sock, const char *data, int data_len) {
         /* Reinitialize target for debugging */
         uint32_t flash_size = 0;
         target_init_full(g_usb_dev, &flash_size);
+        invalidate_halt_state();
 
         printf("vFlashDone: Complete, target reinitialized\n");
         return send_ok(sock);
@@ -1894,51 +3462,64 @@ static int handle_set_breakpoint(int sock, const char *data) {
     char *kind_str = NULL;
     uint32_t addr = strtoul(addr_str, &kind_str, 16);
     uint32_t kind = 4;  /* Default to 4 bytes */
+    char *cond_str = NULL;
     if (kind_str && *kind_str == ',') {
-        kind = strtoul(kind_str + 1, NULL, 16);
+        kind = strtoul(kind_str + 1, &cond_str, 16);
     }
 
-    printf("Set breakpoint type %d at 0x%08X (kind=%u)\n", type, addr, kind);
+    LOG_DEBUG(LOG_RUN, "Set breakpoint type %d at 0x%08X (kind=%u)\n", type, addr, kind);
+
+    /* Conditions: a new Z0/Z1 replaces the breakpoint's list, a Z2-Z4
+     * comes with its watchpoint's
+     */
+    bp_cond_t *conds = NULL;
+    if (parse_conditions(cond_str, &conds) != 0) {
+        return send_error(sock, 1);
+    }
 
     switch (type) {
         case 0:
-            /* Software breakpoint - use hardware if available, fall back to software */
-            /* Try hardware first (faster, doesn't modify memory) */
-            if (set_hw_breakpoint(addr) >= 0) {
-                return send_ok(sock);
-            }
-            /* Fall back to software breakpoint */
-            if (set_sw_breakpoint(addr) == 0) {
-                return send_ok(sock);
-            }
-            return send_error(sock, 0x0E);  /* Resource busy */
-
         case 1:
-            /* Hardware execution breakpoint */
-            if (set_hw_breakpoint(addr) >= 0) {
+            /* Z0: software breakpoint - installed at resume time, in
+             * hardware if a PBR is free (faster, doesn't modify memory),
+             * otherwise as a HALT instruction.
+             * Z1: hardware execution breakpoint - installed at resume time.
+             */
+            if (request_breakpoint(addr, type == 0 ? BP_WANT_SW : BP_WANT_HW) == 0) {
+                breakpoint_t *bp = find_breakpoint(addr);
+                free_conditions(bp->conds);
+                bp->conds = conds;
+                if (conds) {
+                    LOG_INFO(LOG_RUN, "Breakpoint at 0x%08X is conditional\n", addr);
+                }
                 return send_ok(sock);
             }
+            free_conditions(conds);
             return send_error(sock, 0x0E);  /* Resource busy */
 
         case 2:  /* Write watchpoint */
-            if (set_watchpoint(addr, kind, WP_TYPE_WRITE) == 0) {
+            if (set_watchpoint(addr, kind, WP_TYPE_WRITE, conds) == 0) {
                 return send_ok(sock);
             }
+            free_conditions(conds);
             return send_error(sock, 0x0E);  /* Resource busy */
 
         case 3:  /* Read watchpoint */
-            if (set_watchpoint(addr, kind, WP_TYPE_READ) == 0) {
+            if (set_watchpoint(addr, kind, WP_TYPE_READ, conds) == 0) {
                 return send_ok(sock);
             }
+            free_conditions(conds);
             return send_error(sock, 0x0E);  /* Resource busy */
 
         case 4:  /* Access watchpoint (read or write) */
-            if (set_watchpoint(addr, kind, WP_TYPE_ACCESS) == 0) {
+            if (set_watchpoint(addr, kind, WP_TYPE_ACCESS, conds) == 0) {
                 return send_ok(sock);
             }
+            free_conditions(conds);
             return send_error(sock, 0x0E);  /* Resource busy */
 
         default:
+            free_conditions(conds);
             return send_error(sock, 1);
     }
 }
@@ -1964,23 +3545,19 @@ static int handle_remove_breakpoint(int sock, const char *data) {
         kind = strtoul(kind_str + 1, NULL, 16);
     }
 
-    printf("Remove breakpoint type %d at 0x%08X (kind=%u)\n", type, addr, kind);
+    LOG_DEBUG(LOG_RUN, "Remove breakpoint type %d at 0x%08X (kind=%u)\n", type, addr, kind);
 
     switch (type) {
         case 0:
-            /* Could be hardware or software - try both */
-            if (clear_hw_breakpoint(addr) == 0) {
-                return send_ok(sock);
-            }
-            if (clear_sw_breakpoint(addr) == 0) {
-                return send_ok(sock);
-            }
-            /* Breakpoint not found - still return OK per GDB spec */
+            /* Taken out of the target at the next resume.
+             * Breakpoint not found - still return OK per GDB spec
+             */
+            release_breakpoint(addr, BP_WANT_SW);
             return send_ok(sock);
 
         case 1:
             /* Hardware execution breakpoint */
-            clear_hw_breakpoint(addr);
+            release_breakpoint(addr, BP_WANT_HW);
             return send_ok(sock);
 
         case 2:  /* Write watchpoint */
@@ -2001,8 +3578,15 @@ static int handle_remove_breakpoint(int sock, const char *data) {
 }
 
 /* Process a single GDB RSP command */
-static int process_command(int sock, const char *cmd, int len) {
-    printf("RX: $%.*s#xx\n", len, cmd);
+static int process_command(int sock, char *cmd, int len) {
+    LOG_DEBUG(LOG_RSP, "RX: $%.*s#xx\n", len > 256 ? 256 : len, cmd);
+
+    /* Commands that may keep the target busy for a while are acked up
+     * front so GDB doesn't time out waiting for the '+'
+     */
+    if (cmd[0] == 'c' || cmd[0] == 's' || cmd[0] == 'v') {
+        send_pending_ack(sock);
+    }
 
     switch (cmd[0]) {
         case 'g':
@@ -2017,6 +3601,8 @@ static int process_command(int sock, const char *cmd, int len) {
             return handle_read_memory(sock, cmd + 1);
         case 'M':
             return handle_write_memory(sock, cmd + 1);
+        case 'X':
+            return handle_write_memory_binary(sock, cmd + 1, len - 1);
         case 'c':
             return handle_continue(sock, cmd + 1);
         case 's':
@@ -2028,7 +3614,14 @@ static int process_command(int sock, const char *cmd, int len) {
         case 'q':
             return handle_query(sock, cmd + 1);
         case 'Q':
-            /* Set commands - acknowledge but ignore for now */
+            if (strcmp(cmd, "QStartNoAckMode") == 0) {
+                /* The OK itself is still acked; after that no more acks */
+                int r = send_ok(sock);
+                g_noack_mode = 1;
+                LOG_DEBUG(LOG_RSP, "No-ack mode enabled\n");
+                return r;
+            }
+            /* Other set commands - acknowledge but ignore for now */
             return send_ok(sock);
         case 'v':
             return handle_v_command(sock, cmd + 1, len - 1);
@@ -2039,10 +3632,12 @@ static int process_command(int sock, const char *cmd, int len) {
         case 'k':
             /* Kill request */
             printf("Kill request received\n");
+            remove_all_breakpoints();
             return 0;
         case 'D':
             /* Detach */
             printf("Detach request received\n");
+            remove_all_breakpoints();
             return send_ok(sock);
         default:
             /* Unknown command - empty response */
@@ -2050,21 +3645,37 @@ static int process_command(int sock, const char *cmd, int len) {
     }
 }
 
-/* Main packet receive loop */
+/* Main packet receive loop
+ * Received bytes accumulate in a growable buffer. Each complete packet
+ * is dispatched in place: the '#' is replaced with a NUL and the handler
+ * gets a slice of the receive buffer, so nothing is copied. Unconsumed
+ * bytes are moved to the front once the buffer has been scanned.
+ */
 static int handle_client(int sock) {
-    char buffer[MAX_PACKET_SIZE];
-    int buf_pos = 0;
+    size_t capacity = RSP_RX_INITIAL;
+    char *buffer = malloc(capacity);
+    size_t buf_pos = 0;
 
-    while (g_running) {
-        /* Use select() with timeout to allow checking g_running */
-        fd_set readfds;
+    if (!buffer) {
+        LOG_ERROR(LOG_RSP, "Out of memory for the packet buffer\n");
+        return -1;
+    }
+
+    /* Every connection starts in ack mode */
+    g_noack_mode = 0;
+    g_ack_pending = 0;
+
+    while (g_running) {
+        /* Use select() with timeout to allow checking g_running */
+        fd_set readfds;
         struct timeval tv;
         FD_ZERO(&readfds);
         FD_SET(sock, &readfds);
+        int max_fd = live_watch_fdset(&readfds, sock);
         tv.tv_sec = 1;  /* 1 second timeout */
         tv.tv_usec = 0;
 
-        int sel = select(sock + 1, &readfds, NULL, NULL, &tv);
+        int sel = select(max_fd + 1, &readfds, NULL, NULL, &tv);
         if (sel < 0) {
             if (errno == EINTR) continue;  /* Signal interrupted, check g_running */
             perror("select");
@@ -2075,14 +3686,35 @@ static int handle_client(int sock) {
             continue;
         }
 
+        /* Live-watch client setting up between runs */
+        live_watch_service(&readfds);
+        if (!FD_ISSET(sock, &readfds)) {
+            continue;
+        }
+
+        /* Grow the buffer when a packet doesn't fit yet */
+        if (buf_pos == capacity) {
+            if (capacity >= RSP_RX_LIMIT) {
+                LOG_WARN(LOG_RSP, "Packet exceeds %d bytes, discarding\n", RSP_RX_LIMIT);
+                buf_pos = 0;
+            } else {
+                char *grown = realloc(buffer, capacity * 2);
+                if (!grown) {
+                    LOG_ERROR(LOG_RSP, "Out of memory for a %zu byte packet\n", capacity * 2);
+                    break;
+                }
+                buffer = grown;
+                capacity *= 2;
+            }
+        }
+
         /* Read data from socket */
-        int n = recv(sock, buffer + buf_pos, sizeof(buffer) - buf_pos - 1, 0);
+        ssize_t n = recv(sock, buffer + buf_pos, capacity - buf_pos, 0);
         if (n <= 0) {
             if (n < 0 && errno != EINTR) perror("recv");
             break;
         }
         buf_pos += n;
-        buffer[buf_pos] = '\0';  /* For string operations on non-binary parts */
 
         /* Process complete packets */
         char *ptr = buffer;
@@ -2091,6 +3723,7 @@ static int handle_client(int sock) {
             /* Handle interrupt character (Ctrl-C) */
             if (*ptr == 0x03) {
                 printf("Interrupt received\n");
+                invalidate_halt_state();
                 g_target_halted = 1;
                 send_packet(sock, "S02");  /* SIGINT */
                 ptr++;
@@ -2115,42 +3748,47 @@ static int handle_client(int sock) {
             }
 
             /* Find packet end - use memchr for binary safety */
-            size_t remaining_bytes = buf_end - ptr - 1;
-            char *end = memchr(ptr + 1, '#', remaining_bytes);
-            if (!end || (end - buffer + 2) > buf_pos) {
+            char *end = memchr(ptr + 1, '#', buf_end - ptr - 1);
+            if (!end || end + 3 > buf_end) {
                 /* Incomplete packet - wait for more data */
                 break;
             }
 
-            /* Extract command */
-            int cmd_len = end - ptr - 1;
-            char cmd[MAX_PACKET_SIZE];
-            memcpy(cmd, ptr + 1, cmd_len);
-            cmd[cmd_len] = '\0';
+            /* Command is the slice between '$' and '#' */
+            char *cmd = ptr + 1;
+            int cmd_len = end - cmd;
 
             /* Verify checksum */
             uint8_t recv_cksum = (hex_to_nibble(end[1]) << 4) | hex_to_nibble(end[2]);
             uint8_t calc_cksum = calc_checksum(cmd, cmd_len);
 
-            if (recv_cksum != calc_cksum) {
+            if (g_noack_mode) {
+                /* Reliable transport - checksums are not verified */
+                *end = '\0';
+                process_command(sock, cmd, cmd_len);
+            } else if (recv_cksum != calc_cksum) {
                 printf("Checksum mismatch: recv=%02x calc=%02x\n", recv_cksum, calc_cksum);
                 send(sock, "-", 1, 0);  /* NACK */
             } else {
-                send(sock, "+", 1, 0);  /* ACK */
+                /* ACK goes out with the reply (see rsp_begin()) */
+                g_ack_pending = 1;
+                *end = '\0';  /* For string operations on non-binary parts */
                 process_command(sock, cmd, cmd_len);
+                send_pending_ack(sock);  /* Commands without a reply */
             }
 
             ptr = end + 3;
         }
 
         /* Move remaining data to start of buffer */
-        int remaining = buf_pos - (ptr - buffer);
-        if (remaining > 0) {
+        size_t remaining = buf_end - ptr;
+        if (remaining > 0 && ptr != buffer) {
             memmove(buffer, ptr, remaining);
         }
         buf_pos = remaining;
     }
 
+    free(buffer);
     return 0;
 }
 
@@ -2182,26 +3820,37 @@ static int init_usb(void) {
     return 0;
 }
 
-/* Initialize target MCU via BDM */
-static int init_target(void) {
+/* Initialize target MCU via BDM
+ * full = 0 reattaches to an already halted and configured target if possible;
+ * full = 1 always runs the complete sequence (e.g. after the flashloader ran)
+ */
+static int init_target(int full) {
     printf("Initializing target...\n");
 
     uint32_t flash_size = 0;
-    int r = target_init_full(g_usb_dev, &flash_size);
+    int r = full ? target_init_full(g_usb_dev, &flash_size)
+                 : target_attach(g_usb_dev, &flash_size);
     if (r != 0) {
         fprintf(stderr, "Failed to initialize target\n");
         return -1;
     }
 
+    /* Possibly a different board or a reflashed one: nothing cached from
+     * before the (re)attach is valid
+     */
+    invalidate_halt_state();
+    flash_cache_invalidate(0, 0);
+
     /* Initialize breakpoint tracking */
-    init_sw_breakpoints();
+    init_breakpoints();
 
     /* Initialize watchpoint tracking */
     init_watchpoints();
 
-    /* Clear any existing hardware breakpoints */
+    /* Clear any existing hardware breakpoints; PBR0 is compared in full */
+    write_data_breakpoint_reg(DEBUG_REG_PBMR, 0);
     for (int i = 0; i < MAX_HW_BREAKPOINTS; i++) {
-        write_pbr(i, 0);
+        disable_pbr(i);
         hw_breakpoints[i] = 0;
         hw_breakpoint_used[i] = 0;
     }
@@ -2213,155 +3862,1380 @@ static int init_target(void) {
     /* Clear TDR to disable all triggers */
     write_tdr(0);
 
-    printf("Target initialized (flash size: %u KB)\n", flash_size);
-    printf("Hardware breakpoints: %d available\n", MAX_HW_BREAKPOINTS);
-    printf("Software breakpoints: %d available\n", MAX_SW_BREAKPOINTS);
-    printf("Watchpoints: %d available\n", MAX_WATCHPOINTS);
-    return 0;
-}
+    printf("Target initialized (flash size: %u KB)\n", flash_size);
+    printf("Hardware breakpoints: %d available\n", MAX_HW_BREAKPOINTS);
+    printf("Software breakpoints: unlimited\n");
+    printf("Watchpoints: %d available\n", MAX_WATCHPOINTS);
+    return 0;
+}
+
+/* Cleanup */
+static void cleanup(void) {
+    if (g_client_socket >= 0) {
+        close(g_client_socket);
+    }
+    if (g_server_socket >= 0) {
+        close(g_server_socket);
+    }
+    if (g_control_socket >= 0) {
+        close(g_control_socket);
+        unlink(g_control_path);
+    }
+    live_watch_close();
+    if (g_profile.active) {
+        profile_free(&g_profile.prof);
+        g_profile.active = 0;
+    }
+    symbol_table_free(&g_symbols);
+    if (g_usb_dev) {
+        libusb_release_interface(g_usb_dev, 0);
+        libusb_close(g_usb_dev);
+        libusb_exit(NULL);
+    }
+}
+
+static void print_usage(const char *prog) {
+    printf("OpenLink ColdFire GDB Server / Flash Programmer\n\n");
+    printf("Usage: %s [OPTIONS]\n\n", prog);
+    printf("Modes:\n");
+    printf("  --erase                Erase entire flash (256KB)\n");
+    printf("  --program <file>       Erase and program flash from file\n");
+    printf("                         Supports: .bin, .elf, .s19/.srec\n");
+    printf("  --gdb                  GDB server mode (default)\n");
+    printf("  --dump <addr> <len> <file>  Read memory to .bin, .srec/.s19 or .elf\n");
+    printf("  --coredump <file>      Write an ELF core (SRAM + registers) for m68k-elf-gdb\n");
+    printf("  --profile <elf>        Run the target and sample its PC; writes a flat profile\n");
+    printf("                         and a folded-stack file for flame graphs\n");
+    printf("  --daemon               GDB server that also serves --erase/--program/--dump\n");
+    printf("                         requests, keeping the target initialized\n");
+    printf("  --script <file>        Run a batch of operations in one session (- = stdin):\n");
+    printf("                         erase, program, write, fill, read, verify, crc, run;\n");
+    printf("                         one JSON line per step on stdout\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -p, --port <port>      TCP port for GDB (default: %d)\n", DEFAULT_PORT);
+    printf("  --socket <path>        Daemon control socket (default: %s)\n", DEFAULT_CONTROL_SOCKET);
+    printf("  -f, --flashloader <path>  Path to flashloader.elf\n");
+    printf("  -v, --verify           Verify after programming\n");
+    printf("  --base <addr>          Base address for .bin files (default: 0x00000000)\n");
+    printf("  --periph               --coredump: also save the peripheral register blocks\n");
+    printf("  --live-port <port>     Stream variables sampled while the target runs\n");
+    printf("  --symbols <elf>        Firmware ELF for live-watch and monitor profile symbols\n");
+    printf("  --profile-time <s>     --profile: seconds to sample (default 10)\n");
+    printf("  --profile-rate <hz>    Samples per second (default %d, max %d)\n",
+           PROFILE_RATE_DEFAULT, PROFILE_RATE_MAX);
+    printf("  --profile-depth <n>    Callers recorded per sample (default %d)\n", PROFILE_DEPTH_DEFAULT);
+    printf("  --profile-out <prefix> Output files <prefix>.txt/.folded (default profile)\n");
+    printf("  --log <spec>           Log levels, e.g. debug or rsp=debug,flash=warn\n");
+    printf("                         (categories: rsp usb flash run tool; levels: off error warn info debug)\n");
+    printf("  --patch <addr>         Program a per-board record at addr on top of the\n");
+    printf("                         --program image; only differing sectors are rewritten\n");
+    printf("  --patch-format <list>  Record fields: u8 u16 u32 strN hexN padN\n");
+    printf("  --patch-csv <file>     Record values, one line per board\n");
+    printf("  --patch-counter <n>    First value is a counter starting at n\n");
+    printf("  --patch-state <file>   Keep the board index across runs\n");
+    printf("  --boards <n>           Boards to program, prompting between them (0 = until\n");
+    printf("                         the CSV runs out; default 1)\n");
+    printf("  --init-seq <file>      Replace the SRAM init command tables from a file\n");
+    printf("  --init-seq-dump        Print the init command tables and exit\n");
+    printf("  -h, --help             Show this help\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  %s --erase                       Erase entire flash\n", prog);
+    printf("  %s --program firmware.bin        Program binary file\n", prog);
+    printf("  %s --program firmware.elf -v     Program ELF with verify\n", prog);
+    printf("  %s -p 3333                       Start GDB server\n", prog);
+    printf("  %s --gdb                         Start GDB server\n", prog);
+    printf("  %s --daemon                      Start daemon; later --erase/--program\n", prog);
+    printf("                                   runs use it instead of the probe\n");
+    printf("  %s --dump 0 0x40000 flash.srec  Read back the whole flash\n", prog);
+    printf("  %s --script line.txt > steps.jsonl  Production sequence with timing\n", prog);
+    printf("  %s --coredump crash.core --periph  Save the target for post-mortem debugging\n", prog);
+    printf("  %s --profile firmware.elf        Where does the firmware spend its time?\n", prog);
+}
+
+/* Mode 1: Erase only */
+static int do_erase_only(void) {
+    gpl_flash_state_t flash;
+    int ret = -1;
+
+    printf("\n");
+    printf("==============================================\n");
+    printf("  Erasing entire flash (256KB)\n");
+    printf("==============================================\n\n");
+
+    if (gpl_flash_init(&flash, g_usb_dev, NULL) != 0) {
+        fprintf(stderr, "Failed to initialize flashloader\n");
+        return -1;
+    }
+
+    if (gpl_flash_mass_erase(&flash) != 0) {
+        fprintf(stderr, "Mass erase failed\n");
+        goto cleanup;
+    }
+
+    printf("\n");
+    printf("==============================================\n");
+    printf("  Flash erased successfully!\n");
+    printf("==============================================\n");
+    ret = 0;
+
+cleanup:
+    gpl_flash_cleanup(&flash);
+    return ret;
+}
+
+/* Mode 2: Program file */
+static int do_program_file(const char *filename, uint32_t base_addr, int verify) {
+    gpl_flash_state_t flash;
+    loaded_file_t file;
+    int ret = -1;
+
+    printf("\n");
+    printf("==============================================\n");
+    printf("  Programming %s\n", filename);
+    printf("==============================================\n\n");
+
+    /* Load file */
+    if (file_load(filename, base_addr, &file) != 0) {
+        fprintf(stderr, "Failed to load file '%s'\n", filename);
+        return -1;
+    }
+
+    file_print_info(&file);
+    printf("\n");
+
+    /* Check flash bounds */
+    if (file.max_addr > FLASH_SIZE) {
+        fprintf(stderr, "Error: File extends beyond flash (0x%08X > 0x%08X)\n",
+                file.max_addr, FLASH_SIZE);
+        file_free(&file);
+        return -1;
+    }
+
+    /* Initialize flashloader */
+    if (gpl_flash_init(&flash, g_usb_dev, NULL) != 0) {
+        fprintf(stderr, "Failed to initialize flashloader\n");
+        file_free(&file);
+        return -1;
+    }
+
+    /* Get contiguous data */
+    uint8_t *data;
+    uint32_t data_addr, data_size;
+    if (file_get_contiguous(&file, &data_addr, &data, &data_size) != 0) {
+        fprintf(stderr, "Failed to get contiguous data\n");
+        goto cleanup;
+    }
+
+    /* Program with optional verify */
+    int r = gpl_flash_program_binary(&flash, data, data_size, data_addr, verify);
+    free(data);
+
+    if (r != 0) {
+        fprintf(stderr, "Programming failed\n");
+        goto cleanup;
+    }
+
+    printf("\n");
+    printf("==============================================\n");
+    printf("  Programming complete!\n");
+    if (file.entry_point != 0) {
+        printf("  Entry point: 0x%08X\n", file.entry_point);
+    }
+    printf("==============================================\n");
+    ret = 0;
+
+cleanup:
+    gpl_flash_cleanup(&flash);
+    file_free(&file);
+    return ret;
+}
+
+/*
+ * Mode 3: Batch script
+ * Runs a list of operations in one session: the target is initialized once
+ * and the flashloader stays resident across consecutive flash steps. Each
+ * step is reported as one JSON line on stdout; all other output goes to
+ * stderr so the report can be piped straight into a log collector.
+ *
+ * Script format, one operation per line, '#' starts a comment:
+ *   erase [<addr> <len>]           Mass erase, or the sectors covering a range
+ *   program <file> [<base>]        Erase and program .bin/.elf/.s19
+ *   write <addr> <hexbytes>        Write bytes (flash must be erased)
+ *   fill <addr> <len> <byte>       Fill a range (flash must be erased)
+ *   read <addr> <len> <file>       Save memory to a raw binary file
+ *   verify <file> [<base>]         Compare memory with a file
+ *   crc <addr> <len>               CRC-32 of a range (same as GDB's compare-sections)
+ *   run [<pc>]                     Start the target, from the reset vector by default
+ */
+#define SCRIPT_LINE_MAX     1024
+#define SCRIPT_MAX_ARGS     8
+#define SCRIPT_WRITE_MAX    256     /* Bytes in one 'write' */
+
+static FILE *g_script_report = NULL;    /* JSON lines, the original stdout */
+
+static double script_elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 +
+           (now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+/* One report line; 'extra' holds op-specific ",\"key\":value" fields */
+static void script_report(int step, int line, const char *op, double ms,
+                          const char *extra, const char *error) {
+    if (!g_script_report) {
+        return;
+    }
+    fprintf(g_script_report, "{\"step\":%d,\"line\":%d,\"op\":\"%s\",\"status\":\"%s\",\"ms\":%.1f%s",
+            step, line, op, error ? "error" : "ok", ms, extra);
+    if (error) {
+        fprintf(g_script_report, ",\"error\":\"%s\"", error);
+    }
+    fprintf(g_script_report, "}\n");
+}
+
+static int script_parse_u32(const char *s, uint32_t *value) {
+    char *end;
+    unsigned long v = strtoul(s, &end, 0);
+    if (*s == '\0' || *end != '\0' || v > 0xFFFFFFFFUL) {
+        return -1;
+    }
+    *value = v;
+    return 0;
+}
+
+/* Stop the target if an earlier 'run' started it */
+static void script_halt(void) {
+    if (g_target_halted) {
+        return;
+    }
+    target_halt(g_usb_dev);
+    invalidate_halt_state();
+    g_target_halted = 1;
+}
+
+/* Take the target back from the flashloader before CPU or RAM access */
+static int script_target_ready(void) {
+    script_halt();
+    if (flash_state.initialized) {
+        flash_reset_state();
+        if (init_target(1) != 0) {
+            return -1;
+        }
+        invalidate_halt_state();
+    }
+    return 0;
+}
+
+/* Program erased flash; the flashloader wants longword-aligned data, so the
+ * edges are padded with 0xFF, which leaves the neighbouring bytes as they are
+ */
+static int script_flash_write(uint32_t addr, const uint8_t *data, uint32_t len) {
+    uint32_t start = addr & ~3u;
+    uint32_t end = (addr + len + 3) & ~3u;
+
+    uint8_t *buf = malloc(end - start);
+    if (!buf) {
+        return -1;
+    }
+    memset(buf, 0xFF, end - start);
+    memcpy(buf + (addr - start), data, len);
+
+    script_halt();
+    int r = flash_program_region(start, buf, end - start);
+    free(buf);
+    return r;
+}
+
+/* Store bytes anywhere: flash through the flashloader, RAM over BDM */
+static int script_store(uint32_t addr, const uint8_t *data, uint32_t len, const char **error) {
+    if (addr < FLASH_BASE + FLASH_SIZE) {
+        if (addr + len > FLASH_BASE + FLASH_SIZE) {
+            *error = "range crosses the end of flash";
+            return -1;
+        }
+        if (script_flash_write(addr, data, len) != 0) {
+            *error = "flash program failed";
+            return -1;
+        }
+        return 0;
+    }
+    if (script_target_ready() != 0 || write_target_memory(addr, data, len) != 0) {
+        *error = "memory write failed";
+        return -1;
+    }
+    return 0;
+}
+
+/* Load a file the same way --program does; caller frees *data */
+static int script_load_file(const char *path, const char *base, uint32_t *addr,
+                            uint8_t **data, uint32_t *size, const char **error) {
+    uint32_t base_addr = 0;
+    if (base && script_parse_u32(base, &base_addr) != 0) {
+        *error = "bad base address";
+        return -1;
+    }
+
+    loaded_file_t file;
+    if (file_load(path, base_addr, &file) != 0) {
+        *error = "cannot load file";
+        return -1;
+    }
+    int r = file_get_contiguous(&file, addr, data, size);
+    file_free(&file);
+    if (r != 0) {
+        *error = "cannot load file";
+        return -1;
+    }
+    return 0;
+}
+
+static int script_erase(int argc, char **argv, char *extra, size_t extra_size, const char **error) {
+    (void)extra; (void)extra_size;
+    script_halt();
+
+    if (argc == 1) {
+        if (flash_init_loader() != 0 || gpl_flash_mass_erase(&flash_state.gpl_state) != 0) {
+            flash_cache_invalidate(FLASH_BASE, FLASH_SIZE);
+            *error = "mass erase failed";
+            return -1;
+        }
+        flash_cache_erased(FLASH_BASE, FLASH_SIZE);
+        invalidate_halt_state();
+        return 0;
+    }
+
+    uint32_t addr, len;
+    if (argc != 3 || script_parse_u32(argv[1], &addr) != 0 || script_parse_u32(argv[2], &len) != 0) {
+        *error = "usage: erase [<addr> <len>]";
+        return -1;
+    }
+    if (flash_erase_region(addr, len) != 0) {
+        *error = "erase failed";
+        return -1;
+    }
+    return 0;
+}
+
+static int script_program(int argc, char **argv, char *extra, size_t extra_size, const char **error) {
+    uint8_t *data;
+    uint32_t addr, size;
+
+    if (script_load_file(argv[1], argc > 2 ? argv[2] : NULL, &addr, &data, &size, error) != 0) {
+        return -1;
+    }
+    if (addr + size > FLASH_BASE + FLASH_SIZE) {
+        *error = "file extends beyond flash";
+        free(data);
+        return -1;
+    }
+
+    script_halt();
+    int r = flash_erase_region(addr, size);
+    if (r == 0) {
+        r = script_flash_write(addr, data, size);
+    }
+    free(data);
+    if (r != 0) {
+        *error = "program failed";
+        return -1;
+    }
+    snprintf(extra, extra_size, ",\"addr\":%u,\"bytes\":%u", addr, size);
+    return 0;
+}
+
+static int script_write(int argc, char **argv, char *extra, size_t extra_size, const char **error) {
+    (void)argc; (void)extra; (void)extra_size;
+    uint8_t data[SCRIPT_WRITE_MAX];
+    uint32_t addr;
+
+    size_t digits = strlen(argv[2]);
+    if (script_parse_u32(argv[1], &addr) != 0 || digits == 0 || (digits & 1) ||
+        digits / 2 > sizeof(data) ||
+        hex_to_bytes(argv[2], data, sizeof(data)) != (int)(digits / 2)) {
+        *error = "usage: write <addr> <hexbytes>";
+        return -1;
+    }
+    return script_store(addr, data, digits / 2, error);
+}
+
+static int script_fill(int argc, char **argv, char *extra, size_t extra_size, const char **error) {
+    (void)argc; (void)extra; (void)extra_size;
+    uint32_t addr, len, value;
+
+    if (script_parse_u32(argv[1], &addr) != 0 || script_parse_u32(argv[2], &len) != 0 ||
+        script_parse_u32(argv[3], &value) != 0 || value > 0xFF || len == 0) {
+        *error = "usage: fill <addr> <len> <byte>";
+        return -1;
+    }
+
+    uint8_t *data = malloc(len);
+    if (!data) {
+        *error = "out of memory";
+        return -1;
+    }
+    memset(data, value, len);
+    int r = script_store(addr, data, len, error);
+    free(data);
+    return r;
+}
+
+static int script_read(int argc, char **argv, char *extra, size_t extra_size, const char **error) {
+    (void)argc;
+    uint32_t addr, len;
+
+    if (script_parse_u32(argv[1], &addr) != 0 || script_parse_u32(argv[2], &len) != 0 || len == 0) {
+        *error = "usage: read <addr> <len> <file>";
+        return -1;
+    }
+
+    uint8_t *data = malloc(len);
+    if (!data) {
+        *error = "out of memory";
+        return -1;
+    }
+
+    script_halt();
+    int r = -1;
+    if (read_target_direct(addr, data, len) != 0) {
+        *error = "memory read failed";
+    } else {
+        FILE *f = fopen(argv[3], "wb");
+        if (!f || fwrite(data, 1, len, f) != len) {
+            *error = "cannot write output file";
+        } else {
+            snprintf(extra, extra_size, ",\"bytes\":%u", len);
+            r = 0;
+        }
+        if (f && fclose(f) != 0 && r == 0) {
+            *error = "cannot write output file";
+            r = -1;
+        }
+    }
+    free(data);
+    return r;
+}
+
+static int script_verify(int argc, char **argv, char *extra, size_t extra_size, const char **error) {
+    uint8_t *data;
+    uint32_t addr, size;
+
+    if (script_load_file(argv[1], argc > 2 ? argv[2] : NULL, &addr, &data, &size, error) != 0) {
+        return -1;
+    }
+
+    /* Read the target itself, not the flash cache the programming updated */
+    uint8_t *actual = malloc(size);
+    int r = -1;
+    script_halt();
+    if (!actual || read_target_direct(addr, actual, size) != 0) {
+        *error = "memory read failed";
+    } else {
+        r = 0;
+        for (uint32_t i = 0; i < size; i++) {
+            if (actual[i] != data[i]) {
+                snprintf(extra, extra_size, ",\"mismatch\":%u", addr + i);
+                *error = "verify mismatch";
+                r = -1;
+                break;
+            }
+        }
+        if (r == 0) {
+            snprintf(extra, extra_size, ",\"bytes\":%u", size);
+        }
+    }
+    free(actual);
+    free(data);
+    return r;
+}
+
+static int script_crc(int argc, char **argv, char *extra, size_t extra_size, const char **error) {
+    (void)argc;
+    uint32_t addr, len;
+
+    if (script_parse_u32(argv[1], &addr) != 0 || script_parse_u32(argv[2], &len) != 0 || len == 0) {
+        *error = "usage: crc <addr> <len>";
+        return -1;
+    }
+
+    uint8_t *data = malloc(len);
+    if (!data) {
+        *error = "out of memory";
+        return -1;
+    }
+    script_halt();
+    int r = read_target_direct(addr, data, len);
+    if (r != 0) {
+        *error = "memory read failed";
+    } else {
+        snprintf(extra, extra_size, ",\"crc\":\"0x%08x\"", xcrc32(data, len, 0xFFFFFFFF));
+    }
+    free(data);
+    return r == 0 ? 0 : -1;
+}
+
+static int script_run(int argc, char **argv, char *extra, size_t extra_size, const char **error) {
+    uint32_t pc;
+
+    if (script_target_ready() != 0) {
+        *error = "target init failed";
+        return -1;
+    }
+
+    if (argc > 1) {
+        if (script_parse_u32(argv[1], &pc) != 0) {
+            *error = "usage: run [<pc>]";
+            return -1;
+        }
+    } else {
+        /* Initial SSP and PC from the vector table, as a reset would */
+        uint8_t vec[8];
+        if (read_target_direct(FLASH_BASE, vec, sizeof(vec)) != 0) {
+            *error = "cannot read reset vector";
+            return -1;
+        }
+        uint32_t sp = ((uint32_t)vec[0] << 24) | ((uint32_t)vec[1] << 16) | ((uint32_t)vec[2] << 8) | vec[3];
+        pc = ((uint32_t)vec[4] << 24) | ((uint32_t)vec[5] << 16) | ((uint32_t)vec[6] << 8) | vec[7];
+        if (write_cpu_register(REG_A7, sp) != 0) {
+            *error = "cannot set SP";
+            return -1;
+        }
+    }
+    if (write_cpu_register(REG_PC, pc) != 0) {
+        *error = "cannot set PC";
+        return -1;
+    }
+
+    cmd_enter_mode(g_usb_dev, 0xF8);
+    invalidate_halt_state();
+    if (cmd_07_02_bdm_go(g_usb_dev) != 0) {
+        *error = "BDM GO failed";
+        return -1;
+    }
+    g_target_halted = 0;
+    snprintf(extra, extra_size, ",\"pc\":%u", pc);
+    return 0;
+}
+
+typedef int (*script_op_fn)(int argc, char **argv, char *extra, size_t extra_size, const char **error);
+
+static const struct {
+    const char *name;
+    int min_args;           /* Including the operation name */
+    int max_args;
+    script_op_fn fn;
+} script_ops[] = {
+    { "erase",   1, 3, script_erase   },
+    { "program", 2, 3, script_program },
+    { "write",   3, 3, script_write   },
+    { "fill",    4, 4, script_fill    },
+    { "read",    4, 4, script_read    },
+    { "verify",  2, 3, script_verify  },
+    { "crc",     3, 3, script_crc     },
+    { "run",     1, 2, script_run     },
+};
+#define NUM_SCRIPT_OPS (sizeof(script_ops) / sizeof(script_ops[0]))
+
+/* Run a script file ("-" = stdin), stopping at the first failed step */
+static int do_script(const char *path) {
+    FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!in) {
+        LOG_ERROR(LOG_TOOL, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct timespec session_start;
+    clock_gettime(CLOCK_MONOTONIC, &session_start);
+
+    char line[SCRIPT_LINE_MAX];
+    int line_no = 0, step = 0, ret = 0;
+    while (ret == 0 && g_running && fgets(line, sizeof(line), in)) {
+        line_no++;
+
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+
+        char *argv[SCRIPT_MAX_ARGS + 1];
+        int argc = 0;
+        for (char *tok = strtok(line, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n")) {
+            if (argc == SCRIPT_MAX_ARGS) {
+                argc++;
+                break;
+            }
+            argv[argc++] = tok;
+        }
+        if (argc == 0) {
+            continue;
+        }
+        step++;
+
+        unsigned op = 0;
+        while (op < NUM_SCRIPT_OPS && strcmp(argv[0], script_ops[op].name) != 0) {
+            op++;
+        }
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        char extra[128] = "";
+        const char *error = NULL;
+
+        if (op == NUM_SCRIPT_OPS) {
+            error = "unknown operation";
+        } else if (argc < script_ops[op].min_args || argc > script_ops[op].max_args) {
+            error = "wrong number of arguments";
+        } else {
+            LOG_INFO(LOG_TOOL, "Script line %d: %s\n", line_no, argv[0]);
+            if (script_ops[op].fn(argc, argv, extra, sizeof(extra), &error) != 0 && !error) {
+                error = "failed";
+            }
+        }
+
+        script_report(step, line_no, op < NUM_SCRIPT_OPS ? script_ops[op].name : "unknown",
+                      script_elapsed_ms(&start), extra, error);
+        if (error) {
+            ret = -1;
+        }
+    }
+    if (ret == 0 && !g_running) {
+        ret = -1;
+    }
+
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    /* Leave the flash cleanly; a target started by 'run' keeps running */
+    if (flash_state.initialized) {
+        flash_reset_state();
+    }
+
+    char extra[64];
+    snprintf(extra, sizeof(extra), ",\"steps\":%d", step);
+    script_report(step + 1, line_no, "total", script_elapsed_ms(&session_start), extra,
+                  ret == 0 ? NULL : "script aborted");
+    return ret;
+}
+
+/* Mode 3: Dump memory to a file
+ * Streams the range through the largest read the probe supports straight
+ * into the output (.bin, .srec/.s19 or .elf by extension).
+ */
+static int do_dump(uint32_t addr, uint32_t length, const char *filename) {
+    file_writer_t w;
+    uint8_t *block;
+    uint32_t block_size = openlink_read_block_size(g_usb_dev);
+
+    if (length == 0 || addr + length < addr) {
+        LOG_ERROR(LOG_TOOL, "Invalid dump range 0x%08X+0x%X\n", addr, length);
+        return -1;
+    }
+
+    block = malloc(block_size);
+    if (!block) {
+        return -1;
+    }
+    if (file_writer_open(&w, filename, addr, length) != 0) {
+        free(block);
+        return -1;
+    }
+
+    LOG_INFO(LOG_TOOL, "Dumping 0x%08X-0x%08X (%u bytes) to %s\n", addr, addr + length, length, filename);
+
+    struct timespec start, last;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    last = start;
+
+    int ret = 0;
+    for (uint32_t done = 0; done < length && ret == 0; ) {
+        uint32_t n = length - done;
+        if (n > block_size) n = block_size;
+
+        if (read_target_direct(addr + done, block, n) != 0) {
+            LOG_ERROR(LOG_TOOL, "Dump: read failed at 0x%08X\n", addr + done);
+            ret = -1;
+        } else if (file_writer_write(&w, block, n) != 0) {
+            LOG_ERROR(LOG_TOOL, "Dump: write to %s failed\n", filename);
+            ret = -1;
+        }
+        done += n;
+
+        /* Progress about once a second */
+        if (ret == 0 && done < length && script_elapsed_ms(&last) >= 1000.0) {
+            double ms = script_elapsed_ms(&start);
+            LOG_INFO(LOG_TOOL, "  %u/%u KB  %.1f KB/s\n", done / 1024, length / 1024,
+                     ms > 0 ? done / 1024.0 / (ms / 1000.0) : 0.0);
+            clock_gettime(CLOCK_MONOTONIC, &last);
+        }
+    }
+
+    if (file_writer_close(&w) != 0) {
+        ret = -1;
+    }
+    free(block);
+
+    if (ret == 0) {
+        double ms = script_elapsed_ms(&start);
+        LOG_INFO(LOG_TOOL, "Dump complete: %u bytes in %.0f ms (%.1f KB/s)\n", length, ms,
+                 ms > 0 ? length / 1024.0 / (ms / 1000.0) : 0.0);
+    } else {
+        unlink(filename);
+    }
+    return ret;
+}
+
+/* Peripheral blocks saved by "coredump ... periph", as IPSBAR offsets.
+ * Only registers that read without side effects: the UART, QSPI and I2C
+ * data registers are left out, and the INTC blocks stop before the IACK
+ * registers, whose reads acknowledge an interrupt.
+ */
+static const struct {
+    uint32_t offset;
+    uint32_t size;
+} core_periph[] = {
+    { 0x000000, 0x40 },     /* SCM */
+    { 0x000400, 0x100 },    /* DTIM0-3 */
+    { 0x000C00, 0xE0 },     /* INTC0 */
+    { 0x000D00, 0xE0 },     /* INTC1 */
+    { 0x100000, 0x80 },     /* GPIO */
+    { 0x110000, 0x10 },     /* Reset/CIM */
+    { 0x120000, 0x10 },     /* Clock */
+    { 0x130000, 0x10 },     /* EPORT0 */
+    { 0x150000, 0x10 },     /* PIT0 */
+    { 0x160000, 0x10 },     /* PIT1 */
+    { 0x1A0000, 0x20 },     /* GPT */
+    { 0x1D0000, 0x30 },     /* CFM */
+};
+#define CORE_PERIPH_COUNT   (int)(sizeof(core_periph) / sizeof(core_periph[0]))
+
+/* Control registers saved in the "OPENLINK" note as (number, value) pairs */
+static const uint16_t core_ctrl_regs[] = {
+    0x0800,     /* OTHER_A7 */
+    0x0801,     /* VBR */
+    0x0804,     /* MACSR */
+    0x0805,     /* MASK */
+    0x0806,     /* ACC0 */
+    0x0C04,     /* FLASHBAR */
+    0x0C05,     /* RAMBAR */
+};
+#define CORE_CTRL_COUNT     (int)(sizeof(core_ctrl_regs) / sizeof(core_ctrl_regs[0]))
+
+/* Linux/m68k elf_prstatus: 154 bytes, pr_reg (20 longwords) at offset 70 */
+#define PRSTATUS_SIZE       154
+#define PRSTATUS_REG_OFF    70
+
+static void put_be32(uint8_t *p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+/* Write a post-mortem core of the halted target
+ * SRAM and the CPU registers always, the peripheral blocks on request.
+ * The registers go into an NT_PRSTATUS note in the Linux/m68k layout,
+ * which is what GDB's m68k core support reads:
+ *   m68k-elf-gdb firmware.elf core.elf
+ * Memory is fetched with one bulk read per region.
+ */
+static int do_coredump(const char *filename, int with_periph, double *elapsed_ms) {
+    static uint8_t sram[SRAM_SIZE];
+    uint8_t *periph = NULL;
+    core_region_t regions[1 + CORE_PERIPH_COUNT];
+    int num_regions = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (flash_state.initialized) {
+        LOG_ERROR(LOG_TOOL, "Core dump: SRAM holds the flashloader, reset the target first\n");
+        return -1;
+    }
+    if (!g_target_halted) {
+        target_halt(g_usb_dev);
+        invalidate_halt_state();
+        g_target_halted = 1;
+    }
+
+    /* CPU registers */
+    uint32_t regs[NUM_REGISTERS];
+    for (int i = 0; i < NUM_REGISTERS; i++) {
+        read_cpu_register(i, &regs[i]);
+    }
+
+    uint8_t prstatus[PRSTATUS_SIZE] = { 0 };
+    prstatus[13] = 5;                       /* pr_cursig = SIGTRAP */
+    put_be32(prstatus + 22, 1);             /* pr_pid */
+    uint8_t *pr_reg = prstatus + PRSTATUS_REG_OFF;
+    for (int i = 1; i <= 7; i++) {
+        put_be32(pr_reg + (i - 1) * 4, regs[REG_D0 + i]);      /* d1-d7 */
+    }
+    for (int i = 0; i <= 6; i++) {
+        put_be32(pr_reg + (7 + i) * 4, regs[REG_A0 + i]);      /* a0-a6 */
+    }
+    put_be32(pr_reg + 14 * 4, regs[REG_D0]);
+    put_be32(pr_reg + 15 * 4, regs[REG_A7]);                   /* usp slot = active SP */
+    put_be32(pr_reg + 16 * 4, 0xFFFFFFFF);                     /* orig_d0 */
+    put_be32(pr_reg + 17 * 4, regs[REG_SR] & 0xFFFF);          /* stkadj:sr */
+    put_be32(pr_reg + 18 * 4, regs[REG_PC]);
+
+    uint8_t ctrl[CORE_CTRL_COUNT * 8];
+    uint32_t ctrl_size = 0;
+    for (int i = 0; i < CORE_CTRL_COUNT; i++) {
+        uint32_t value;
+        if (cmd_07_11_read_bdm_reg(g_usb_dev, 0x2980, core_ctrl_regs[i], &value) == 0) {
+            put_be32(ctrl + ctrl_size, core_ctrl_regs[i]);
+            put_be32(ctrl + ctrl_size + 4, value);
+            ctrl_size += 8;
+        }
+    }
+
+    /* Memory */
+    if (read_target_direct(SRAM_BASE, sram, SRAM_SIZE) != 0) {
+        LOG_ERROR(LOG_TOOL, "Core dump: SRAM read failed\n");
+        return -1;
+    }
+    /* Original instructions, not the HALTs of inserted breakpoints */
+    breakpoint_shadow_read(SRAM_BASE, sram, SRAM_SIZE);
+    regions[num_regions++] = (core_region_t){ SRAM_BASE, SRAM_SIZE, sram };
+
+    if (with_periph) {
+        uint32_t total = 0;
+        for (int i = 0; i < CORE_PERIPH_COUNT; i++) {
+            total += core_periph[i].size;
+        }
+        periph = malloc(total);
+        if (!periph) {
+            return -1;
+        }
+        uint8_t *p = periph;
+        for (int i = 0; i < CORE_PERIPH_COUNT; i++) {
+            uint32_t addr = IPSBAR_BASE + core_periph[i].offset;
+            if (read_target_direct(addr, p, core_periph[i].size) != 0) {
+                LOG_WARN(LOG_TOOL, "Core dump: peripheral read at 0x%08X failed, skipped\n", addr);
+                continue;
+            }
+            regions[num_regions++] = (core_region_t){ addr, core_periph[i].size, p };
+            p += core_periph[i].size;
+        }
+    }
+
+    core_note_t notes[] = {
+        { "CORE", NT_PRSTATUS, prstatus, sizeof(prstatus) },
+        { "OPENLINK", 1, ctrl, ctrl_size },
+    };
+    int ret = file_write_core(filename, notes, 2, regions, num_regions);
+    free(periph);
+    if (ret != 0) {
+        unlink(filename);
+        return -1;
+    }
+
+    double ms = script_elapsed_ms(&start);
+    if (elapsed_ms) {
+        *elapsed_ms = ms;
+    }
+    LOG_INFO(LOG_TOOL, "Core dump: %s (PC=0x%08X, %d regions) in %.0f ms\n", filename, regs[REG_PC], num_regions, ms);
+    return 0;
+}
+
+/* --profile: run the target for 'seconds' while sampling its PC
+ * The target is left running afterwards.
+ */
+static int do_profile(double seconds, int rate, int depth, const char *prefix) {
+    char summary[1600];
+
+    if (profile_start(rate, depth) != 0) {
+        LOG_ERROR(LOG_TOOL, "Profile: out of memory\n");
+        return -1;
+    }
+    LOG_INFO(LOG_TOOL, "Profiling for %.1f s at %d Hz (%d symbols)...\n", seconds, rate, g_symbols.count);
+
+    cmd_enter_mode(g_usb_dev, 0xF8);
+    invalidate_halt_state();
+    cmd_07_02_bdm_go(g_usb_dev);
+    g_target_halted = 0;
+
+    double start = profile_clock_ms();
+    double end = start + seconds * 1000.0;
+    while (g_running && profile_clock_ms() < end) {
+        usleep(200);
+        if (profile_poll()) {
+            uint32_t pc = 0;
+            read_cpu_register_bdm(REG_PC, &pc);
+            LOG_WARN(LOG_TOOL, "Target halted by itself at 0x%08X, profile ends early\n", pc);
+            break;
+        }
+    }
+    g_profile.run_ms = profile_clock_ms() - start;
+
+    int ret = profile_stop(prefix, summary, sizeof(summary));
+    log_write_lines(LOG_TOOL, LOG_LEVEL_INFO, summary);
+    if (ret == 0) {
+        LOG_INFO(LOG_TOOL, "Wrote %s.txt and %s.folded\n", prefix, prefix);
+    }
+    return ret;
+}
+
+/* SRAM + register snapshots kept in host memory, for resetting a test
+ * fixture without reflashing: "monitor snapshot save|restore <slot>".
+ * Images are stored without inserted breakpoints, like GDB sees memory.
+ */
+#define SNAPSHOT_PAGE       256     /* Restore compares and writes in pages */
+
+static struct {
+    uint8_t *sram;                  /* NULL = slot empty */
+    uint32_t regs[NUM_REGISTERS];
+} g_snapshots[SNAPSHOT_SLOTS];
+
+/* Snapshots are taken and restored with the target halted */
+static void snapshot_halt(void) {
+    if (!g_target_halted) {
+        target_halt(g_usb_dev);
+        invalidate_halt_state();
+        g_target_halted = 1;
+    }
+}
+
+static int snapshot_save(int slot, double *elapsed_ms) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (flash_state.initialized) {
+        LOG_ERROR(LOG_TOOL, "Snapshot: SRAM holds the flashloader, reset the target first\n");
+        return -1;
+    }
+    snapshot_halt();
+
+    if (!g_snapshots[slot].sram && !(g_snapshots[slot].sram = malloc(SRAM_SIZE))) {
+        return -1;
+    }
+    /* One bulk read; it also fills the halt cache for a later restore */
+    if (read_target_memory(SRAM_BASE, g_snapshots[slot].sram, SRAM_SIZE) != 0) {
+        LOG_ERROR(LOG_TOOL, "Snapshot: SRAM read failed\n");
+        free(g_snapshots[slot].sram);
+        g_snapshots[slot].sram = NULL;
+        return -1;
+    }
+    breakpoint_shadow_read(SRAM_BASE, g_snapshots[slot].sram, SRAM_SIZE);
+
+    for (int i = 0; i < NUM_REGISTERS; i++) {
+        read_cpu_register(i, &g_snapshots[slot].regs[i]);
+    }
+
+    *elapsed_ms = script_elapsed_ms(&start);
+    LOG_INFO(LOG_TOOL, "Snapshot %d saved: PC=0x%08X in %.0f ms\n", slot, g_snapshots[slot].regs[REG_PC], *elapsed_ms);
+    return 0;
+}
+
+/* Returns the number of pages written, or -1 */
+static int snapshot_restore(int slot, double *elapsed_ms) {
+    static uint8_t current[SRAM_SIZE];
+    static uint8_t wanted[SRAM_SIZE];
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (!g_snapshots[slot].sram) {
+        LOG_ERROR(LOG_TOOL, "Snapshot: slot %d is empty\n", slot);
+        return -1;
+    }
+    snapshot_halt();
+
+    /* The restore overwrites a resident flashloader */
+    if (flash_state.initialized) {
+        flash_reset_state();
+    }
+
+    if (read_target_memory(SRAM_BASE, current, SRAM_SIZE) != 0) {
+        LOG_ERROR(LOG_TOOL, "Snapshot: SRAM read failed\n");
+        return -1;
+    }
+
+    /* Keep breakpoints that are inserted now armed */
+    memcpy(wanted, g_snapshots[slot].sram, SRAM_SIZE);
+    breakpoint_shadow_write(SRAM_BASE, wanted, SRAM_SIZE);
+
+    /* Upload runs of differing pages, each as one block write */
+    int pages = 0;
+    for (uint32_t page = 0; page < SRAM_SIZE / SNAPSHOT_PAGE; page++) {
+        uint32_t run = page;
+        while (run < SRAM_SIZE / SNAPSHOT_PAGE &&
+               memcmp(current + run * SNAPSHOT_PAGE, wanted + run * SNAPSHOT_PAGE, SNAPSHOT_PAGE) != 0) {
+            run++;
+        }
+        if (run == page) {
+            continue;
+        }
+        uint32_t offset = page * SNAPSHOT_PAGE;
+        if (write_target_memory(SRAM_BASE + offset, wanted + offset, (run - page) * SNAPSHOT_PAGE) != 0) {
+            LOG_ERROR(LOG_TOOL, "Snapshot: SRAM write at 0x%08X failed\n", SRAM_BASE + offset);
+            return -1;
+        }
+        pages += run - page;
+        page = run;
+    }
+
+    /* SR before A7 so the right stack pointer is written, PC last */
+    const uint32_t *regs = g_snapshots[slot].regs;
+    int r = write_cpu_register(REG_SR, regs[REG_SR]);
+    r |= write_cpu_register(REG_A7, regs[REG_A7]);
+    for (int i = REG_D0; i < REG_A7; i++) {
+        r |= write_cpu_register(i, regs[i]);
+    }
+    r |= write_cpu_register(REG_PC, regs[REG_PC]);
+    if (r != 0) {
+        LOG_ERROR(LOG_TOOL, "Snapshot: register restore failed\n");
+        return -1;
+    }
+
+    *elapsed_ms = script_elapsed_ms(&start);
+    LOG_INFO(LOG_TOOL, "Snapshot %d restored: %d/%d pages written in %.0f ms\n", slot, pages,
+             SRAM_SIZE / SNAPSHOT_PAGE, *elapsed_ms);
+    return pages;
+}
+
+/* Sector s of the wanted image differs from flash (current = NULL: unknown) */
+static int sector_differs(const uint8_t *image, const uint8_t *current, uint32_t s) {
+    return !current || memcmp(image + s * SECTOR_SIZE, current + s * SECTOR_SIZE, SECTOR_SIZE) != 0;
+}
+
+/* Mode 2b: Program boards with a per-board patch record
+ * The base image is loaded once. For each board the patch record is laid
+ * over it and the flash is read back first, so only sectors that differ
+ * are erased and programmed: a board that already carries the base image
+ * only gets the sector holding the record rewritten.
+ * boards = 0 keeps going until the CSV runs out or the operator quits.
+ */
+static int do_program_boards(const char *filename, uint32_t base_addr, int verify,
+                             board_patch_t *patch, int boards) {
+    loaded_file_t file;
+    uint8_t *data;
+    uint32_t data_addr, data_size;
+
+    if (file_load(filename, base_addr, &file) != 0) {
+        LOG_ERROR(LOG_TOOL, "Failed to load file '%s'\n", filename);
+        return -1;
+    }
+    file_print_info(&file);
+    int r = file_get_contiguous(&file, &data_addr, &data, &data_size);
+    file_free(&file);
+    if (r != 0) {
+        LOG_ERROR(LOG_TOOL, "Failed to get contiguous data\n");
+        return -1;
+    }
+
+    if (data_addr + data_size > FLASH_SIZE || patch->addr + patch->size > FLASH_SIZE) {
+        LOG_ERROR(LOG_TOOL, "Image or patch record extends beyond flash\n");
+        free(data);
+        return -1;
+    }
+
+    /* Sector-aligned span covering the image and the record */
+    uint32_t start = data_addr < patch->addr ? data_addr : patch->addr;
+    uint32_t end = data_addr + data_size > patch->addr + patch->size ?
+                   data_addr + data_size : patch->addr + patch->size;
+    start &= ~(SECTOR_SIZE - 1);
+    end = (end + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1);
+    uint32_t span = end - start;
+    uint32_t num_sectors = span / SECTOR_SIZE;
+
+    uint8_t *image = malloc(span);
+    uint8_t *actual = malloc(span);
+    if (!image || !actual) {
+        free(image);
+        free(actual);
+        free(data);
+        return -1;
+    }
+    memset(image, 0xFF, span);
+    memcpy(image + (data_addr - start), data, data_size);
+    free(data);
+
+    LOG_INFO(LOG_TOOL, "Base image 0x%08X-0x%08X, patch record %u bytes at 0x%08X\n",
+             start, end, patch->size, patch->addr);
+
+    int ret = 0;
+    for (int board = 0; boards == 0 || board < boards; board++) {
+        uint8_t record[PATCH_MAX_SIZE];
+        char desc[128];
+
+        r = patch_build(patch, record, desc, sizeof(desc));
+        if (r == 1) {
+            LOG_INFO(LOG_TOOL, "No more CSV rows\n");
+            break;
+        } else if (r != 0) {
+            ret = -1;
+            break;
+        }
+
+        /* Later boards are connected by the operator */
+        if (board > 0) {
+            char line[64];
+            LOG_INFO(LOG_TOOL, "Connect the next board and press Enter (q to quit)\n");
+            if (!g_running || !fgets(line, sizeof(line), stdin) || line[0] == 'q') {
+                break;
+            }
+            if (init_target(1) != 0) {
+                ret = -1;
+                break;
+            }
+        }
+
+        struct timespec board_start;
+        clock_gettime(CLOCK_MONOTONIC, &board_start);
+        memcpy(image + (patch->addr - start), record, patch->size);
+
+        /* Differential: if the read-back fails, every sector is rewritten */
+        const uint8_t *current = read_target_direct(start, actual, span) == 0 ? actual : NULL;
+
+        gpl_flash_state_t flash;
+        if (gpl_flash_init(&flash, g_usb_dev, NULL) != 0) {
+            LOG_ERROR(LOG_FLASH, "Failed to initialize flashloader\n");
+            ret = -1;
+            break;
+        }
 
-/* Cleanup */
-static void cleanup(void) {
-    if (g_client_socket >= 0) {
-        close(g_client_socket);
-    }
-    if (g_server_socket >= 0) {
-        close(g_server_socket);
-    }
-    if (g_usb_dev) {
-        libusb_release_interface(g_usb_dev, 0);
-        libusb_close(g_usb_dev);
-        libusb_exit(NULL);
+        /* Erase and program runs of differing sectors */
+        uint32_t programmed = 0;
+        for (uint32_t s = 0; s < num_sectors && ret == 0; ) {
+            if (!sector_differs(image, current, s)) {
+                s++;
+                continue;
+            }
+            uint32_t first = s;
+            while (s < num_sectors && sector_differs(image, current, s)) {
+                s++;
+            }
+            uint32_t off = first * SECTOR_SIZE;
+            uint32_t len = (s - first) * SECTOR_SIZE;
+            if (gpl_flash_erase_range(&flash, start + off, len) != 0 ||
+                gpl_flash_program(&flash, start + off, image + off, len) != 0 ||
+                (verify && gpl_flash_verify(&flash, start + off, image + off, len) != 0)) {
+                LOG_ERROR(LOG_TOOL, "Board %u: programming 0x%08X-0x%08X failed\n",
+                          patch->index, start + off, start + off + len);
+                ret = -1;
+            }
+            programmed += s - first;
+        }
+        gpl_flash_cleanup(&flash);
+        if (ret != 0) {
+            break;
+        }
+
+        LOG_INFO(LOG_TOOL, "Board %u [%s]: %u of %u sectors programmed (%.0f ms)\n",
+                 patch->index, desc, programmed, num_sectors, script_elapsed_ms(&board_start));
+        if (patch_commit(patch) != 0) {
+            ret = -1;
+            break;
+        }
     }
-}
 
-static void print_usage(const char *prog) {
-    printf("OpenLink ColdFire GDB Server / Flash Programmer\n\n");
-    printf("Usage: %s [OPTIONS]\n\n", prog);
-    printf("Modes:\n");
-    printf("  --erase                Erase entire flash (256KB)\n");
-    printf("  --program <file>       Erase and program flash from file\n");
-    printf("                         Supports: .bin, .elf, .s19/.srec\n");
-    printf("  --gdb                  GDB server mode (default)\n");
-    printf("\n");
-    printf("Options:\n");
-    printf("  -p, --port <port>      TCP port for GDB (default: %d)\n", DEFAULT_PORT);
-    printf("  -f, --flashloader <path>  Path to flashloader.elf\n");
-    printf("  -v, --verify           Verify after programming\n");
-    printf("  --base <addr>          Base address for .bin files (default: 0x00000000)\n");
-    printf("  -h, --help             Show this help\n");
-    printf("\n");
-    printf("Examples:\n");
-    printf("  %s --erase                       Erase entire flash\n", prog);
-    printf("  %s --program firmware.bin        Program binary file\n", prog);
-    printf("  %s --program firmware.elf -v     Program ELF with verify\n", prog);
-    printf("  %s -p 3333                       Start GDB server\n", prog);
-    printf("  %s --gdb                         Start GDB server\n", prog);
+    free(image);
+    free(actual);
+    return ret;
 }
 
-/* Mode 1: Erase only */
-static int do_erase_only(void) {
-    gpl_flash_state_t flash;
-    int ret = -1;
+/*
+ * Daemon Control Socket
+ * In --daemon mode the server owns the probe and the initialized target
+ * across GDB sessions. --erase and --program first try the control socket
+ * and, if a daemon answers, have it do the work instead of opening the
+ * probe and running the full target init themselves.
+ *
+ * Protocol: one request line per connection, one reply line:
+ *   erase                          -> OK | ERR <reason>
+ *   program <base> <verify> <path> -> OK | ERR <reason>
+ *   dump <addr> <len> <path>       -> OK | ERR <reason>
+ *   status                         -> OK <target state>
+ */
 
-    printf("\n");
-    printf("==============================================\n");
-    printf("  Erasing entire flash (256KB)\n");
-    printf("==============================================\n\n");
+/* Create the listening control socket */
+static int open_control_socket(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        LOG_ERROR(LOG_TOOL, "Control socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
 
-    if (gpl_flash_init(&flash, g_usb_dev, NULL) != 0) {
-        fprintf(stderr, "Failed to initialize flashloader\n");
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        LOG_ERROR(LOG_TOOL, "Control socket: %s\n", strerror(errno));
         return -1;
     }
 
-    if (gpl_flash_mass_erase(&flash) != 0) {
-        fprintf(stderr, "Mass erase failed\n");
-        goto cleanup;
+    unlink(path);  /* Stale socket from a previous daemon */
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        LOG_ERROR(LOG_TOOL, "Control socket %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
     }
+    chmod(path, 0600);
+    return fd;
+}
 
-    printf("\n");
-    printf("==============================================\n");
-    printf("  Flash erased successfully!\n");
-    printf("==============================================\n");
-    ret = 0;
+/* Write a reply line to a control client */
+static void control_reply(int fd, const char *reply) {
+    size_t len = strlen(reply);
+    if (write(fd, reply, len) != (ssize_t)len || write(fd, "\n", 1) != 1) {
+        LOG_WARN(LOG_TOOL, "Control reply: %s\n", strerror(errno));
+    }
+}
 
-cleanup:
-    gpl_flash_cleanup(&flash);
-    return ret;
+/* Read one request line; returns its length or -1 */
+static int control_read_line(int fd, char *line, size_t size) {
+    size_t pos = 0;
+    while (pos < size - 1) {
+        ssize_t n = read(fd, line + pos, 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        if (line[pos] == '\n') break;
+        pos++;
+    }
+    line[pos] = '\0';
+    return pos ? (int)pos : -1;
 }
 
-/* Mode 2: Program file */
-static int do_program_file(const char *filename, uint32_t base_addr, int verify) {
-    gpl_flash_state_t flash;
-    loaded_file_t file;
-    int ret = -1;
+static int do_erase_only(void);
+static int do_program_file(const char *filename, uint32_t base_addr, int verify);
 
-    printf("\n");
-    printf("==============================================\n");
-    printf("  Programming %s\n", filename);
-    printf("==============================================\n\n");
+/* Reading needs the target back from the flashloader */
+static int control_target_ready(int fd) {
+    if (g_target_reinit) {
+        if (init_target(1) != 0) {
+            control_reply(fd, "ERR target init failed");
+            return -1;
+        }
+        g_target_reinit = 0;
+    }
+    return 0;
+}
 
-    /* Load file */
-    if (file_load(filename, base_addr, &file) != 0) {
-        fprintf(stderr, "Failed to load file '%s'\n", filename);
-        return -1;
+/* Serve one control connection */
+static void handle_control_client(int fd) {
+    char line[CONTROL_LINE_MAX];
+    if (control_read_line(fd, line, sizeof(line)) < 0) {
+        return;
+    }
+    LOG_INFO(LOG_TOOL, "Control request: %s\n", line);
+
+    int r;
+    if (strcmp(line, "erase") == 0) {
+        r = do_erase_only();
+    } else if (strncmp(line, "program ", 8) == 0) {
+        char *end;
+        uint32_t base = strtoul(line + 8, &end, 0);
+        int verify = strtol(end, &end, 0);
+        while (*end == ' ') end++;
+        if (*end == '\0') {
+            control_reply(fd, "ERR missing file name");
+            return;
+        }
+        r = do_program_file(end, base, verify);
+    } else if (strncmp(line, "dump ", 5) == 0) {
+        char *end;
+        uint32_t addr = strtoul(line + 5, &end, 0);
+        uint32_t len = strtoul(end, &end, 0);
+        while (*end == ' ') end++;
+        if (*end == '\0') {
+            control_reply(fd, "ERR missing file name");
+            return;
+        }
+        if (control_target_ready(fd) != 0) {
+            return;
+        }
+        r = do_dump(addr, len, end);
+        control_reply(fd, r == 0 ? "OK" : "ERR operation failed, see daemon log");
+        return;
+    } else if (strncmp(line, "coredump ", 9) == 0) {
+        char *end;
+        int with_periph = strtol(line + 9, &end, 0);
+        while (*end == ' ') end++;
+        if (*end == '\0') {
+            control_reply(fd, "ERR missing file name");
+            return;
+        }
+        if (control_target_ready(fd) != 0) {
+            return;
+        }
+        r = do_coredump(end, with_periph, NULL);
+        control_reply(fd, r == 0 ? "OK" : "ERR operation failed, see daemon log");
+        return;
+    } else if (strcmp(line, "status") == 0) {
+        control_reply(fd, g_target_halted ? "OK halted" : "OK running");
+        return;
+    } else {
+        control_reply(fd, "ERR unknown request");
+        return;
     }
 
-    file_print_info(&file);
-    printf("\n");
+    /* The flashloader ran and flash changed behind the vFlash path.
+     * Re-init lazily when the next GDB session starts, so back-to-back
+     * requests don't pay for it.
+     */
+    invalidate_halt_state();
+    flash_cache_invalidate(0, 0);
+    g_target_reinit = 1;
+    control_reply(fd, r == 0 ? "OK" : "ERR operation failed, see daemon log");
+}
 
-    /* Check flash bounds */
-    if (file.max_addr > FLASH_SIZE) {
-        fprintf(stderr, "Error: File extends beyond flash (0x%08X > 0x%08X)\n",
-                file.max_addr, FLASH_SIZE);
-        file_free(&file);
+/* Send a request to a running daemon
+ * Returns: 0 if the daemon reported success, 1 if it reported failure,
+ *          -1 if no daemon is listening
+ */
+static int daemon_request(const char *path, const char *request) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
         return -1;
     }
+    strcpy(addr.sun_path, path);
 
-    /* Initialize flashloader */
-    if (gpl_flash_init(&flash, g_usb_dev, NULL) != 0) {
-        fprintf(stderr, "Failed to initialize flashloader\n");
-        file_free(&file);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
         return -1;
     }
-
-    /* Get contiguous data */
-    uint8_t *data;
-    uint32_t data_addr, data_size;
-    if (file_get_contiguous(&file, &data_addr, &data, &data_size) != 0) {
-        fprintf(stderr, "Failed to get contiguous data\n");
-        goto cleanup;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
     }
 
-    /* Program with optional verify */
-    int r = gpl_flash_program_binary(&flash, data, data_size, data_addr, verify);
-    free(data);
-
-    if (r != 0) {
-        fprintf(stderr, "Programming failed\n");
-        goto cleanup;
+    LOG_INFO(LOG_TOOL, "Using daemon at %s\n", path);
+    size_t len = strlen(request);
+    if (write(fd, request, len) != (ssize_t)len || write(fd, "\n", 1) != 1) {
+        close(fd);
+        return 1;
     }
 
-    printf("\n");
-    printf("==============================================\n");
-    printf("  Programming complete!\n");
-    if (file.entry_point != 0) {
-        printf("  Entry point: 0x%08X\n", file.entry_point);
+    char reply[CONTROL_LINE_MAX];
+    int n = control_read_line(fd, reply, sizeof(reply));
+    close(fd);
+    if (n < 0) {
+        LOG_ERROR(LOG_TOOL, "Daemon closed the connection\n");
+        return 1;
     }
-    printf("==============================================\n");
-    ret = 0;
-
-cleanup:
-    gpl_flash_cleanup(&flash);
-    file_free(&file);
-    return ret;
+    LOG_INFO(LOG_TOOL, "Daemon: %s\n", reply);
+    return strncmp(reply, "OK", 2) == 0 ? 0 : 1;
 }
 
 int main(int argc, char *argv[]) {
     int port = DEFAULT_PORT;
     operation_mode_t mode = MODE_GDB;
     const char *program_file = NULL;
+    const char *script_file = NULL;
+    const char *dump_file = NULL;
+    int core_periph = 0;
+    int live_port = 0;
+    const char *symbols_file = NULL;
+    double profile_time = 10.0;
+    int profile_rate = PROFILE_RATE_DEFAULT, profile_depth = PROFILE_DEPTH_DEFAULT;
+    const char *profile_out = "profile";
+    uint32_t dump_addr = 0, dump_len = 0;
     int verify = 0;
+    int use_patch = 0, use_counter = 0, boards = 1;
+    uint32_t patch_addr = 0, counter_start = 0;
+    const char *patch_format = NULL, *patch_csv = NULL, *patch_state = NULL;
     uint32_t base_addr = 0x00000000;
 
     /* Parse arguments */
@@ -2375,6 +5249,12 @@ int main(int argc, char *argv[]) {
             return 0;
         } else if (strcmp(argv[i], "--gdb") == 0) {
             mode = MODE_GDB;
+        } else if (strcmp(argv[i], "--daemon") == 0) {
+            mode = MODE_DAEMON;
+        } else if (strcmp(argv[i], "--socket") == 0) {
+            if (i + 1 < argc) {
+                g_control_path = argv[++i];
+            }
         } else if (strcmp(argv[i], "--erase") == 0) {
             mode = MODE_ERASE;
         } else if (strcmp(argv[i], "--program") == 0) {
@@ -2385,12 +5265,111 @@ int main(int argc, char *argv[]) {
                 fprintf(stderr, "Error: --program requires a filename\n");
                 return 1;
             }
+        } else if (strcmp(argv[i], "--dump") == 0) {
+            if (i + 3 < argc) {
+                mode = MODE_DUMP;
+                dump_addr = strtoul(argv[++i], NULL, 0);
+                dump_len = strtoul(argv[++i], NULL, 0);
+                dump_file = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --dump requires <addr> <len> <file>\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--coredump") == 0) {
+            if (i + 1 < argc) {
+                mode = MODE_COREDUMP;
+                dump_file = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --coredump requires a filename\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--periph") == 0) {
+            core_periph = 1;
+        } else if (strcmp(argv[i], "--live-port") == 0) {
+            if (i + 1 < argc) {
+                live_port = atoi(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--symbols") == 0) {
+            if (i + 1 < argc) {
+                symbols_file = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            if (i + 1 < argc) {
+                mode = MODE_PROFILE;
+                symbols_file = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --profile requires the firmware ELF\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--profile-time") == 0) {
+            if (i + 1 < argc) {
+                profile_time = atof(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--profile-rate") == 0) {
+            if (i + 1 < argc) {
+                profile_rate = atoi(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--profile-depth") == 0) {
+            if (i + 1 < argc) {
+                profile_depth = atoi(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--profile-out") == 0) {
+            if (i + 1 < argc) {
+                profile_out = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--script") == 0) {
+            if (i + 1 < argc) {
+                mode = MODE_SCRIPT;
+                script_file = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --script requires a filename (or - for stdin)\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--patch") == 0) {
+            if (i + 1 < argc) {
+                use_patch = 1;
+                patch_addr = strtoul(argv[++i], NULL, 0);
+            }
+        } else if (strcmp(argv[i], "--patch-format") == 0) {
+            if (i + 1 < argc) {
+                patch_format = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--patch-csv") == 0) {
+            if (i + 1 < argc) {
+                patch_csv = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--patch-counter") == 0) {
+            if (i + 1 < argc) {
+                use_counter = 1;
+                counter_start = strtoul(argv[++i], NULL, 0);
+            }
+        } else if (strcmp(argv[i], "--patch-state") == 0) {
+            if (i + 1 < argc) {
+                patch_state = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--boards") == 0) {
+            if (i + 1 < argc) {
+                boards = atoi(argv[++i]);
+            }
         } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verify") == 0) {
             verify = 1;
         } else if (strcmp(argv[i], "--base") == 0) {
             if (i + 1 < argc) {
                 base_addr = strtoul(argv[++i], NULL, 0);
             }
+        } else if (strcmp(argv[i], "--log") == 0) {
+            if (i + 1 >= argc || log_parse_spec(argv[++i]) != 0) {
+                fprintf(stderr, "Error: --log requires a level spec, e.g. rsp=debug,flash=warn\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--init-seq") == 0) {
+            if (i + 1 >= argc || init_seq_load(argv[++i]) != 0) {
+                fprintf(stderr, "Error: --init-seq requires a valid sequence file\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--init-seq-dump") == 0) {
+            init_seq_dump(stdout);
+            return 0;
         } else if (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--flashloader") == 0) {
             if (i + 1 < argc) {
                 /* Flashloader path - currently ignored, uses default */
@@ -2407,31 +5386,143 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    /* Script mode: stdout carries only the JSON step report */
+    if (mode == MODE_SCRIPT) {
+        int report_fd = dup(STDOUT_FILENO);
+        g_script_report = report_fd >= 0 ? fdopen(report_fd, "w") : NULL;
+        if (!g_script_report) {
+            perror("stdout");
+            return 1;
+        }
+        setvbuf(g_script_report, NULL, _IOLBF, 0);
+        fflush(stdout);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+
+    /* Background log writer */
+    if (log_enabled(LOG_USB, LOG_LEVEL_DEBUG)) {
+        openlink_set_verbose(1);
+    }
+    if (log_init() == 0) {
+        atexit(log_shutdown);
+    }
+
     /* Setup signal handlers */
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     signal(SIGPIPE, SIG_IGN);  /* Ignore SIGPIPE - handle broken pipe in send() */
 
+    if (symbols_file && file_load_symbols(symbols_file, &g_symbols) != 0) {
+        return 1;
+    }
+    if (mode == MODE_PROFILE &&
+        (profile_time <= 0 || profile_rate <= 0 || profile_rate > PROFILE_RATE_MAX ||
+         profile_depth < 0 || profile_depth >= PROFILE_MAX_DEPTH)) {
+        fprintf(stderr, "Error: --profile-rate must be 1-%d Hz, --profile-depth 0-%d\n",
+                PROFILE_RATE_MAX, PROFILE_MAX_DEPTH - 1);
+        return 1;
+    }
+
+    board_patch_t patch;
+    if (use_patch) {
+        if (mode != MODE_PROGRAM) {
+            fprintf(stderr, "Error: --patch needs --program <base image>\n");
+            return 1;
+        }
+        if (patch_init(&patch, patch_addr, patch_format, patch_csv, use_counter,
+                       counter_start, patch_state) != 0) {
+            return 1;
+        }
+    }
+
+    /* Let a running daemon do flash operations - it already owns the
+     * probe and an initialized target
+     */
+    if ((mode == MODE_ERASE || mode == MODE_PROGRAM || mode == MODE_DUMP ||
+         mode == MODE_COREDUMP) && !use_patch) {
+        char request[CONTROL_LINE_MAX];
+        if (mode == MODE_ERASE) {
+            snprintf(request, sizeof(request), "erase");
+        } else if (mode == MODE_DUMP || mode == MODE_COREDUMP) {
+            /* The daemon writes the file, so it needs an absolute path */
+            char cwd[PATH_MAX];
+            char op[48];
+            int n;
+            if (mode == MODE_DUMP) {
+                snprintf(op, sizeof(op), "dump 0x%08X 0x%X", dump_addr, dump_len);
+            } else {
+                snprintf(op, sizeof(op), "coredump %d", core_periph);
+            }
+            if (dump_file[0] == '/' || !getcwd(cwd, sizeof(cwd))) {
+                n = snprintf(request, sizeof(request), "%s %s", op, dump_file);
+            } else {
+                n = snprintf(request, sizeof(request), "%s %s/%s", op, cwd, dump_file);
+            }
+            if (n >= (int)sizeof(request)) {
+                request[0] = '\0';     /* Path too long for the daemon, dump locally */
+            }
+        } else {
+            char *path = realpath(program_file, NULL);
+            if (!path) {
+                LOG_ERROR(LOG_TOOL, "%s: %s\n", program_file, strerror(errno));
+                return 1;
+            }
+            snprintf(request, sizeof(request), "program 0x%08X %d %s", base_addr, verify, path);
+            free(path);
+        }
+        int r = request[0] ? daemon_request(g_control_path, request) : -1;
+        if (r >= 0) {
+            return r;
+        }
+    }
+
+    struct timespec init_start;
+    clock_gettime(CLOCK_MONOTONIC, &init_start);
+
     /* Initialize USB connection */
     if (init_usb() != 0) {
+        script_report(0, 0, "init", script_elapsed_ms(&init_start), "", "probe not found");
         return 1;
     }
 
     /* Initialize target */
-    if (init_target() != 0) {
+    if (init_target(0) != 0) {
+        script_report(0, 0, "init", script_elapsed_ms(&init_start), "", "target init failed");
         cleanup();
         return 1;
     }
+    script_report(0, 0, "init", script_elapsed_ms(&init_start), "", NULL);
 
     /* Handle non-GDB modes */
     if (mode == MODE_ERASE) {
         int ret = do_erase_only();
         cleanup();
         return ret;
+    } else if (mode == MODE_PROGRAM && use_patch) {
+        int ret = do_program_boards(program_file, base_addr, verify, &patch, boards);
+        patch_free(&patch);
+        cleanup();
+        return ret == 0 ? 0 : 1;
     } else if (mode == MODE_PROGRAM) {
         int ret = do_program_file(program_file, base_addr, verify);
         cleanup();
         return ret;
+    } else if (mode == MODE_DUMP) {
+        int ret = do_dump(dump_addr, dump_len, dump_file);
+        cleanup();
+        return ret == 0 ? 0 : 1;
+    } else if (mode == MODE_COREDUMP) {
+        int ret = do_coredump(dump_file, core_periph, NULL);
+        cleanup();
+        return ret == 0 ? 0 : 1;
+    } else if (mode == MODE_PROFILE) {
+        int ret = do_profile(profile_time, profile_rate, profile_depth, profile_out);
+        cleanup();
+        return ret == 0 ? 0 : 1;
+    } else if (mode == MODE_SCRIPT) {
+        int ret = do_script(script_file);
+        cleanup();
+        return ret == 0 ? 0 : 1;
     }
 
     /* MODE_GDB: Create server socket */
@@ -2465,6 +5556,24 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (live_port > 0) {
+        if (live_watch_open(live_port) != 0) {
+            cleanup();
+            return 1;
+        }
+        live_watch_set_symbols(&g_symbols);
+        LOG_INFO(LOG_TOOL, "Live watch on port %d\n", live_port);
+    }
+
+    if (mode == MODE_DAEMON) {
+        g_control_socket = open_control_socket(g_control_path);
+        if (g_control_socket < 0) {
+            cleanup();
+            return 1;
+        }
+        LOG_INFO(LOG_TOOL, "Daemon control socket: %s\n", g_control_path);
+    }
+
     printf("\n");
     printf("==============================================\n");
     printf("  m68k-gdbserver listening on port %d\n", port);
@@ -2483,10 +5592,16 @@ int main(int argc, char *argv[]) {
         struct timeval tv;
         FD_ZERO(&readfds);
         FD_SET(g_server_socket, &readfds);
+        int max_fd = g_server_socket;
+        if (g_control_socket >= 0) {
+            FD_SET(g_control_socket, &readfds);
+            if (g_control_socket > max_fd) max_fd = g_control_socket;
+        }
+        max_fd = live_watch_fdset(&readfds, max_fd);
         tv.tv_sec = 1;  /* 1 second timeout */
         tv.tv_usec = 0;
 
-        int sel = select(g_server_socket + 1, &readfds, NULL, NULL, &tv);
+        int sel = select(max_fd + 1, &readfds, NULL, NULL, &tv);
         if (sel < 0) {
             if (errno == EINTR) continue;  /* Signal interrupted */
             perror("select");
@@ -2497,6 +5612,24 @@ int main(int argc, char *argv[]) {
             continue;
         }
 
+        live_watch_service(&readfds);
+        if (!FD_ISSET(g_server_socket, &readfds) &&
+            !(g_control_socket >= 0 && FD_ISSET(g_control_socket, &readfds))) {
+            continue;
+        }
+
+        /* CLI request for the daemon */
+        if (g_control_socket >= 0 && FD_ISSET(g_control_socket, &readfds)) {
+            int fd = accept(g_control_socket, NULL, NULL);
+            if (fd >= 0) {
+                handle_control_client(fd);
+                close(fd);
+            }
+            if (!FD_ISSET(g_server_socket, &readfds)) {
+                continue;
+            }
+        }
+
         struct sockaddr_in client_addr;
         socklen_t client_len = sizeof(client_addr);
         g_client_socket = accept(g_server_socket, (struct sockaddr *)&client_addr, &client_len);
@@ -2514,8 +5647,23 @@ int main(int argc, char *argv[]) {
         printf("GDB connected from %s:%d\n",
                inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
 
+        if (g_target_reinit) {
+            if (init_target(1) != 0) {
+                close(g_client_socket);
+                g_client_socket = -1;
+                continue;
+            }
+            g_target_reinit = 0;
+        }
+
+        /* The board may have been swapped or reflashed between sessions */
+        flash_cache_invalidate(0, 0);
+
         handle_client(g_client_socket);
 
+        /* Don't leave HALT opcodes behind for the next session */
+        remove_all_breakpoints();
+
         close(g_client_socket);
         g_client_socket = -1;
         printf("GDB disconnected\n");
@@ -1,7 +1,9 @@
 #include "openlink_protocol.h"
+#include "init_seq.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 // Global verbosity flag - default is quiet (0)
@@ -19,6 +21,24 @@ void openlink_set_verbose(int level) {
 // Note: Not static - externally visible for test programs
 unsigned char g_cmd_buffer[256] = {0};
 
+// Init phase timing
+// Returns milliseconds since *mark and moves the mark to now, so consecutive
+// calls measure consecutive phases.
+static double phase_elapsed_ms(struct timespec *mark) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double ms = (now.tv_sec - mark->tv_sec) * 1000.0 +
+                (now.tv_nsec - mark->tv_nsec) / 1000000.0;
+    *mark = now;
+    return ms;
+}
+
+static void phase_report(const char *name, struct timespec *mark, double *total) {
+    double ms = phase_elapsed_ms(mark);
+    *total += ms;
+    printf("  [%7.1f ms] %s\n", ms, name);
+}
+
 int usb_reset(libusb_device_handle *dev) {
     int r = libusb_reset_device(dev);
     if (r < 0) {
@@ -653,6 +673,167 @@ int cmd_0717_read_memory(libusb_device_handle *handle, uint32_t addr, uint16_t l
     return 0;
 }
 
+// Block Memory Read (cmd_0717, multi-packet response)
+// Same command as cmd_0717_read_memory, but the response is received into a
+// dedicated buffer large enough for the whole transfer, so a single request
+// can return several kilobytes. The 6-byte-per-word IN stream is decoded
+// straight into the caller's buffer.
+//
+// The largest size the probe answers correctly is found once by
+// openlink_read_block_size(); openlink_read_memory() reads in blocks of
+// that size.
+static unsigned char g_read_buffer[5 + (OPENLINK_READ_BLOCK_MAX / 4) * 6 + 64];
+static int g_read_block_size = 0;   // 0 = not probed yet
+
+// Discard whatever is left on the IN endpoint after a failed transfer
+static void drain_in_endpoint(libusb_device_handle *handle) {
+    int len;
+    for (int i = 0; i < 64; i++) {
+        if (libusb_bulk_transfer(handle, ENDPOINT_IN, g_read_buffer, sizeof(g_read_buffer),
+                                 &len, 100) != 0 || len == 0) {
+            break;
+        }
+    }
+}
+
+// Returns: 0 on success, -1 on error
+int cmd_0717_read_block(libusb_device_handle *handle, uint32_t addr, uint32_t length,
+                        uint8_t *buffer) {
+    if (length == 0 || length > OPENLINK_READ_BLOCK_MAX) {
+        fprintf(stderr, "cmd_0717_read_block: invalid length %u\n", length);
+        return -1;
+    }
+
+    unsigned char *cmd = g_cmd_buffer;  // Use global persistent buffer
+
+    cmd[0] = 0xaa;
+    cmd[1] = 0x55;
+    cmd[2] = 0x00;
+    cmd[3] = 0x08;
+    cmd[4] = 0x07;
+    cmd[5] = 0x17;
+    cmd[6] = (addr >> 24) & 0xFF;
+    cmd[7] = (addr >> 16) & 0xFF;
+    cmd[8] = (addr >> 8) & 0xFF;
+    cmd[9] = addr & 0xFF;
+
+    // 6 raw bytes per 4 data bytes (see cmd_0717_read_memory)
+    uint16_t request_length = ((length + 3) / 4) * 6;
+    cmd[10] = (request_length >> 8) & 0xFF;
+    cmd[11] = request_length & 0xFF;
+    // CRUCIAL: Do NOT zero bytes 12-255! They contain leftover response data
+
+    int sent_length;
+    int r = libusb_bulk_transfer(handle, ENDPOINT_OUT, cmd, 256, &sent_length, 0);
+    if (r != 0) {
+        fprintf(stderr, "Error sending cmd_0717 block read: %s\n", libusb_error_name(r));
+        return -1;
+    }
+
+    // Receive until the length in the header is satisfied or a short
+    // transfer ends the stream
+    int total_received = 0;
+    int total_expected = 0;
+    while (total_received < (int)sizeof(g_read_buffer)) {
+        int space = (int)sizeof(g_read_buffer) - total_received;
+        int chunk_len;
+        r = libusb_bulk_transfer(handle, ENDPOINT_IN, g_read_buffer + total_received,
+                                 space, &chunk_len, 10000);
+        if (r < 0) {
+            fprintf(stderr, "Error receiving cmd_0717 block read: %s\n", libusb_error_name(r));
+            return -1;
+        }
+        total_received += chunk_len;
+
+        if (total_expected == 0 && total_received >= 4) {
+            total_expected = 4 + ((g_read_buffer[2] << 8) | g_read_buffer[3]);
+        }
+        if (chunk_len == 0 || (total_expected && total_received >= total_expected)) {
+            break;
+        }
+    }
+
+    if (g_openlink_verbose) {
+        printf("cmd_0717 block read: 0x%08X, %u bytes, received %d raw\n",
+               addr, length, total_received);
+    }
+
+    // Keep g_cmd_buffer holding the start of the last response, exactly as
+    // if it had been received there
+    memcpy(g_cmd_buffer, g_read_buffer, total_received < 256 ? total_received : 256);
+
+    uint16_t response_type;
+    // The pad bytes after the last word may be missing
+    if (validate_response(g_read_buffer, total_received, 5 + request_length - 2, &response_type) != 0) {
+        fprintf(stderr, "Invalid response for cmd_0717 block read\n");
+        return -1;
+    }
+
+    // Extract data from 6-byte-per-word format
+    const unsigned char *src = g_read_buffer + 5;
+    uint32_t done = 0;
+    while (done < length) {
+        uint32_t chunk = (length - done >= 4) ? 4 : (length - done);
+        memcpy(buffer + done, src, chunk);
+        done += chunk;
+        src += 6;
+    }
+    return 0;
+}
+
+// Find the largest block size the probe returns intact
+// Reads the start of flash with decreasing block sizes and compares it with
+// a small cmd_0717_read_memory read; the result is remembered.
+// Returns: block size in bytes (at least OPENLINK_READ_BLOCK_MIN)
+int openlink_read_block_size(libusb_device_handle *handle) {
+    if (g_read_block_size) {
+        return g_read_block_size;
+    }
+
+    uint8_t reference[OPENLINK_READ_BLOCK_MIN];
+    static uint8_t block[OPENLINK_READ_BLOCK_MAX];
+    if (cmd_0717_read_memory(handle, 0x00000000, sizeof(reference), reference,
+                             sizeof(reference)) != 0) {
+        return OPENLINK_READ_BLOCK_MIN;  // Try again next time
+    }
+
+    int size;
+    for (size = OPENLINK_READ_BLOCK_MAX; size > OPENLINK_READ_BLOCK_MIN; size /= 2) {
+        if (cmd_0717_read_block(handle, 0x00000000, size, block) == 0 &&
+            memcmp(block, reference, sizeof(reference)) == 0) {
+            break;
+        }
+        drain_in_endpoint(handle);
+    }
+
+    g_read_block_size = size;
+    printf("Probe block read size: %d bytes\n", size);
+    return size;
+}
+
+// Read any amount of target memory using the largest supported block size
+// Returns: 0 on success, -1 on error
+int openlink_read_memory(libusb_device_handle *handle, uint32_t addr, uint32_t length,
+                         uint8_t *buffer) {
+    uint32_t block = openlink_read_block_size(handle);
+    uint32_t offset = 0;
+
+    while (offset < length) {
+        uint32_t chunk = length - offset;
+        if (chunk > block) {
+            chunk = block;
+        }
+        int r = (block > OPENLINK_READ_BLOCK_MIN)
+              ? cmd_0717_read_block(handle, addr + offset, chunk, buffer + offset)
+              : cmd_0717_read_memory(handle, addr + offset, chunk, buffer + offset, chunk);
+        if (r != 0) {
+            return -1;
+        }
+        offset += chunk;
+    }
+    return 0;
+}
+
 // Memory Read/Verify Command (cmd_071b)
 // Read and verify memory - used extensively in SRAM validation sequence
 // Command: aa55 0008 071b [addr:4] [len:2]
@@ -1059,6 +1240,64 @@ int cmd_download_block(libusb_device_handle *handle, uint32_t address, unsigned
     return 0;
 }
 
+// Block Memory Write
+// Writes any length of RAM: the longword-aligned body goes out as bb 66
+// download blocks (cmd_download_block), the unaligned head and tail as
+// read-modify-write longwords with cmd_07_19 so neighbouring bytes are kept.
+// Only for RAM - the download path is what uploads the flashloader to SRAM.
+//
+// Returns: 0 on success, -1 on error
+static int write_partial_long(libusb_device_handle *handle, uint32_t addr,
+                              const uint8_t *data, int length) {
+    uint32_t aligned = addr & ~3u;
+    uint8_t word[4];
+
+    if (cmd_0717_read_memory(handle, aligned, 4, word, 4) != 0) {
+        return -1;
+    }
+    memcpy(word + (addr & 3), data, length);
+
+    uint32_t value = ((uint32_t)word[0] << 24) | ((uint32_t)word[1] << 16) |
+                     ((uint32_t)word[2] << 8) | word[3];
+    return cmd_07_19(handle, aligned, value);
+}
+
+int openlink_write_memory(libusb_device_handle *handle, uint32_t addr,
+                          const uint8_t *data, uint32_t length) {
+    // Unaligned head
+    if ((addr & 3) && length > 0) {
+        uint32_t n = 4 - (addr & 3);
+        if (n > length) {
+            n = length;
+        }
+        if (write_partial_long(handle, addr, data, n) != 0) {
+            return -1;
+        }
+        addr += n;
+        data += n;
+        length -= n;
+    }
+
+    // Aligned body
+    uint32_t body = length & ~3u;
+    if (body > 0) {
+        if (cmd_download_block(handle, addr, (unsigned char *)data, body) != 0) {
+            return -1;
+        }
+        addr += body;
+        data += body;
+        length -= body;
+    }
+
+    // Tail
+    if (length > 0) {
+        if (write_partial_long(handle, addr, data, length) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 // BDM Resume Command
 // Instructs the Multilink to resume target CPU execution
 // Command: aa 55 00 04 04 40 58 04
@@ -1743,7 +1982,7 @@ int cmd_071e_write_sram(libusb_device_handle *handle, uint32_t addr, uint32_t da
 // Implements lines 1-138 from RAM_INIT_SEQUENCE.txt
 // Required before SRAM validation sequence will work
 //
-// Steps:
+// Steps (see the sram_pre_init table in init_seq.c):
 //   1. Device detection (cmd_010b twice)
 //   2. Enter mode and BDM initialization
 //   3. Memory window setup (cmd_0710 9x)
@@ -1752,279 +1991,10 @@ int cmd_071e_write_sram(libusb_device_handle *handle, uint32_t addr, uint32_t da
 //
 // Returns: 0 on success, -1 on error
 int sram_pre_init(libusb_device_handle *handle) {
-    int r;
-    uint32_t reg_value;
-    uint8_t verify_buffer[4];
-
-    // Lines 0-1: Device detection (twice)
-    r = cmd_01_0b(handle);
-    if (r != 0) {
-        fprintf(stderr, "Device detection (1) **FAILED\n");
-        return -1;
-    }
-    r = cmd_01_0b(handle);
-    if (r != 0) {
-        fprintf(stderr, "Device detection (2) **FAILED\n");
+    if (init_seq_run(handle, INIT_SEQ_SRAM_PRE_INIT) != 0) {
         return -1;
     }
 
-    // Lines 2-10: Initial BDM setup
-    r = cmd_enter_mode(handle, 0xFC);
-    if (r != 0) return -1;
-
-    r = cmd_07_a2(handle, 0x01);
-    if (r != 0) return -1;
-
-    r = cmd_04_40_58_04(handle);
-    if (r != 0) return -1;
-
-    r = cmd_04_7f_fe_02(handle);
-    if (r != 0) return -1;
-    r = cmd_04_7f_fe_02(handle); // Called twice
-    if (r != 0) return -1;
-
-    r = cmd_07_95(handle);
-    if (r != 0) return -1;
-
-    r = cmd_04_40_00_02(handle);
-    if (r != 0) return -1;
-
-    r = cmd_enable_memory_access(handle, 0x00);
-    if (r != 0) return -1;
-
-    r = cmd_enter_mode(handle, 0xFC);
-    if (r != 0) return -1;
-    //     printf("==> BDM initialized\n\n");
-
-    // Lines 11-19: Memory window setup (9x with 0x0000)
-    //     printf("Step 3: Setting up memory windows (9x)...\n");
-    for (int i = 0; i < 9; i++) {
-        r = cmd_07_10(handle, 0x0000);
-        if (r != 0) {
-            fprintf(stderr, " Memory window setup %d/9 **FAILED\n", i+1);
-            return -1;
-        }
-    }
-    //     printf("==> Memory windows configured\n\n");
-
-    // Lines 20-34: BDM configuration and register writes
-    //     printf("Step 4: BDM configuration...\n");
-
-    // Read register 0x2D80 twice
-    r = cmd_07_13(handle, 0x2D80, &reg_value);
-    if (r != 0) return -1;
-    r = cmd_07_13(handle, 0x2D80, &reg_value);
-    if (r != 0) return -1;
-
-    // Write registers
-    r = cmd_write_bdm_reg(handle, 0x2C80, 0x00910000);
-    if (r != 0) return -1;
-
-    r = cmd_07_13(handle, 0x2D80, &reg_value);
-    if (r != 0) return -1;
-
-    r = cmd_write_bdm_reg(handle, 0x2C80, 0x00900000);
-    if (r != 0) return -1;
-
-    r = cmd_07_12(handle, 0x0000);
-    if (r != 0) return -1;
-
-    r = cmd_enter_mode(handle, 0xF8);
-    if (r != 0) return -1;
-
-    r = cmd_07_13(handle, 0x2D80, &reg_value);
-    if (r != 0) return -1;
-
-    // BDM configuration commands
-    r = cmd_07_11(handle, 0x1940, 0xFC, 0x0A, 0x00, 0x0A);
-    if (r != 0) return -1;
-    r = cmd_07_11(handle, 0x1940, 0x40, 0x11, 0x00, 0x0A);
-    if (r != 0) return -1;
-    r = cmd_07_11(handle, 0x1900, 0x40, 0x10, 0x00, 0x74);
-    if (r != 0) return -1;
-
-    uint8_t params[] = {0x40, 0x10, 0x00, 0x74, 0x00, 0x0F};
-    r = cmd_07_15(handle, 0x1800, params, 6);
-    if (r != 0) return -1;
-
-    r = cmd_07_12(handle, 0x0000);
-    if (r != 0) return -1;
-
-    r = cmd_enter_mode(handle, 0xF8);
-    if (r != 0) return -1;
-
-    r = cmd_07_11(handle, 0x2980, 0x00, 0x00, 0x08, 0x0F);
-    if (r != 0) return -1;
-    //     printf("==> BDM configured\n\n");
-
-    // Lines 35-52: Register initialization
-    //     printf("Step 5: Register initialization...\n");
-    for (uint16_t reg = 0x2180; reg <= 0x218F; reg++) {
-        r = cmd_07_13(handle, reg, &reg_value);
-        if (r != 0) {
-            fprintf(stderr, " **FAILED to read register 0x%04X\n", reg);
-            return -1;
-        }
-    }
-
-    r = cmd_07_11(handle, 0x2980, 0x00, 0x00, 0x08, 0x0F);
-    if (r != 0) return -1;
-    r = cmd_07_11(handle, 0x2980, 0x00, 0x00, 0x08, 0x0E);
-    if (r != 0) return -1;
-
-    // Line 53: Memory read (read 64 bytes to fit response in 256-byte buffer)
-    // Response encoding: 5 header + 6 bytes per 4 data bytes = 5 + 96 = 101 bytes for 64 bytes
-    uint8_t mem_buffer[64];
-    r = cmd_0717_read_memory(handle, 0x00000000, 64, mem_buffer, sizeof(mem_buffer));
-    if (r != 0) return -1;
-    //     printf("==> Registers initialized\n\n");
-
-    // Lines 54-75: Additional BDM setup
-    //     printf("Step 6: Additional BDM setup...\n");
-    r = cmd_07_a2(handle, 0x01);
-    if (r != 0) return -1;
-    r = cmd_04_40_58_04(handle);
-    if (r != 0) return -1;
-    r = cmd_04_7f_fe_02(handle);
-    if (r != 0) return -1;
-    r = cmd_04_7f_fe_02(handle);
-    if (r != 0) return -1;
-    r = cmd_07_95(handle);
-    if (r != 0) return -1;
-    r = cmd_04_40_00_02(handle);
-    if (r != 0) return -1;
-    r = cmd_enable_memory_access(handle, 0x00);
-    if (r != 0) return -1;
-    r = cmd_enable_memory_access(handle, 0x00);
-    if (r != 0) return -1;
-    r = cmd_enter_mode(handle, 0xF8);
-    if (r != 0) return -1;
-    r = cmd_enter_mode(handle, 0xF0);
-    if (r != 0) return -1;
-    r = cmd_enter_mode(handle, 0xF8);
-    if (r != 0) return -1;
-    r = cmd_07_12(handle, 0x0000);
-    if (r != 0) return -1;
-
-    r = cmd_07_13(handle, 0x2D80, &reg_value);
-    if (r != 0) return -1;
-
-    r = cmd_07_11(handle, 0x1940, 0xFC, 0x0A, 0x00, 0x0A);
-    if (r != 0) return -1;
-    r = cmd_07_11(handle, 0x1940, 0x40, 0x11, 0x00, 0x0A);
-    if (r != 0) return -1;
-    r = cmd_07_11(handle, 0x1900, 0x40, 0x10, 0x00, 0x74);
-    if (r != 0) return -1;
-
-    uint8_t params2[] = {0x40, 0x10, 0x00, 0x74, 0x00, 0x0F};
-    r = cmd_07_15(handle, 0x1800, params2, 6);
-    if (r != 0) return -1;
-
-    r = cmd_07_12(handle, 0x0000);
-    if (r != 0) return -1;
-
-    // Register write/read tests
-    r = cmd_07_13(handle, 0x2188, &reg_value);
-    if (r != 0) return -1;
-    r = cmd_write_bdm_reg(handle, 0x2088, 0x12345678);
-    if (r != 0) return -1;
-    r = cmd_07_13(handle, 0x2188, &reg_value);
-    if (r != 0) return -1;
-    r = cmd_write_bdm_reg(handle, 0x2088, 0xAD95014D);
-    if (r != 0) return -1;
-
-    r = cmd_enter_mode(handle, 0xF8);
-    if (r != 0) return -1;
-
-    r = cmd_07_13(handle, 0x2180, &reg_value);
-    if (r != 0) return -1;
-    r = cmd_write_bdm_reg(handle, 0x2080, 0x12345678);
-    if (r != 0) return -1;
-    r = cmd_07_13(handle, 0x2180, &reg_value);
-    if (r != 0) return -1;
-    r = cmd_write_bdm_reg(handle, 0x2080, 0xCF206089);
-    if (r != 0) return -1;
-    //     printf("==> Additional setup complete\n\n");
-
-    // Lines 81-83: Initial verification reads
-    //     printf("Step 7: Initial verification...\n");
-    r = cmd_071b(handle, 0x00000000, 4, verify_buffer, sizeof(verify_buffer));
-    if (r != 0) return -1;
-    r = cmd_071b(handle, 0x00000004, 4, verify_buffer, sizeof(verify_buffer));
-    if (r != 0) return -1;
-
-    r = cmd_write_bdm_reg(handle, 0x208F, 0xDEADBEEF);
-    if (r != 0) return -1;
-    //     printf("==> Initial verification complete\n\n");
-
-    // Lines 84-109: BDM register configuration
-    //     printf("Step 8: BDM register configuration...\n");
-    r = cmd_07_14(handle, 0x2880, 0x00, 0x00, 0x08, 0x0F, 0xDEADBEEF);
-    if (r != 0) return -1;
-
-    r = cmd_07_12(handle, 0x0000);
-    if (r != 0) return -1;
-    r = cmd_07_11(handle, 0x2980, 0x00, 0x00, 0x08, 0x0F);
-    if (r != 0) return -1;
-
-    // Read registers 0x2180-0x218F again
-    for (uint16_t reg = 0x2180; reg <= 0x218F; reg++) {
-        r = cmd_07_13(handle, reg, &reg_value);
-        if (r != 0) return -1;
-    }
-    // Read 0x218D again (appears twice in sequence)
-    r = cmd_07_13(handle, 0x218D, &reg_value);
-    if (r != 0) return -1;
-
-    r = cmd_07_11(handle, 0x2980, 0x00, 0x00, 0x08, 0x0F);
-    if (r != 0) return -1;
-    r = cmd_07_11(handle, 0x2980, 0x00, 0x00, 0x08, 0x0E);
-    if (r != 0) return -1;
-
-    // Write BDM registers
-    r = cmd_07_14(handle, 0x2880, 0x00, 0x00, 0x08, 0x01, 0x20000000);
-    if (r != 0) return -1;
-    r = cmd_07_14(handle, 0x2880, 0x00, 0x00, 0x0C, 0x05, 0x20000221);
-    if (r != 0) return -1;
-    r = cmd_07_14(handle, 0x2880, 0x00, 0x00, 0x0C, 0x04, 0x00000021);
-    if (r != 0) return -1;
-    r = cmd_07_14(handle, 0x2880, 0x00, 0x00, 0x0C, 0x04, 0x00000021);
-    if (r != 0) return -1;
-
-    // Line 110: cmd_071e (9-byte format)
-    r = cmd_07_1e(handle, 0x0001, 0x40100074, 0x0F);
-    if (r != 0) return -1;
-
-    r = cmd_07_11(handle, 0x2980, 0x00, 0x00, 0x08, 0x01);
-    if (r != 0) return -1;
-    //     printf("==> BDM registers configured\n\n");
-
-    // Lines 112-138: Initial SRAM test pattern writes
-    //     printf("Step 9: Initial SRAM test patterns...\n");
-    const uint32_t TEST_MARKER = 0x4AC84E73;
-    const uint32_t MARKER_ADDR = 0x20000408;
-
-    uint32_t test_addrs[] = {
-        0x20000008, 0x2000000C, 0x20000010, 0x20000014,
-        0x20000020, 0x20000024, 0x20000028, 0x2000002C,
-        0x20000030
-    };
-
-    for (int i = 0; i < 9; i++) {
-        // Write marker address to test address
-        r = cmd_071e_write_sram(handle, test_addrs[i], MARKER_ADDR);
-        if (r != 0) return -1;
-
-        // Verify with cmd_071b
-        r = cmd_071b(handle, test_addrs[i], 4, verify_buffer, sizeof(verify_buffer));
-        if (r != 0) return -1;
-
-        // Write test marker
-        r = cmd_071e_write_sram(handle, MARKER_ADDR, TEST_MARKER);
-        if (r != 0) return -1;
-    }
-    //     printf("==> Initial SRAM test patterns written\n\n");
-
     printf("===========================================\n");
     printf("==> SRAM Pre-Initialization Complete\n");
     printf("===========================================\n\n");
@@ -2033,175 +2003,16 @@ int sram_pre_init(libusb_device_handle *handle) {
 }
 
 // SRAM Validation Sequence
-// Implements the 315-command SRAM validation sequence discovered from packet captures
+// Implements the SRAM validation sequence discovered from packet captures
 // This sequence is required before SRAM writes will work properly
 //
-// Pattern from RAM_INIT_SEQUENCE.txt (lines 139-454):
+// Pattern from RAM_INIT_SEQUENCE.txt (lines 139-454), table in init_seq.c:
 //   Phase 1: Write test patterns to key SRAM addresses
 //   Phase 2: Validation cycles with BDM configuration and verification
 //
 // Returns: 0 on success, -1 on error
 int sram_validation_sequence(libusb_device_handle *handle) {
-    int r;
-    uint8_t verify_buffer[4];
-    uint32_t reg_value;
-
-    // Silent SRAM validation sequence
-
-    // Phase 1: Write test patterns to SRAM
-    //     printf("Phase 1: Writing test patterns to SRAM...\n");
-    //     printf("-------------------------------------------\n");
-
-    // Test marker value and address
-    const uint32_t TEST_MARKER = 0x4AC84E73;
-    const uint32_t MARKER_ADDR = 0x20000408;
-
-    // Target addresses for validation
-    uint32_t target_addrs[] = {
-        0x20000034, 0x20000038, 0x2000003C, 0x20000060,
-        0x2000007C, 0x200000B8, 0x200000F4
-    };
-    int num_targets = sizeof(target_addrs) / sizeof(target_addrs[0]);
-
-    for (int i = 0; i < num_targets; i++) {
-        uint32_t target = target_addrs[i];
-
-    //         printf("\n[%d/%d] Testing address 0x%08X\n", i+1, num_targets, target);
-
-        // Step 1: Write test marker to marker address
-    //         printf("  Writing 0x%08X to 0x%08X...\n", TEST_MARKER, MARKER_ADDR);
-        r = cmd_071e_write_sram(handle, MARKER_ADDR, TEST_MARKER);
-        if (r != 0) {
-            fprintf(stderr, "   **FAILED to write test marker\n");
-            return -1;
-        }
-    //         printf("  ==> Test marker written\n");
-
-        // Step 2: Write marker address to target address
-    //         printf("  Writing 0x%08X to 0x%08X...\n", MARKER_ADDR, target);
-        r = cmd_071e_write_sram(handle, target, MARKER_ADDR);
-        if (r != 0) {
-            fprintf(stderr, "   **FAILED to write to target address\n");
-            return -1;
-        }
-    //         printf("  ==> Target address written\n");
-
-        // Step 3: Verify target address with cmd_071b
-    //         printf("  Verifying 0x%08X...\n", target);
-        r = cmd_071b(handle, target, 4, verify_buffer, sizeof(verify_buffer));
-        if (r != 0) {
-            fprintf(stderr, "   **FAILED to verify target address\n");
-            return -1;
-        }
-
-        uint32_t read_value = (verify_buffer[0] << 24) | (verify_buffer[1] << 16) |
-                              (verify_buffer[2] << 8) | verify_buffer[3];
-    //         printf("  Read back: 0x%08X\n", read_value);
-
-        if (read_value == MARKER_ADDR) {
-    //             printf("  ==> Verification passed!\n");
-        } else {
-            fprintf(stderr, "    Warning: Expected 0x%08X, got 0x%08X\n", MARKER_ADDR, read_value);
-        }
-    }
-
-    //      printf("\n ==> Phase 1 complete (%d addresses tested)\n", num_targets);
-
-    // Phase 2: Validation cycles
-    //      printf("\nPhase 2: Running validation cycles...\n");
-    //      printf("-------------------------------------------\n");
-
-    // Simplified validation cycle (run 3 times as a test)
-    for (int cycle = 0; cycle < 3; cycle++) {
-        // Silent cycle
-
-        // BDM configuration commands
-        r = cmd_07_12(handle, 0x0000);
-        if (r != 0) {
-            fprintf(stderr, "   cmd_07_12 **FAILED\n");
-            return -1;
-        }
-
-        r = cmd_07_11(handle, 0x2980, 0x00, 0x00, 0x08, 0x0f);
-        if (r != 0) {
-            fprintf(stderr, "   cmd_07_11 **FAILED (0x080f)\n");
-            return -1;
-        }
-
-        r = cmd_07_11(handle, 0x2980, 0x00, 0x00, 0x08, 0x01);
-        if (r != 0) {
-            fprintf(stderr, "   cmd_07_11 **FAILED (0x0801)\n");
-            return -1;
-        }
-
-        // Verify parameter address
-        r = cmd_071b(handle, 0x200000B8, 4, verify_buffer, sizeof(verify_buffer));
-        if (r != 0) {
-            fprintf(stderr, "   **FAILED to verify 0x200000B8\n");
-            return -1;
-        }
-        uint32_t param_value = (verify_buffer[0] << 24) | (verify_buffer[1] << 16) |
-                               (verify_buffer[2] << 8) | verify_buffer[3];
-    //         printf("  Parameter value: 0x%08X\n", param_value);
-
-        // Read register 0x2D80
-        r = cmd_07_13(handle, 0x2D80, &reg_value);
-        if (r != 0) {
-            fprintf(stderr, "   **FAILED to read register 0x2D80\n");
-            return -1;
-        }
-    //         printf("  Register 0x2D80: 0x%08X\n", reg_value);
-
-        // BDM configuration
-        r = cmd_07_11(handle, 0x2980, 0x00, 0x00, 0x08, 0x0f);
-        if (r != 0) {
-            fprintf(stderr, "   cmd_07_11 **FAILED (0x080f)\n");
-            return -1;
-        }
-
-        // Verify test marker
-        r = cmd_071b(handle, 0xDEADBEEF, 4, verify_buffer, sizeof(verify_buffer));
-        if (r != 0) {
-            fprintf(stderr, "   **FAILED to verify test marker\n");
-            return -1;
-        }
-        uint32_t marker = (verify_buffer[0] << 24) | (verify_buffer[1] << 16) |
-                          (verify_buffer[2] << 8) | verify_buffer[3];
-                 printf("  Test marker value: 0x%08X\n", marker);
-
-        if (marker == 0xDEADBEEF) {
-           printf("  ==> Test marker verified!\n");
-        }
-
-        // Read registers 0x2180-0x218F (16 sequential reads)
-        for (uint16_t reg = 0x2180; reg <= 0x218F; reg++) {
-            r = cmd_07_13(handle, reg, &reg_value);
-            if (r != 0) {
-                fprintf(stderr, "   **FAILED to read register 0x%04X\n", reg);
-                return -1;
-            }
-        }
-    //         printf("  ==> Read 16 registers\n");
-
-        // Final BDM configuration for this cycle
-        r = cmd_07_11(handle, 0x2980, 0x00, 0x00, 0x08, 0x0f);
-        if (r != 0) {
-            fprintf(stderr, "   cmd_07_11 **FAILED (0x080f)\n");
-            return -1;
-        }
-
-        r = cmd_07_11(handle, 0x2980, 0x00, 0x00, 0x08, 0x0e);
-        if (r != 0) {
-            fprintf(stderr, "   cmd_07_11 **FAILED (0x080e)\n");
-            return -1;
-        }
-
-    //         printf("  ==> Cycle %d complete\n", cycle + 1);
-    }
-
-    //         printf("\n ==> Phase 2 complete (3 validation cycles)\n");
-
-    return 0;
+    return init_seq_run(handle, INIT_SEQ_SRAM_VALIDATION);
 }
 
 // Complete SRAM Initialization
@@ -2211,6 +2022,10 @@ int sram_validation_sequence(libusb_device_handle *handle) {
 // Returns: 0 on success, -1 on error
 int sram_init_full(libusb_device_handle *handle) {
     int r;
+    struct timespec mark;
+    double total_ms = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &mark);
 
     // Step 1: Pre-initialization (lines 1-138) - silent
     r = sram_pre_init(handle);
@@ -2218,6 +2033,7 @@ int sram_init_full(libusb_device_handle *handle) {
         fprintf(stderr, "SRAM pre-init **FAILED\n");
         return -1;
     }
+    phase_report("SRAM pre-init", &mark, &total_ms);
 
     // Step 2: Validation sequence (lines 139-454) - silent
     r = sram_validation_sequence(handle);
@@ -2225,8 +2041,9 @@ int sram_init_full(libusb_device_handle *handle) {
         fprintf(stderr, "SRAM validation **FAILED\n");
         return -1;
     }
+    phase_report("SRAM validation", &mark, &total_ms);
 
-    printf("SRAM initialized\n");
+    printf("SRAM initialized (%.1f ms)\n", total_ms);
     return 0;
 }
 
@@ -2980,6 +2797,72 @@ int cmd_setup_memory_windows_full(libusb_device_handle *handle) {
     return 0;
 }
 
+// Identify the part from the CIR, falling back to the BDM CSR
+// Sets *flash_size_kb and *prn (-1 if unknown), returns the part name
+static const char *identify_part(libusb_device_handle *handle, uint32_t chip_id,
+                                 uint32_t *flash_size_kb, int *prn) {
+    // Read Chip Identification Register (CIR) at IPSBAR + 0x11000A
+    // CIR contains: PIN (Part ID Number) in bits 15-6, PRN (Part Revision) in bits 5-0
+    // IPSBAR = 0x40000000, so CIR = 0x4011000A
+    // Must be read AFTER memory windows are configured for peripheral access
+    // Note: Read 32-bit aligned address 0x40110008 (contains RCON at +0, CIR at +2)
+    // Big-endian: RCON in bits 31-16, CIR in bits 15-0
+    // IMPORTANT: CIR reads as 0 until firmware initializes IPSBAR with valid bit!
+    // We cannot read CIR reliably during BDM init before firmware runs.
+    // Use the BDM ID register (0x2D80) for chip detection instead.
+    uint32_t ccm_regs = 0;
+    uint16_t cir_value = 0;
+    int r = cmd_read_memory_long_addr(handle, 0x40110008, &ccm_regs);
+    if (r == 0 && ccm_regs != 0) {
+        cir_value = ccm_regs & 0xFFFF;  // CIR is in lower 16 bits (big-endian, at offset 0xA)
+    }
+    const char *part_name = NULL;
+    *prn = -1;
+
+    if (r == 0 && cir_value != 0) {
+        uint16_t pin = (cir_value >> 6) & 0x3FF;  // Part ID Number (bits 15-6)
+        *prn = cir_value & 0x3F;                  // Part Revision Number (bits 5-0)
+
+        switch (pin) {
+            case 0x48: part_name = "MCF52230"; break;
+            case 0x49: part_name = "MCF52231"; break;
+            case 0x4A: part_name = "MCF52233"; break;
+            case 0x4B: part_name = "MCF52234"; break;
+            case 0x4C: part_name = "MCF52235"; break;
+            default:   part_name = NULL;       break;
+        }
+
+        // Determine flash size based on part number
+        // MCF52230/52231: 64KB flash, 16KB SRAM
+        // MCF52233:       256KB flash, 32KB SRAM
+        // MCF52234/52235: 256KB flash, 32KB SRAM
+        switch (pin) {
+            case 0x48:  // MCF52230
+            case 0x49:  // MCF52231
+                *flash_size_kb = 64;
+                break;
+            case 0x4A:  // MCF52233
+            case 0x4B:  // MCF52234
+            case 0x4C:  // MCF52235
+            default:
+                *flash_size_kb = 256;
+                break;
+        }
+    }
+
+    // Fallback to BDM chip ID if CIR not available
+    // BDM CSR (0x2D80) format: 0x01900000 = MCF5223x family
+    if (part_name == NULL) {
+        *flash_size_kb = 256;
+        if ((chip_id & 0xFFF00000) == 0x01900000) {
+            part_name = "MCF5223x";  // Generic MCF5223x (CIR unavailable)
+        } else {
+            part_name = "ColdFire V2";
+        }
+    }
+    return part_name;
+}
+
 /**
  * Comprehensive Target Initialization
  *
@@ -2996,6 +2879,10 @@ int cmd_setup_memory_windows_full(libusb_device_handle *handle) {
 int target_init_full(libusb_device_handle *handle, uint32_t *flash_size_kb) {
     int r;
     uint32_t chip_id = 0;
+    struct timespec mark;
+    double total_ms = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &mark);
 
     printf("\n");
     printf("========================================\n");
@@ -3066,7 +2953,7 @@ int target_init_full(libusb_device_handle *handle, uint32_t *flash_size_kb) {
         return -1;
     }
 
-    //     printf("==> Phase 1 complete\n\n");
+    phase_report("Phase 1: BDM mode entry", &mark, &total_ms);
 
     // Phase 2: Re-initialization Cycle
     //     printf("=== Phase 2: BDM Re-initialization ===\n");
@@ -3085,7 +2972,7 @@ int target_init_full(libusb_device_handle *handle, uint32_t *flash_size_kb) {
         return -1;
     }
 
-    //     printf("==> Phase 2 complete\n\n");
+    phase_report("Phase 2: BDM re-initialization", &mark, &total_ms);
 
     // Phase 3: Mode Configuration
     //     printf("=== Phase 3: Mode Configuration ===\n");
@@ -3118,7 +3005,7 @@ int target_init_full(libusb_device_handle *handle, uint32_t *flash_size_kb) {
         return -1;
     }
 
-    //     printf("==> Phase 3 complete\n\n");
+    phase_report("Phase 3: Mode configuration", &mark, &total_ms);
 
     // Phase 4: Chip ID Detection
     //     printf("=== Phase 4: Chip ID Detection ===\n");
@@ -3229,7 +3116,7 @@ int target_init_full(libusb_device_handle *handle, uint32_t *flash_size_kb) {
     }
 
     //     printf("==> System configuration complete\n");
-    //     printf("==> Phase 4 complete\n\n");
+    phase_report("Phase 4: Chip ID and system config", &mark, &total_ms);
 
     // Phase 5: RAM Test
     //     printf("=== Phase 5: RAM Test ===\n");
@@ -3277,7 +3164,7 @@ int target_init_full(libusb_device_handle *handle, uint32_t *flash_size_kb) {
         }
     }
 
-    //          printf("==> Phase 5 complete (RAM test attempted)\n\n");
+    phase_report("Phase 5: RAM test", &mark, &total_ms);
 
     // Phase 6: Final BDM Resume
     r = cmd_07_a2(handle, 0x01);
@@ -3293,6 +3180,7 @@ int target_init_full(libusb_device_handle *handle, uint32_t *flash_size_kb) {
         fprintf(stderr, "**FAILED during final BDM resume\n");
         return -1;
     }
+    phase_report("Phase 6: Final BDM resume", &mark, &total_ms);
 
     // Phase 7: Pre-Flashloader Mode Config
     r = cmd_enter_mode(handle, 0xF8);
@@ -3307,6 +3195,7 @@ int target_init_full(libusb_device_handle *handle, uint32_t *flash_size_kb) {
     // CRUCIAL: 50ms delay after last Enter Mode 0xF8 before memory windows!
     printf("Waiting 50ms for BDM to settle...\n");
     usleep(50000);
+    phase_report("Phase 7: Pre-flashloader mode config", &mark, &total_ms);
 
     // Phase 8: Memory Window Setup (CRUCIAL FOR SRAM ACCESS)
     printf("Configuring memory windows for SRAM access via short addresses...\n");
@@ -3363,68 +3252,11 @@ int target_init_full(libusb_device_handle *handle, uint32_t *flash_size_kb) {
         }
     }
 
-    //          printf("==> Phase 8 complete\n\n");
-    //          printf("==> Phase 7 complete\n\n");
+    phase_report("Phase 8: Memory window setup", &mark, &total_ms);
 
-    // Read Chip Identification Register (CIR) at IPSBAR + 0x11000A
-    // CIR contains: PIN (Part ID Number) in bits 15-6, PRN (Part Revision) in bits 5-0
-    // IPSBAR = 0x40000000, so CIR = 0x4011000A
-    // Must be read AFTER memory windows are configured for peripheral access
-    // Note: Read 32-bit aligned address 0x40110008 (contains RCON at +0, CIR at +2)
-    // Big-endian: RCON in bits 31-16, CIR in bits 15-0
-    // IMPORTANT: CIR reads as 0 until firmware initializes IPSBAR with valid bit!
-    // We cannot read CIR reliably during BDM init before firmware runs.
-    // Use the BDM ID register (0x2D80) for chip detection instead.
-    uint32_t ccm_regs = 0;
-    uint16_t cir_value = 0;
-    r = cmd_read_memory_long_addr(handle, 0x40110008, &ccm_regs);
-    if (r == 0 && ccm_regs != 0) {
-        cir_value = ccm_regs & 0xFFFF;  // CIR is in lower 16 bits (big-endian, at offset 0xA)
-    }
-    const char *part_name = NULL;
-    int prn = -1;
-
-    if (r == 0 && cir_value != 0) {
-        uint16_t pin = (cir_value >> 6) & 0x3FF;  // Part ID Number (bits 15-6)
-        prn = cir_value & 0x3F;                   // Part Revision Number (bits 5-0)
-
-        switch (pin) {
-            case 0x48: part_name = "MCF52230"; break;
-            case 0x49: part_name = "MCF52231"; break;
-            case 0x4A: part_name = "MCF52233"; break;
-            case 0x4B: part_name = "MCF52234"; break;
-            case 0x4C: part_name = "MCF52235"; break;
-            default:   part_name = NULL;       break;
-        }
-
-        // Determine flash size based on part number
-        // MCF52230/52231: 64KB flash, 16KB SRAM
-        // MCF52233:       256KB flash, 32KB SRAM
-        // MCF52234/52235: 256KB flash, 32KB SRAM
-        switch (pin) {
-            case 0x48:  // MCF52230
-            case 0x49:  // MCF52231
-                *flash_size_kb = 64;
-                break;
-            case 0x4A:  // MCF52233
-            case 0x4B:  // MCF52234
-            case 0x4C:  // MCF52235
-            default:
-                *flash_size_kb = 256;
-                break;
-        }
-    }
-
-    // Fallback to BDM chip ID if CIR not available
-    // BDM CSR (0x2D80) format: 0x01900000 = MCF5223x family
-    if (part_name == NULL) {
-        *flash_size_kb = 256;
-        if ((chip_id & 0xFFF00000) == 0x01900000) {
-            part_name = "MCF5223x";  // Generic MCF5223x (CIR unavailable)
-        } else {
-            part_name = "ColdFire V2";
-        }
-    }
+    int prn;
+    const char *part_name = identify_part(handle, chip_id, flash_size_kb, &prn);
+    phase_report("Part identification", &mark, &total_ms);
 
     printf("========================================\n");
     printf("  Initialization Complete!\n");
@@ -3434,7 +3266,69 @@ int target_init_full(libusb_device_handle *handle, uint32_t *flash_size_kb) {
         printf("  Chip: %s\n", part_name);
     }
     printf("  Flash Size: %u KB\n", *flash_size_kb);
+    printf("  Init time: %.1f ms\n", total_ms);
     printf("========================================\n\n");
 
     return 0;
 }
+
+/**
+ * Fast Target Attach
+ *
+ * Probes whether the target is still halted in BDM with the memory windows
+ * configured (e.g. from a previous session on the same probe). If so, only
+ * the part identification is redone and the full replay sequence is skipped.
+ * Falls back to target_init_full() on cold start or if any probe step fails.
+ *
+ * The probe is non-destructive: A0 is used for the window test (the same
+ * WAREG 0x2088 / RAREG 0x2188 pair the full init verifies with) and is
+ * restored afterwards.
+ *
+ * Returns 0 on success, -1 on failure
+ * Populates flash_size_kb with detected flash size (64 or 256)
+ */
+int target_attach(libusb_device_handle *handle, uint32_t *flash_size_kb) {
+    struct timespec mark;
+    double total_ms = 0;
+    uint8_t frozen = 0;
+    uint32_t csr = 0, saved_a0 = 0, check = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &mark);
+
+    // 1. Target halted in BDM?
+    if (cmd_bdm_freeze(handle, &frozen) != 0 || !frozen) {
+        printf("Attach: target not halted in BDM, running full init\n");
+        return target_init_full(handle, flash_size_kb);
+    }
+
+    // 2. CSR readable and reporting a ColdFire debug module (HRL != 0)
+    if (cmd_07_13(handle, 0x2D80, &csr) != 0 ||
+        csr == 0xFFFFFFFF || (csr & 0x00F00000) == 0) {
+        printf("Attach: CSR not valid (0x%08X), running full init\n", csr);
+        return target_init_full(handle, flash_size_kb);
+    }
+
+    // 3. Memory windows still configured: round-trip a pattern through A0
+    int r = cmd_07_13(handle, 0x2188, &saved_a0);
+    r |= cmd_write_memory_short_addr(handle, 0x2088, ~saved_a0);
+    r |= cmd_07_13(handle, 0x2188, &check);
+    r |= cmd_write_memory_short_addr(handle, 0x2088, saved_a0);
+    if (r != 0 || check != ~saved_a0) {
+        printf("Attach: memory window test failed, running full init\n");
+        return target_init_full(handle, flash_size_kb);
+    }
+    phase_report("Attach: BDM/CSR/window probe", &mark, &total_ms);
+
+    int prn;
+    const char *part_name = identify_part(handle, csr, flash_size_kb, &prn);
+    phase_report("Attach: part identification", &mark, &total_ms);
+
+    if (prn >= 0) {
+        printf("Attached to halted target: %s (rev.%d), %u KB flash, %.1f ms\n",
+               part_name, prn, *flash_size_kb, total_ms);
+    } else {
+        printf("Attached to halted target: %s, %u KB flash, %.1f ms\n",
+               part_name, *flash_size_kb, total_ms);
+    }
+    return 0;
+}
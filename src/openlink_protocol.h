@@ -13,9 +13,14 @@
 extern int g_openlink_verbose;
 void openlink_set_verbose(int level);
 
+// Persistent command buffer - leftover response bytes are resent with the
+// next command (see openlink_protocol.c)
+extern unsigned char g_cmd_buffer[256];
+
 // Function Prototypes
 void print_hex(unsigned char* data, int size);
 void print_as_ascii(unsigned char* data, int size);
+int validate_response(unsigned char *buffer, int length, int min_length, uint16_t *response_type);
 
 int usb_reset(libusb_device_handle *dev);
 int send_bb_command(libusb_device_handle *handle, unsigned char *cmd_data, int cmd_len, const char *cmd_name);
@@ -36,6 +41,18 @@ int cmd_read_memory_long_addr(libusb_device_handle *handle, uint32_t addr, uint3
 int cmd_0717_read_memory(libusb_device_handle *handle, uint32_t addr, uint16_t length,
                          uint8_t *buffer, int buffer_size);
 
+// Block Memory Read (cmd_0717 with multi-packet response)
+// Reads up to OPENLINK_READ_BLOCK_MAX bytes in one request.
+// openlink_read_block_size() probes (once) for the largest block the probe
+// returns intact; openlink_read_memory() reads any length in such blocks.
+#define OPENLINK_READ_BLOCK_MIN 128
+#define OPENLINK_READ_BLOCK_MAX 4096
+int cmd_0717_read_block(libusb_device_handle *handle, uint32_t addr, uint32_t length,
+                        uint8_t *buffer);
+int openlink_read_block_size(libusb_device_handle *handle);
+int openlink_read_memory(libusb_device_handle *handle, uint32_t addr, uint32_t length,
+                         uint8_t *buffer);
+
 // Memory Read/Verify Command (cmd_071b) - Used in SRAM validation sequence
 // Similar to cmd_0717 but used for verification operations (82 times in SRAM validation)
 // Returns data in buffer. Response format is 99 66 (standard format).
@@ -54,6 +71,8 @@ int cmd_set_memory_window(libusb_device_handle *handle, uint32_t window_addr);
 int cmd_download_block(libusb_device_handle *handle, uint32_t address, unsigned char *data, int length);
 int cmd_download_block_single(libusb_device_handle *handle, uint32_t address, unsigned char *data, int length);  // Single large transfer
 int cmd_download_block_chunk(libusb_device_handle *handle, uint32_t address, unsigned char *data, int length);  // Single chunk upload
+int openlink_write_memory(libusb_device_handle *handle, uint32_t addr,
+                          const uint8_t *data, uint32_t length);  // RAM: bb 66 body, 07 19 head/tail
 int cmd_bdm_resume(libusb_device_handle *handle);
 int cmd_07_02_bdm_go(libusb_device_handle *handle);  // BDM GO command to execute flashloader
 int cmd_07_14_write_bdm_reg(libusb_device_handle *handle, uint16_t reg, uint32_t value);  // Write BDM register (e.g., PC)
@@ -98,6 +117,10 @@ int cmd_04_40_00_02(libusb_device_handle *handle);
 // Comprehensive Initialization
 int target_init_full(libusb_device_handle *handle, uint32_t *flash_size_kb);
 
+// Fast attach - skips the full sequence if the target is already halted
+// and configured, otherwise falls back to target_init_full()
+int target_attach(libusb_device_handle *handle, uint32_t *flash_size_kb);
+
 // Memory Window Setup - Full sequence (required for SRAM parameter writes)
 int cmd_setup_memory_windows_full(libusb_device_handle *handle);
 
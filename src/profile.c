@@ -0,0 +1,222 @@
+/*
+ * PC-Sampling Profiler for OpenLink ColdFire
+ *
+ * License: GPL v3
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "profile.h"
+#include "log.h"
+
+#define PROFILE_NAME_MAX    64
+#define PROFILE_SLOTS_INIT  256
+
+int profile_init(profile_t *p, const symbol_table_t *syms) {
+    memset(p, 0, sizeof(*p));
+    p->syms = syms;
+    p->self = calloc(syms->count + 1, sizeof(uint32_t));
+    p->total = calloc(syms->count + 1, sizeof(uint32_t));
+    p->stacks = calloc(PROFILE_SLOTS_INIT, sizeof(profile_stack_t));
+    p->stack_slots = PROFILE_SLOTS_INIT;
+    if (!p->self || !p->total || !p->stacks) {
+        profile_free(p);
+        return -1;
+    }
+    return 0;
+}
+
+/* Function index of a frame; callers are looked up at their call
+ * instruction, which ends right before the return address
+ */
+static int frame_index(const profile_t *p, uint32_t addr, int is_return) {
+    const elf_symbol_t *sym = symbol_at(p->syms, is_return ? addr - 2 : addr);
+    return sym ? (int)(sym - p->syms->syms) : p->syms->count;
+}
+
+static uint32_t hash_string(const char *s) {
+    uint32_t h = 2166136261u;   /* FNV-1a */
+    while (*s) {
+        h = (h ^ (uint8_t)*s++) * 16777619u;
+    }
+    return h;
+}
+
+static profile_stack_t *stack_slot(profile_stack_t *table, uint32_t slots, const char *stack) {
+    uint32_t i = hash_string(stack) & (slots - 1);
+    while (table[i].stack && strcmp(table[i].stack, stack) != 0) {
+        i = (i + 1) & (slots - 1);
+    }
+    return &table[i];
+}
+
+/* Double the table once it is 70% full */
+static int stacks_grow(profile_t *p) {
+    if ((p->num_stacks + 1) * 10 < p->stack_slots * 7) {
+        return 0;
+    }
+    uint32_t slots = p->stack_slots * 2;
+    profile_stack_t *table = calloc(slots, sizeof(profile_stack_t));
+    if (!table) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < p->stack_slots; i++) {
+        if (p->stacks[i].stack) {
+            *stack_slot(table, slots, p->stacks[i].stack) = p->stacks[i];
+        }
+    }
+    free(p->stacks);
+    p->stacks = table;
+    p->stack_slots = slots;
+    return 0;
+}
+
+void profile_add(profile_t *p, const uint32_t *frames, int depth) {
+    int index[PROFILE_MAX_DEPTH];
+    char stack[PROFILE_MAX_DEPTH * PROFILE_NAME_MAX];
+    int pos = 0;
+
+    if (depth < 1) {
+        return;
+    }
+    if (depth > PROFILE_MAX_DEPTH) {
+        depth = PROFILE_MAX_DEPTH;
+    }
+    for (int i = 0; i < depth; i++) {
+        index[i] = frame_index(p, frames[i], i > 0);
+    }
+
+    p->samples++;
+    p->self[index[0]]++;
+
+    /* Total counts each function once per sample, even when recursive */
+    for (int i = 0; i < depth; i++) {
+        int seen = 0;
+        for (int j = 0; j < i && !seen; j++) {
+            seen = (index[j] == index[i]);
+        }
+        if (!seen) {
+            p->total[index[i]]++;
+        }
+    }
+
+    /* Folded stacks run from the outermost caller to the sampled PC */
+    stack[0] = '\0';
+    for (int i = depth - 1; i >= 0; i--) {
+        const char *sep = (i == depth - 1) ? "" : ";";
+        if (index[i] < p->syms->count) {
+            pos += snprintf(stack + pos, sizeof(stack) - pos, "%s%s", sep, p->syms->syms[index[i]].name);
+        } else {
+            pos += snprintf(stack + pos, sizeof(stack) - pos, "%s0x%08x", sep, frames[i]);
+        }
+        if (pos >= (int)sizeof(stack)) {
+            break;
+        }
+    }
+
+    if (stacks_grow(p) != 0) {
+        return;
+    }
+    profile_stack_t *slot = stack_slot(p->stacks, p->stack_slots, stack);
+    if (!slot->stack) {
+        slot->stack = strdup(stack);
+        if (!slot->stack) {
+            return;
+        }
+        p->num_stacks++;
+    }
+    slot->count++;
+}
+
+/* Functions with samples, hottest first */
+static const profile_t *sort_profile;
+
+static int compare_self(const void *a, const void *b) {
+    int ia = *(const int *)a, ib = *(const int *)b;
+    uint32_t sa = sort_profile->self[ia], sb = sort_profile->self[ib];
+    if (sa != sb) {
+        return sa < sb ? 1 : -1;
+    }
+    return sort_profile->total[ib] > sort_profile->total[ia] ? 1 : -1;
+}
+
+int profile_write(const profile_t *p, const char *prefix, const char *header,
+                  char *top, size_t top_size, int top_n) {
+    char path[1024];
+    size_t top_len = 0;
+    int num = 0;
+    int *order = malloc((p->syms->count + 1) * sizeof(int));
+    if (!order) {
+        return -1;
+    }
+    for (int i = 0; i <= p->syms->count; i++) {
+        if (p->total[i]) {
+            order[num++] = i;
+        }
+    }
+    sort_profile = p;
+    qsort(order, num, sizeof(int), compare_self);
+    if (top && top_size) {
+        top[0] = '\0';
+    }
+
+    snprintf(path, sizeof(path), "%s.txt", prefix);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        LOG_ERROR(LOG_TOOL, "%s: %s\n", path, strerror(errno));
+        free(order);
+        return -1;
+    }
+    if (header) {
+        fprintf(f, "%s\n", header);
+    }
+    fprintf(f, "%7s %8s %7s %8s  %s\n", "self%", "self", "total%", "total", "function");
+    for (int i = 0; i < num; i++) {
+        int idx = order[i];
+        const char *name = idx < p->syms->count ? p->syms->syms[idx].name : "[unknown]";
+        double self_pct = p->samples ? 100.0 * p->self[idx] / p->samples : 0.0;
+        double total_pct = p->samples ? 100.0 * p->total[idx] / p->samples : 0.0;
+        fprintf(f, "%6.2f%% %8u %6.2f%% %8u  %s\n", self_pct, p->self[idx], total_pct, p->total[idx], name);
+        if (top && i < top_n && p->self[idx] && top_len < top_size) {
+            top_len += snprintf(top + top_len, top_size - top_len, "  %6.2f%% %8u  %s\n",
+                                self_pct, p->self[idx], name);
+        }
+    }
+    int r = fclose(f);
+    free(order);
+    if (r != 0) {
+        LOG_ERROR(LOG_TOOL, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "%s.folded", prefix);
+    f = fopen(path, "w");
+    if (!f) {
+        LOG_ERROR(LOG_TOOL, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    for (uint32_t i = 0; i < p->stack_slots; i++) {
+        if (p->stacks[i].stack) {
+            fprintf(f, "%s %u\n", p->stacks[i].stack, p->stacks[i].count);
+        }
+    }
+    if (fclose(f) != 0) {
+        LOG_ERROR(LOG_TOOL, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void profile_free(profile_t *p) {
+    if (p->stacks) {
+        for (uint32_t i = 0; i < p->stack_slots; i++) {
+            free(p->stacks[i].stack);
+        }
+    }
+    free(p->stacks);
+    free(p->self);
+    free(p->total);
+    memset(p, 0, sizeof(*p));
+}
@@ -0,0 +1,70 @@
+/*
+ * PC-Sampling Profiler for OpenLink ColdFire
+ *
+ * Collects sampled call stacks (PC first, then return addresses) and
+ * resolves them against the firmware's ELF symbols. The results are
+ * written as:
+ *
+ *   <prefix>.txt       flat profile: self and total samples per function
+ *   <prefix>.folded    one "outer;...;inner count" line per distinct stack,
+ *                      the input format of flamegraph.pl / speedscope
+ *
+ * License: GPL v3
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "file_loader.h"
+
+#define PROFILE_MAX_DEPTH   32
+
+typedef struct {
+    char *stack;                    /* Folded frame names, NULL = free slot */
+    uint32_t count;
+} profile_stack_t;
+
+typedef struct {
+    const symbol_table_t *syms;
+    uint32_t *self;                 /* Per symbol, [syms->count] = unknown */
+    uint32_t *total;
+    profile_stack_t *stacks;        /* Hash table of folded stacks */
+    uint32_t stack_slots;           /* Power of two */
+    uint32_t num_stacks;
+    uint32_t samples;
+} profile_t;
+
+/*
+ * Start a profile
+ *
+ * @param p             Profile to initialize (free with profile_free())
+ * @param syms          Symbols to resolve against, kept by reference
+ * @return              0 on success, -1 on error
+ */
+int profile_init(profile_t *p, const symbol_table_t *syms);
+
+/*
+ * Add one sample
+ *
+ * @param frames        frames[0] = PC, then return addresses outwards
+ * @param depth         Number of frames (at least 1)
+ */
+void profile_add(profile_t *p, const uint32_t *frames, int depth);
+
+/*
+ * Write <prefix>.txt and <prefix>.folded
+ *
+ * @param header        Text put at the top of the flat profile (may be NULL)
+ * @param top           Output, one line per hottest function (may be NULL)
+ * @param top_size      Size of top
+ * @param top_n         Number of functions listed in top
+ * @return              0 on success, -1 on error
+ */
+int profile_write(const profile_t *p, const char *prefix, const char *header,
+                  char *top, size_t top_size, int top_n);
+
+void profile_free(profile_t *p);
+
+#endif /* PROFILE_H */
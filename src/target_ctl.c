@@ -0,0 +1,208 @@
+/*
+ * BDM Target Control for OpenLink ColdFire
+ *
+ * Halt, resume polling, single step and the BDM register maps, as used
+ * by both m68k-gdbserver and libopenlink.
+ *
+ * License: GPL v3
+ */
+
+#include <unistd.h>
+#include "target_ctl.h"
+#include "openlink_protocol.h"
+#include "log.h"
+
+int target_read_csr(libusb_device_handle *handle, uint32_t *csr) {
+    return cmd_07_13(handle, CSR_READ, csr);
+}
+
+int target_write_csr(libusb_device_handle *handle, uint32_t csr) {
+    /* Use cmd_07_14_write_bdm_reg which uses the proper BDM register write protocol
+     * with window base 0x28800000 (command 07 14), not memory write (command 07 16)
+     */
+    return cmd_07_14_write_bdm_reg(handle, CSR_WRITE, csr);
+}
+
+/* Read a ColdFire CPU register via BDM
+ * - PC: cmd_read_pc() (uses 07 11 with window 0x2980)
+ *   Note: cmd_07_13 with 0x298F returns stale data after a PC write!
+ * - SR: cmd_read_sr() (uses 07 11 with window 0x2980)
+ * - D0-D7, A0-A7: cmd_07_13() with the READ addresses from the
+ *   MCF52235 Reference Manual, 0x218{A/D,Reg[2:0]}:
+ *   D0-D7: 0x2180-0x2187, A0-A7: 0x2188-0x218F
+ */
+int target_reg_read(libusb_device_handle *handle, int reg, uint32_t *value) {
+    if (reg == TARGET_REG_PC) {
+        return cmd_read_pc(handle, value);
+    }
+    if (reg == TARGET_REG_SR) {
+        return cmd_read_sr(handle, value);
+    }
+    if (reg < TARGET_REG_D0 || reg > TARGET_REG_A7) {
+        return -1;
+    }
+    return cmd_07_13(handle, 0x2180 + reg, value);
+}
+
+/* Write a ColdFire CPU register via BDM
+ * Uses cmd_write_pc() for PC (includes sync), cmd_07_14_write_bdm_reg for others
+ *
+ * BDM Store (write) register addresses:
+ *   D0-D7: 0x0180-0x0187
+ *   A0-A6: 0x0188-0x018E
+ *   A7:    0x018F (active stack pointer)
+ *   PC:    0x080F (handled by cmd_write_pc)
+ *   SR:    0x080E
+ */
+int target_reg_write(libusb_device_handle *handle, int reg, uint32_t value) {
+    if (reg == TARGET_REG_PC) {
+        return cmd_write_pc(handle, value);
+    }
+    if (reg == TARGET_REG_SR) {
+        return cmd_07_14_write_bdm_reg(handle, 0x080E, value);
+    }
+    if (reg < TARGET_REG_D0 || reg > TARGET_REG_A7) {
+        return -1;
+    }
+    return cmd_07_14_write_bdm_reg(handle, 0x0180 + reg, value);
+}
+
+int target_poll_halt(libusb_device_handle *handle, int check_csr, uint32_t *csr) {
+    uint8_t is_frozen = 0;
+    if (csr) {
+        *csr = 0;
+    }
+    if (cmd_bdm_freeze(handle, &is_frozen) != 0) {
+        return -1;
+    }
+    if (is_frozen) {
+        return 1;
+    }
+
+    /* CSR bit 24 (BKPT) is set when a hardware breakpoint triggers */
+    if (check_csr) {
+        uint32_t value = 0;
+        cmd_enter_mode(handle, 0xF8);
+        if (target_read_csr(handle, &value) == 0 && (value & CSR_BKPT)) {
+            if (csr) {
+                *csr = value;
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int target_wait_halt(libusb_device_handle *handle, int timeout_ms, uint32_t *csr) {
+    for (int i = 0; i <= timeout_ms; i++) {
+        int r = target_poll_halt(handle, (i % 10) == 9, csr);
+        if (r != 0) {
+            return r > 0 ? 0 : -1;
+        }
+        if (i < timeout_ms) {
+            usleep(1000);
+        }
+    }
+    return 1;
+}
+
+int target_halt(libusb_device_handle *handle) {
+    if (cmd_bdm_halt(handle) != 0) {
+        return -1;
+    }
+    /* Re-enter BDM mode after halt to enable register access */
+    cmd_enter_mode(handle, 0xF8);
+    return target_wait_halt(handle, 100, NULL) == 0 ? 0 : -1;
+}
+
+/*
+ * Reset BDM single-step capability using mode transition sequence.
+ *
+ * The Multilink USB-ML-12 firmware has an internal counter that limits single-step
+ * operations to 2 before getting stuck. The sequence F8->F0->F8 resets this
+ * counter. This is a workaround discovered through reverse engineering.
+ *
+ * The mode transitions don't affect CPU state (registers/memory) but do
+ * affect the BDM controller state. PC is preserved by reading it before
+ * and restoring it after the reset sequence.
+ */
+static void reset_single_step_capability(libusb_device_handle *handle) {
+    uint32_t saved_pc = 0;
+
+    /* Save current PC (mode transitions may affect it) */
+    int have_pc = cmd_read_pc(handle, &saved_pc) == 0;
+
+    /* Apply the magic reset sequence: F8 -> F0 -> F8 */
+    cmd_enter_mode(handle, 0xF8);
+    cmd_enter_mode(handle, 0xF0);
+    cmd_enter_mode(handle, 0xF8);
+
+    /* Restore PC */
+    if (have_pc) {
+        cmd_write_pc(handle, saved_pc);
+    }
+
+    LOG_INFO(LOG_RUN, "BDM single-step capability reset (PC=0x%08X)\n", saved_pc);
+}
+
+int target_step(libusb_device_handle *handle, int *step_count) {
+    /*
+     * BDM single-step workaround: The Multilink USB-ML-12 firmware has a 2-step
+     * limit before getting stuck. Reset the BDM state every 2 steps.
+     */
+    if (*step_count >= 2) {
+        reset_single_step_capability(handle);
+        *step_count = 0;
+    }
+
+    /* ColdFire single step sequence:
+     * 1. Read current CSR
+     * 2. Set SSM (Single Step Mode) bit
+     * 3. Write CSR
+     * 4. Execute GO command
+     * 5. Wait for target to halt
+     * 6. Clear SSM bit
+     */
+
+    /* Step 1: Read current CSR */
+    uint32_t csr = 0;
+    if (target_read_csr(handle, &csr) != 0) {
+        LOG_ERROR(LOG_RUN, "Failed to read CSR\n");
+        return -1;
+    }
+    LOG_DEBUG(LOG_RUN, "CSR before step: 0x%08X\n", csr);
+
+    /* Step 2-3: Set SSM bit and write */
+    csr |= CSR_SSM;
+    if (target_write_csr(handle, csr) != 0) {
+        LOG_ERROR(LOG_RUN, "Failed to write CSR with SSM\n");
+        return -1;
+    }
+
+    /* Step 4: Execute GO */
+    cmd_07_02_bdm_go(handle);
+
+    /* Step 5: Wait for auto-halt (single-step mode should halt after one instruction)
+     * The ColdFire should automatically halt when SSM is set, but we need to
+     * poll to detect when it happens
+     */
+    int halted = target_wait_halt(handle, 100, NULL) == 0;
+
+    /* Force halt if auto-halt didn't work */
+    if (!halted) {
+        LOG_WARN(LOG_RUN, "Auto-halt timeout, forcing halt\n");
+        cmd_bdm_halt(handle);
+    }
+
+    /* Step 6: Clear SSM bit */
+    if (target_read_csr(handle, &csr) == 0) {
+        csr &= ~CSR_SSM;
+        target_write_csr(handle, csr);
+        LOG_DEBUG(LOG_RUN, "CSR after step: 0x%08X\n", csr);
+    }
+
+    /* Increment step counter for BDM reset workaround */
+    (*step_count)++;
+
+    return halted ? 0 : -1;
+}
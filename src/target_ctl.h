@@ -0,0 +1,98 @@
+/*
+ * BDM Target Control for OpenLink ColdFire
+ *
+ * Run control and CPU register access over BDM, shared by m68k-gdbserver
+ * and libopenlink. Callers keep their own caches and bookkeeping (halt
+ * snapshots, breakpoints, flashloader state) on top of these calls.
+ *
+ * License: GPL v3
+ */
+
+#ifndef TARGET_CTL_H
+#define TARGET_CTL_H
+
+#include <stdint.h>
+#include <libusb-1.0/libusb.h>
+
+/* CPU registers, numbered as GDB and libopenlink number them */
+#define TARGET_REG_D0       0       /* D0-D7: 0-7 */
+#define TARGET_REG_A0       8       /* A0-A7: 8-15 */
+#define TARGET_REG_A7       15      /* Active stack pointer */
+#define TARGET_REG_SR       16
+#define TARGET_REG_PC       17
+#define TARGET_NUM_REGS     18
+
+/* CSR bit definitions for ColdFire V2 Debug Module */
+#define CSR_BSTAT_MASK  (0xF << 28) /* Breakpoint status */
+#define CSR_BSTAT_L1HIT (0x2 << 28) /* Level 1 breakpoint triggered */
+#define CSR_TRG     (1 << 26)   /* Halted by a debug module trigger */
+#define CSR_HALT    (1 << 25)   /* Halted by a HALT instruction */
+#define CSR_BKPT    (1 << 24)   /* Halted by BKPT (seen on trigger halts too) */
+#define CSR_SSM     (1 << 4)    /* Single Step Mode */
+#define CSR_READ    0x2D80      /* Read CSR address */
+#define CSR_WRITE   0x2C80      /* Write CSR address */
+
+/*
+ * Read or write the Debug Module CSR
+ *
+ * Reading the CSR clears its halt status bits.
+ */
+int target_read_csr(libusb_device_handle *handle, uint32_t *csr);
+int target_write_csr(libusb_device_handle *handle, uint32_t csr);
+
+/*
+ * Read a CPU register
+ *
+ * @param reg       TARGET_REG_* number
+ * @return          0 on success, -1 on error or an unknown register
+ */
+int target_reg_read(libusb_device_handle *handle, int reg, uint32_t *value);
+
+/*
+ * Write a CPU register
+ *
+ * @param reg       TARGET_REG_* number
+ * @return          0 on success, -1 on error or an unknown register
+ */
+int target_reg_write(libusb_device_handle *handle, int reg, uint32_t value);
+
+/*
+ * Check once whether the core has stopped
+ *
+ * Hardware breakpoint halts don't always show up as a BDM freeze, only
+ * in the CSR, so check_csr also reads the CSR for its BKPT bit.
+ *
+ * @param csr       Set to the CSR when the halt was seen there, else 0
+ *                  (may be NULL)
+ * @return          1 halted, 0 running, -1 on a probe error
+ */
+int target_poll_halt(libusb_device_handle *handle, int check_csr, uint32_t *csr);
+
+/*
+ * Poll until the core stops, checking the CSR every 10 ms
+ *
+ * @param csr       As for target_poll_halt() (may be NULL)
+ * @return          0 halted, 1 timeout, -1 on a probe error
+ */
+int target_wait_halt(libusb_device_handle *handle, int timeout_ms, uint32_t *csr);
+
+/*
+ * Stop the core and re-enter BDM mode for register access
+ *
+ * @return          0 once halted, -1 if it didn't stop within 100 ms
+ */
+int target_halt(libusb_device_handle *handle);
+
+/*
+ * Execute one instruction with the CSR single-step bit
+ *
+ * The Multilink firmware stalls after two steps unless its BDM mode is
+ * cycled, which target_step() does when *step_count reaches two.
+ *
+ * @param step_count  Steps since the last BDM mode reset, kept by the caller
+ * @return            0 if the core stopped by itself, -1 on error or when it
+ *                    had to be halted
+ */
+int target_step(libusb_device_handle *handle, int *step_count);
+
+#endif /* TARGET_CTL_H */
@@ -0,0 +1,144 @@
+/*
+ * Fake OpenLink probe for the server tests
+ *
+ * License: GPL v3
+ */
+
+#include <string.h>
+#include "../src/openlink_protocol.h"
+#include "fake_openlink.h"
+
+#define FAKE_CSR_READ   0x2D80
+#define FAKE_DRC_TDR    0x07
+
+fake_target_t fake = { .halted = 1 };
+
+
+int cmd_07_14_write_debug_reg(libusb_device_handle *handle, uint16_t reg, uint32_t value) {
+    (void)handle;
+    fake.debug_regs[reg & 0x1F] = value;
+    return 0;
+}
+
+int cmd_07_14_write_bdm_reg(libusb_device_handle *handle, uint16_t reg, uint32_t value) {
+    (void)handle; (void)reg; (void)value;
+    return 0;
+}
+
+int cmd_07_13(libusb_device_handle *handle, uint16_t reg, uint32_t *value) {
+    (void)handle;
+    *value = 0;
+    if (reg == FAKE_CSR_READ) {
+        *value = fake.csr;
+        fake.csr = 0;
+    }
+    return 0;
+}
+
+int cmd_07_12(libusb_device_handle *handle, uint16_t param) { (void)handle; (void)param; return 0; }
+
+int cmd_07_02_bdm_go(libusb_device_handle *handle) {
+    (void)handle;
+    fake.resumes++;
+    fake.tdr_at_resume = fake.debug_regs[FAKE_DRC_TDR];
+    fake.mem_fill += fake.mem_step;
+    /* The core stops again right away, for the reason set up by the test */
+    fake.halted = 1;
+    fake.csr = fake.halt_csr;
+    return 0;
+}
+
+int cmd_bdm_freeze(libusb_device_handle *handle, uint8_t *is_frozen) {
+    (void)handle;
+    *is_frozen = fake.halted;
+    return 0;
+}
+
+int cmd_bdm_halt(libusb_device_handle *handle) { (void)handle; fake.halted = 1; return 0; }
+int cmd_enter_mode(libusb_device_handle *handle, uint8_t mode) { (void)handle; (void)mode; return 0; }
+
+int cmd_07_11_read_bdm_reg(libusb_device_handle *handle, uint16_t window, uint16_t reg, uint32_t *value) {
+    (void)handle; (void)window; (void)reg;
+    *value = 0;
+    return 0;
+}
+
+int cmd_read_pc(libusb_device_handle *handle, uint32_t *pc_value) { (void)handle; *pc_value = 0x400; return 0; }
+int cmd_write_pc(libusb_device_handle *handle, uint32_t pc_value) { (void)handle; (void)pc_value; return 0; }
+
+int cmd_0717_read_memory(libusb_device_handle *handle, uint32_t addr, uint16_t length,
+                         uint8_t *buffer, int buffer_size) {
+    (void)handle; (void)addr; (void)buffer_size;
+    memset(buffer, fake.mem_fill, length);
+    return 0;
+}
+
+int openlink_read_memory(libusb_device_handle *handle, uint32_t addr, uint32_t length, uint8_t *buffer) {
+    (void)handle; (void)addr;
+    memset(buffer, fake.mem_fill, length);
+    return 0;
+}
+
+int openlink_write_memory(libusb_device_handle *handle, uint32_t addr, const uint8_t *data, uint32_t length) {
+    (void)handle; (void)addr; (void)data; (void)length;
+    return 0;
+}
+
+/* Not used by the tests */
+void openlink_set_verbose(int level) { (void)level; }
+unsigned char g_cmd_buffer[256];
+int g_openlink_verbose = 0;
+
+void print_hex(unsigned char* data, int size) { (void)data; (void)size; }
+void print_as_ascii(unsigned char* data, int size) { (void)data; (void)size; }
+int validate_response(unsigned char *buffer, int length, int min_length, uint16_t *response_type) { (void)buffer; (void)length; (void)min_length; (void)response_type; return 0; }
+int usb_reset(libusb_device_handle *dev) { (void)dev; return 0; }
+int send_bb_command(libusb_device_handle *handle, unsigned char *cmd_data, int cmd_len, const char *cmd_name) { (void)handle; (void)cmd_data; (void)cmd_len; (void)cmd_name; return 0; }
+int send_aa_command(libusb_device_handle *handle, unsigned char *cmd_data, int cmd_len, const char *cmd_name) { (void)handle; (void)cmd_data; (void)cmd_len; (void)cmd_name; return 0; }
+int cmd_write_memory_byte_addr(libusb_device_handle *handle, uint32_t addr, uint8_t data) { (void)handle; (void)addr; (void)data; return 0; }
+int cmd_read_memory_byte_addr(libusb_device_handle *handle, uint32_t addr, uint8_t *data) { (void)handle; (void)addr; (void)data; return 0; }
+int cmd_write_memory_word_addr(libusb_device_handle *handle, uint32_t addr, uint16_t data) { (void)handle; (void)addr; (void)data; return 0; }
+int cmd_read_memory_word_addr(libusb_device_handle *handle, uint32_t addr, uint16_t *data) { (void)handle; (void)addr; (void)data; return 0; }
+int cmd_write_memory_short_addr(libusb_device_handle *handle, uint16_t addr, uint32_t data) { (void)handle; (void)addr; (void)data; return 0; }
+int cmd_write_memory_long_addr(libusb_device_handle *handle, uint32_t addr, uint32_t data) { (void)handle; (void)addr; (void)data; return 0; }
+int cmd_read_memory_long_addr(libusb_device_handle *handle, uint32_t addr, uint32_t *data) { (void)handle; (void)addr; (void)data; return 0; }
+int cmd_0717_read_block(libusb_device_handle *handle, uint32_t addr, uint32_t length, uint8_t *buffer) { (void)handle; (void)addr; (void)length; (void)buffer; return 0; }
+int openlink_read_block_size(libusb_device_handle *handle) { (void)handle; return 0; }
+int cmd_071b(libusb_device_handle *handle, uint32_t addr, uint16_t length, uint8_t *buffer, int buffer_size) { (void)handle; (void)addr; (void)length; (void)buffer; (void)buffer_size; return 0; }
+int cmd_071b_read_sram_longword(libusb_device_handle *handle, uint32_t addr, uint32_t *value) { (void)handle; (void)addr; (void)value; return 0; }
+int cmd_set_memory_window(libusb_device_handle *handle, uint32_t window_addr) { (void)handle; (void)window_addr; return 0; }
+int cmd_download_block(libusb_device_handle *handle, uint32_t address, unsigned char *data, int length) { (void)handle; (void)address; (void)data; (void)length; return 0; }
+int cmd_download_block_single(libusb_device_handle *handle, uint32_t address, unsigned char *data, int length) { (void)handle; (void)address; (void)data; (void)length; return 0; }
+int cmd_download_block_chunk(libusb_device_handle *handle, uint32_t address, unsigned char *data, int length) { (void)handle; (void)address; (void)data; (void)length; return 0; }
+int cmd_bdm_resume(libusb_device_handle *handle) { (void)handle; return 0; }
+int cmd_bdm_reinit_after_execution(libusb_device_handle *handle) { (void)handle; return 0; }
+int cmd_07_95(libusb_device_handle *handle) { (void)handle; return 0; }
+int cmd_bdm_cmd_00_02(libusb_device_handle *handle) { (void)handle; return 0; }
+int cmd_enable_memory_access(libusb_device_handle *handle, uint8_t param) { (void)handle; (void)param; return 0; }
+int cmd_read_memory_block(libusb_device_handle *handle, uint32_t addr, uint8_t *buffer, int buffer_size) { (void)handle; (void)addr; (void)buffer; (void)buffer_size; return 0; }
+int cmd_07_17_setup_window(libusb_device_handle *handle, uint32_t addr) { (void)handle; (void)addr; return 0; }
+int cmd_07_1b(libusb_device_handle *handle, uint32_t addr, uint16_t size) { (void)handle; (void)addr; (void)size; return 0; }
+int cmd_01_0b(libusb_device_handle *handle) { (void)handle; return 0; }
+int cmd_07_1e(libusb_device_handle *handle, uint16_t p1, uint32_t p2, uint8_t p3) { (void)handle; (void)p1; (void)p2; (void)p3; return 0; }
+int cmd_071e_write_sram(libusb_device_handle *handle, uint32_t addr, uint32_t data) { (void)handle; (void)addr; (void)data; return 0; }
+int cmd_read_bdm_reg(libusb_device_handle *handle, uint16_t reg, uint16_t *value) { (void)handle; (void)reg; (void)value; return 0; }
+int cmd_write_bdm_reg(libusb_device_handle *handle, uint16_t reg, uint32_t data) { (void)handle; (void)reg; (void)data; return 0; }
+int cmd_07_11(libusb_device_handle *handle, uint16_t reg, uint8_t p1, uint8_t p2, uint8_t p3, uint8_t p4) { (void)handle; (void)reg; (void)p1; (void)p2; (void)p3; (void)p4; return 0; }
+int cmd_read_sr(libusb_device_handle *handle, uint32_t *sr_value) { (void)handle; (void)sr_value; return 0; }
+int cmd_07_16_write_pc(libusb_device_handle *handle, uint32_t pc_value) { (void)handle; (void)pc_value; return 0; }
+int cmd_07_15(libusb_device_handle *handle, uint16_t reg, uint8_t *params, int param_count) { (void)handle; (void)reg; (void)params; (void)param_count; return 0; }
+int cmd_07_a2(libusb_device_handle *handle, uint8_t param) { (void)handle; (void)param; return 0; }
+int cmd_04_40_58_04(libusb_device_handle *handle) { (void)handle; return 0; }
+int cmd_04_7f_fe_02(libusb_device_handle *handle) { (void)handle; return 0; }
+int cmd_04_40_00_02(libusb_device_handle *handle) { (void)handle; return 0; }
+int target_init_full(libusb_device_handle *handle, uint32_t *flash_size_kb) { (void)handle; (void)flash_size_kb; return 0; }
+int target_attach(libusb_device_handle *handle, uint32_t *flash_size_kb) { (void)handle; (void)flash_size_kb; return 0; }
+int cmd_setup_memory_windows_full(libusb_device_handle *handle) { (void)handle; return 0; }
+int sram_pre_init(libusb_device_handle *handle) { (void)handle; return 0; }
+int sram_validation_sequence(libusb_device_handle *handle) { (void)handle; return 0; }
+int sram_init_full(libusb_device_handle *handle) { (void)handle; return 0; }
+int cmd_07_14(libusb_device_handle *handle, uint16_t reg, uint8_t p1, uint8_t p2, uint8_t p3, uint8_t p4, uint32_t addr) { (void)handle; (void)reg; (void)p1; (void)p2; (void)p3; (void)p4; (void)addr; return 0; }
+int cmd_07_19(libusb_device_handle *handle, uint32_t addr, uint32_t data) { (void)handle; (void)addr; (void)data; return 0; }
+int cmd_07_10(libusb_device_handle *handle, uint16_t reg) { (void)handle; (void)reg; return 0; }
+int cmd_07_17(libusb_device_handle *handle) { (void)handle; return 0; }
+void generated_commands(libusb_device_handle *handle) { (void)handle; }
@@ -0,0 +1,29 @@
+/*
+ * Fake OpenLink probe for the server tests
+ *
+ * Implements the openlink_protocol.h calls against an in-memory target:
+ * debug registers are recorded, the core halts as soon as it is resumed
+ * and reports fake.halt_csr as its halt status.
+ *
+ * License: GPL v3
+ */
+
+#ifndef FAKE_OPENLINK_H
+#define FAKE_OPENLINK_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t debug_regs[32];        /* WDMREG writes, by DRc */
+    uint32_t halt_csr;              /* CSR status after the next resume */
+    uint32_t csr;                   /* Current status, cleared on read */
+    int halted;
+    int resumes;                    /* BDM GO commands seen */
+    uint32_t tdr_at_resume;         /* TDR when the core was last resumed */
+    uint8_t mem_fill;               /* Every byte of target memory reads as this */
+    uint8_t mem_step;               /* Added to mem_fill at each resume */
+} fake_target_t;
+
+extern fake_target_t fake;
+
+#endif /* FAKE_OPENLINK_H */
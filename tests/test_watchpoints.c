@@ -0,0 +1,211 @@
+/*
+ * Watchpoint tests for the GDB server, run against the fake probe
+ *
+ * The server is built into this file so its static handlers can be driven
+ * with RSP packets directly.
+ *
+ * License: GPL v3
+ */
+
+#define main gdbserver_main
+#include "../src/m68k-gdbserver.c"
+#undef main
+
+#include "fake_openlink.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+        fprintf(stderr, __VA_ARGS__); \
+        fprintf(stderr, "\n"); \
+        failures++; \
+    } \
+} while (0)
+
+static int gdb_fd;          /* GDB's end of the connection */
+static int server_fd;       /* The server's end */
+
+/* Send one packet to the server and return its reply payload */
+static const char *rsp(const char *packet) {
+    static char reply[4096];
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "%s", packet);
+    process_command(server_fd, cmd, strlen(cmd));
+
+    ssize_t n = recv(gdb_fd, reply, sizeof(reply) - 1, MSG_DONTWAIT);
+    reply[n > 0 ? n : 0] = '\0';
+    char *start = strchr(reply, '$');
+    char *end = strrchr(reply, '#');
+    if (!start || !end) {
+        return "";
+    }
+    *end = '\0';
+    return start + 1;
+}
+
+static const char *monitor(const char *command) {
+    char packet[512] = "qRcmd,";
+    bytes_to_hex((const uint8_t *)command, strlen(command), packet + strlen(packet));
+    return rsp(packet);
+}
+
+static void reset_session(void) {
+    memset(&fake, 0, sizeof(fake));
+    fake.halted = 1;
+    tdr_shadow = 0;
+    init_breakpoints();
+    init_watchpoints();
+    invalidate_halt_state();
+    g_target_halted = 1;
+}
+
+/* GDB removes its watchpoints at each stop and inserts them again on
+ * resume; a value match set in between must survive that
+ */
+static void test_value_match_across_stops(void) {
+    reset_session();
+
+    CHECK(strcmp(rsp("Z2,20000101,1"), "OK") == 0, "Z2");
+    CHECK(strcmp(rsp("z2,20000101,1"), "OK") == 0, "z2");
+    CHECK(strcmp(monitor("watch-value 0x42"), "4f4b0a") == 0, "watch-value with no watchpoint inserted");
+    CHECK(strcmp(rsp("Z2,20000101,1"), "OK") == 0, "Z2 again");
+
+    fake.halt_csr = CSR_TRG | CSR_BSTAT_L1HIT;
+    const char *stop = rsp("c");
+    CHECK(strcmp(stop, "T05watch:20000101;") == 0, "stop reply '%s'", stop);
+
+    /* Byte at offset 1 of the longword: bits 23..16, byte lane UM */
+    CHECK(fake.debug_regs[DEBUG_REG_DBR] == 0x00420000, "DBR 0x%08X", fake.debug_regs[DEBUG_REG_DBR]);
+    CHECK(fake.debug_regs[DEBUG_REG_DBMR] == 0xFF00FFFF, "DBMR 0x%08X", fake.debug_regs[DEBUG_REG_DBMR]);
+    CHECK(fake.tdr_at_resume & TDR_EDUM1, "TDR 0x%08X has no EDUM", fake.tdr_at_resume);
+    CHECK(!(fake.tdr_at_resume & TDR_EDLW1), "TDR 0x%08X compares a longword", fake.tdr_at_resume);
+
+    /* Next stop/resume cycle keeps the match */
+    rsp("z2,20000101,1");
+    memset(fake.debug_regs, 0, sizeof(fake.debug_regs));
+    rsp("Z2,20000101,1");
+    CHECK(fake.debug_regs[DEBUG_REG_DBR] == 0x00420000, "DBR after z2/Z2 0x%08X", fake.debug_regs[DEBUG_REG_DBR]);
+
+    CHECK(strcmp(monitor("watch-value off"), "4f4b0a") == 0, "watch-value off");
+    CHECK(!(tdr_shadow & TDR_EDUM1), "lane still enabled after off");
+    rsp("z2,20000101,1");
+}
+
+/* Word watch on the lower half of a longword */
+static void test_word_lanes(void) {
+    reset_session();
+
+    rsp("Z2,20000102,2");
+    CHECK(strcmp(monitor("watch-value 0x1234"), "4f4b0a") == 0, "watch-value on a word");
+    CHECK(fake.debug_regs[DEBUG_REG_DBR] == 0x00001234, "DBR 0x%08X", fake.debug_regs[DEBUG_REG_DBR]);
+    CHECK(tdr_shadow & TDR_EDWL1, "TDR 0x%08X has no EDWL", tdr_shadow);
+    rsp("z2,20000102,2");
+
+    /* The comparator can't match a misaligned word */
+    rsp("Z2,20000101,2");
+    CHECK(strcmp(monitor("watch-value 1"), "4f4b0a") != 0, "watch-value accepted a misaligned word");
+    rsp("z2,20000101,2");
+}
+
+/* A Z2 condition comparing the variable with a constant arms the data
+ * comparator by itself; other conditions are only evaluated at the halt
+ */
+static void test_condition_value(void) {
+    reset_session();
+
+    /* *(unsigned char *)0x20000101 == 0x42 */
+    CHECK(strcmp(rsp("Z2,20000101,1;Xa,24200001011722421327"), "OK") == 0, "Z2 with condition");
+    CHECK(fake.debug_regs[DEBUG_REG_DBR] == 0x00420000, "DBR 0x%08X", fake.debug_regs[DEBUG_REG_DBR]);
+    CHECK(fake.debug_regs[DEBUG_REG_DBMR] == 0xFF00FFFF, "DBMR 0x%08X", fake.debug_regs[DEBUG_REG_DBMR]);
+    CHECK(tdr_shadow & TDR_EDUM1, "TDR 0x%08X has no EDUM", tdr_shadow);
+
+    /* The condition is checked at the halt as well: resumed until true */
+    fake.halt_csr = CSR_TRG | CSR_BSTAT_L1HIT;
+    fake.mem_fill = 0x40;
+    fake.mem_step = 1;
+    const char *stop = rsp("c");
+    CHECK(strcmp(stop, "T05watch:20000101;") == 0, "stop reply '%s'", stop);
+    CHECK(fake.resumes == 2, "resumed %d times", fake.resumes);
+    fake.mem_step = 0;
+    rsp("z2,20000101,1");
+    CHECK(!(tdr_shadow & TDR_ED1_MASK), "lanes left on in TDR 0x%08X", tdr_shadow);
+
+    /* (*(unsigned short *)0x20000102 & 0xF0) == 0x40 */
+    rsp("Z2,20000102,2;Xf,2420000102182300f00f2300401327");
+    CHECK(fake.debug_regs[DEBUG_REG_DBR] == 0x00000040, "masked DBR 0x%08X", fake.debug_regs[DEBUG_REG_DBR]);
+    CHECK(fake.debug_regs[DEBUG_REG_DBMR] == 0xFFFFFF0F, "masked DBMR 0x%08X", fake.debug_regs[DEBUG_REG_DBMR]);
+    rsp("z2,20000102,2");
+
+    /* 5 < *(unsigned char *)0x20000101: not a comparator match */
+    rsp("Z2,20000101,1;Xa,22052420000101171527");
+    CHECK(!(tdr_shadow & TDR_ED1_MASK), "TDR 0x%08X compares data for '<'", tdr_shadow);
+    rsp("z2,20000101,1");
+}
+
+/* With several watchpoints, only a trigger halt may be filtered */
+static void test_unattributed_halts(void) {
+    reset_session();
+    rsp("Z2,20000100,4");
+    rsp("Z2,20000200,4");
+
+    /* HALT instruction inside the range: reported, not resumed */
+    fake.halt_csr = CSR_HALT;
+    const char *stop = rsp("c");
+    CHECK(strcmp(stop, "S05") == 0, "HALT stop reply '%s'", stop);
+    CHECK(fake.resumes == 1, "resumed %d times", fake.resumes);
+
+    /* A read/access watch can't be told from an access between the
+     * variables, so such a trigger is reported without a watch address
+     */
+    rsp("Z3,20000300,4");
+    fake.halt_csr = CSR_TRG;
+    stop = rsp("c");
+    CHECK(strcmp(stop, "S05") == 0, "unattributed trigger reply '%s'", stop);
+}
+
+/* PC breakpoints and the address/data triggers use separate TDR fields */
+static void test_tdr_fields(void) {
+    reset_session();
+
+    CHECK(strcmp(rsp("Z1,20000400,2"), "OK") == 0, "Z1");
+    rsp("c");
+    CHECK(fake.tdr_at_resume & TDR_EPC1, "TDR 0x%08X has no EPC", fake.tdr_at_resume);
+    CHECK(!(fake.tdr_at_resume & (TDR_ED1_MASK | TDR_EA1_MASK)),
+          "PC breakpoint set TDR 0x%08X", fake.tdr_at_resume);
+
+    rsp("Z2,20000100,4");
+    CHECK(fake.debug_regs[DEBUG_REG_AATR] == AATR_DATA, "AATR 0x%08X for a write watch",
+          fake.debug_regs[DEBUG_REG_AATR]);
+    rsp("z2,20000100,4");
+    rsp("Z4,20000100,4");
+    CHECK(fake.debug_regs[DEBUG_REG_AATR] == (AATR_DATA | AATR_RM), "AATR 0x%08X for an access watch",
+          fake.debug_regs[DEBUG_REG_AATR]);
+    rsp("z4,20000100,4");
+
+    CHECK(strcmp(rsp("z1,20000400,2"), "OK") == 0, "z1");
+    rsp("c");
+    CHECK(!(fake.tdr_at_resume & TDR_EPC1), "EPC left on in TDR 0x%08X", fake.tdr_at_resume);
+    CHECK(fake.debug_regs[DEBUG_REG_PBR0] == PBR0_UNUSED, "PBR0 0x%08X", fake.debug_regs[DEBUG_REG_PBR0]);
+}
+
+int main(void) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        perror("socketpair");
+        return 1;
+    }
+    gdb_fd = fds[0];
+    server_fd = fds[1];
+    g_usb_dev = (libusb_device_handle *)&fake;
+
+    test_value_match_across_stops();
+    test_word_lanes();
+    test_condition_value();
+    test_unattributed_halts();
+    test_tdr_fields();
+
+    fprintf(stderr, "%s\n", failures ? "watchpoint tests FAILED" : "watchpoint tests passed");
+    return failures ? 1 : 0;
+}